@@ -0,0 +1,96 @@
+#include <pthread.h>
+
+#include "LTNSBatch.h"
+
+/* Documents a thread takes at once, enough to make the shared counter cheap
+ * and few enough to balance documents of different sizes */
+#define BATCH_CHUNK 64
+
+typedef struct
+{
+	const char* const* documents;
+	const size_t* lengths;
+	size_t document_count;
+	const LTNSPath* paths;
+	size_t path_count;
+	LTNSExtract* results;
+	size_t next_document; // NOTE: shared between the threads
+} LTNSBatch;
+
+static void LTNSBatchExtractDocument(LTNSBatch* batch, size_t document);
+static void* LTNSBatchWork(void* batch);
+
+LTNSError LTNSBatchExtract(const char* const* documents, const size_t* lengths, size_t document_count,
+		const LTNSPath* paths, size_t path_count, LTNSExtract* results, size_t thread_count)
+{
+	if (!thread_count || (path_count && !paths))
+		return INVALID_ARGUMENT;
+	if (document_count && path_count && (!documents || !lengths || !results))
+		return INVALID_ARGUMENT;
+
+	LTNSBatch batch = { documents, lengths, document_count, paths, path_count, results, 0 };
+	if (!path_count)
+		return 0;
+
+	size_t chunks = (document_count + BATCH_CHUNK - 1) / BATCH_CHUNK;
+	thread_count = MIN(thread_count, chunks);
+	pthread_t* threads = NULL;
+	size_t started = 0;
+	if (thread_count > 1)
+		threads = (pthread_t*)malloc(sizeof(pthread_t) * (thread_count - 1));
+	/* Without threads the calling one does all the work */
+	if (threads)
+	{
+		for (; started < thread_count - 1; started++)
+			if (pthread_create(&threads[started], NULL, LTNSBatchWork, &batch))
+				break;
+	}
+
+	LTNSBatchWork(&batch);
+	while (started)
+		pthread_join(threads[--started], NULL);
+	free(threads);
+
+	return 0;
+}
+
+static void* LTNSBatchWork(void* ptr)
+{
+	LTNSBatch* batch = (LTNSBatch*)ptr;
+	size_t document, end;
+
+	for (;;)
+	{
+		document = __atomic_fetch_add(&batch->next_document, BATCH_CHUNK, __ATOMIC_RELAXED);
+		if (document >= batch->document_count)
+			return NULL;
+		end = MIN(document + BATCH_CHUNK, batch->document_count);
+		for (; document < end; document++)
+			LTNSBatchExtractDocument(batch, document);
+	}
+}
+
+static void LTNSBatchExtractDocument(LTNSBatch* batch, size_t document)
+{
+	const char* tnetstring = batch->documents[document];
+	const char* tnet_end = tnetstring + batch->lengths[document];
+	LTNSExtract* result = batch->results + document * batch->path_count;
+	char *value, *payload;
+	size_t payload_length, i;
+	LTNSType type;
+
+	for (i = 0; i < batch->path_count; i++)
+	{
+		result[i].tnetstring = NULL;
+		result[i].length = 0;
+		if (!tnetstring)
+			continue;
+		if (LTNSTermGetPath(tnetstring, tnet_end, &batch->paths[i], &value))
+			continue;
+		/* Also checks the value ends within the document */
+		if (LTNSTermScan(value, tnet_end, &payload, &payload_length, &type))
+			continue;
+		result[i].tnetstring = value;
+		result[i].length = payload + payload_length + 1 - value;
+	}
+}
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "LTNSBuffer.h"
+
+#define MIN_BUFFER_CAPACITY 64
+
+LTNSError LTNSBufferInit(LTNSBuffer* buffer, size_t capacity)
+{
+	if (!buffer)
+		return INVALID_ARGUMENT;
+
+	if (capacity < MIN_BUFFER_CAPACITY)
+		capacity = MIN_BUFFER_CAPACITY;
+
+	buffer->data = (char*)malloc(capacity);
+	if (!buffer->data)
+		return OUT_OF_MEMORY;
+	buffer->length = 0;
+	buffer->capacity = capacity;
+
+	return 0;
+}
+
+LTNSError LTNSBufferDestroy(LTNSBuffer* buffer)
+{
+	if (!buffer)
+		return INVALID_ARGUMENT;
+
+	free(buffer->data);
+	buffer->data = NULL;
+	buffer->length = 0;
+	buffer->capacity = 0;
+
+	return 0;
+}
+
+LTNSError LTNSBufferReserve(LTNSBuffer* buffer, size_t additional)
+{
+	if (!buffer)
+		return INVALID_ARGUMENT;
+
+	if (buffer->length + additional <= buffer->capacity)
+		return 0;
+
+	/* Grow geometrically so appending n bytes is amortized O(n) */
+	size_t capacity = buffer->capacity ? buffer->capacity : MIN_BUFFER_CAPACITY;
+	while (capacity < buffer->length + additional)
+		capacity *= 2;
+
+	char* data = (char*)realloc(buffer->data, capacity);
+	if (!data)
+		return OUT_OF_MEMORY;
+	buffer->data = data;
+	buffer->capacity = capacity;
+
+	return 0;
+}
+
+LTNSError LTNSBufferAppend(LTNSBuffer* buffer, const char* data, size_t length)
+{
+	LTNSError error = LTNSBufferReserve(buffer, length);
+	RETURN_VAL_IF(error);
+
+	memcpy(buffer->data + buffer->length, data, length);
+	buffer->length += length;
+
+	return 0;
+}
+
+LTNSError LTNSBufferAppendChar(LTNSBuffer* buffer, char c)
+{
+	LTNSError error = LTNSBufferReserve(buffer, 1);
+	RETURN_VAL_IF(error);
+
+	buffer->data[buffer->length++] = c;
+
+	return 0;
+}
+
+LTNSError LTNSBufferBeginTerm(LTNSBuffer* buffer, size_t* mark)
+{
+	if (!buffer || !mark)
+		return INVALID_ARGUMENT;
+
+	/* Room for the longest prefix and the colon */
+	LTNSError error = LTNSBufferReserve(buffer, MAX_PREFIX_LENGTH + 1);
+	RETURN_VAL_IF(error);
+
+	*mark = buffer->length;
+	buffer->length += MAX_PREFIX_LENGTH + 1;
+
+	return 0;
+}
+
+LTNSError LTNSBufferEndTerm(LTNSBuffer* buffer, size_t mark, LTNSType type)
+{
+	char prefix[MAX_PREFIX_LENGTH + 2];
+
+	if (!buffer || mark + MAX_PREFIX_LENGTH + 1 > buffer->length || !LTNSTypeIsValid(type))
+		return INVALID_ARGUMENT;
+
+	char* payload = buffer->data + mark + MAX_PREFIX_LENGTH + 1;
+	size_t payload_length = buffer->length - (mark + MAX_PREFIX_LENGTH + 1);
+	if (count_digits(payload_length) > MAX_PREFIX_LENGTH)
+		return INVALID_ARGUMENT;
+
+	int prefix_length = snprintf(prefix, sizeof(prefix), "%zu:", payload_length);
+	LTNSError error = LTNSBufferReserve(buffer, 1);
+	RETURN_VAL_IF(error);
+	payload = buffer->data + mark + MAX_PREFIX_LENGTH + 1;
+
+	/* Close the gap between the prefix and the payload */
+	memcpy(buffer->data + mark, prefix, prefix_length);
+	memmove(buffer->data + mark + prefix_length, payload, payload_length);
+	buffer->length = mark + prefix_length + payload_length;
+	buffer->data[buffer->length++] = (char)type;
+
+	return 0;
+}
@@ -1,4 +1,6 @@
 #include "LTNSDataAccess.h"
+#include "LTNSStats.h"
+#include "LTNSProbes.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -9,6 +11,9 @@
 #define IS_CHILD(x) ((x)->offset > 0)
 #define IS_ORPHAN(x) ((x)->parent == NULL)
 
+static LTNSError LTNSDataAccessGetPrivate(LTNSDataAccess* data_access, const char* key, LTNSTerm** term);
+static LTNSError LTNSDataAccessSetPrivate(LTNSDataAccess* data_access, const char* key, LTNSTerm* term);
+static LTNSError LTNSDataAccessRemovePrivate(LTNSDataAccess* data_access, const char* key);
 static LTNSError LTNSDataAccessAdd(LTNSDataAccess* data_access, const char* key, LTNSTerm* term);
 static LTNSError LTNSDataAccessUpdate(LTNSDataAccess* data_access, const char* key, LTNSTerm* old_term, LTNSTerm* new_term);
 static LTNSError LTNSDataAccessShrink(LTNSDataAccess* data_access, char* tail_start, long length_delta);
@@ -30,10 +35,27 @@ static LTNSError LTNSDataAccessUpdateTNetstrings(LTNSDataAccess* data_access, LT
 static LTNSChildNode* LTNSDataAccessFindChild(LTNSDataAccess* data_access, LTNSDataAccess* child);
 static LTNSChildNode* LTNSDataAccessFindChildAt(LTNSDataAccess* data_access, char* position);
 static int LTNSDataAccessIsChildValid(LTNSDataAccess* data_access);
+static int LTNSDataAccessIsFrozenTree(LTNSDataAccess* data_access);
 static void LTNSDataAccessDeleteChildAt(LTNSDataAccess* data_access, char* position);
+static void LTNSDataAccessOrphanChildren(LTNSDataAccess* data_access);
 
 static LTNSError LTNSDataAccessTermOffset(LTNSDataAccess* data_access, LTNSTerm* term, size_t* offset);
 
+static void LTNSDataAccessInvalidateHash(LTNSDataAccess* data_access);
+static int LTNSDataAccessTermsEquivalent(const char* term, const char* term_end, const char* other, const char* other_end);
+
+static LTNSError LTNSDataAccessRecord(LTNSDataAccess* data_access, LTNSJournalOperation operation, const char* key, LTNSTerm* term);
+static LTNSError LTNSDataAccessKeyOf(LTNSDataAccess* data_access, const char* value_position, const char** key, size_t* key_length);
+static LTNSError LTNSDataAccessApplyOperation(LTNSDataAccess* data_access, LTNSJournalOperation operation,
+		const char* keys, const char* keys_end, char* term, size_t term_length);
+
+static LTNSError LTNSDataAccessMergePayloads(const char* payload, const char* payload_end,
+		const char* other, const char* other_end, LTNSMergePolicy policy, LTNSBuffer* out, LTNSBuffer* changed);
+static LTNSError LTNSDataAccessRecordMerge(LTNSDataAccess* data_access, LTNSBuffer* merged, LTNSBuffer* changed);
+
+static LTNSError LTNSDataAccessProjectPayload(const char* payload, const char* payload_end,
+		const LTNSPath* paths, size_t path_count, char* flags, size_t depth, LTNSBuffer* out);
+
 struct _LTNSDataAccess
 {
 	unsigned int ref_count;
@@ -42,6 +64,12 @@ struct _LTNSDataAccess
 	size_t offset; // NOTE: global offset, i.e. in relation to parent
 	LTNSDataAccess* parent;
 	LTNSChildNode* children;
+	uint64_t hash;
+	char hash_valid;
+	uint64_t version; // NOTE: counts changes to the keys of this dictionary
+	char frozen; // NOTE: only set on the root
+	char detached; // NOTE: child of a frozen tree, not in its parent's child list
+	LTNSJournal* journal; // NOTE: only set on the root
 };
 
 /* The root (parent == NULL) owns the copy of the tnetstring */
@@ -93,6 +121,12 @@ static LTNSError LTNSDataAccessCreatePrivate(LTNSDataAccess** data_access,
 	(*data_access)->parent = NULL;
 	(*data_access)->children = NULL;
 	(*data_access)->ref_count = 1;
+	(*data_access)->hash = 0;
+	(*data_access)->hash_valid = FALSE;
+	(*data_access)->version = 0;
+	(*data_access)->frozen = FALSE;
+	(*data_access)->detached = FALSE;
+	(*data_access)->journal = NULL;
 
 	return 0;
 }
@@ -108,6 +142,32 @@ LTNSError LTNSDataAccessCreate(LTNSDataAccess** data_access, const char* tnetstr
 	return LTNSDataAccessCreatePrivate(data_access, tnetstring, length, TRUE);
 }
 
+LTNSError LTNSDataAccessCreateFromBuffer(LTNSDataAccess** data_access, LTNSBuffer* buffer)
+{
+	if (!data_access || !buffer || !buffer->data)
+		return INVALID_ARGUMENT;
+
+	/* Check if tnetstring is valid */
+	LTNSTerm *term = NULL;
+	LTNSError error = LTNSTermCreateNested(&term, buffer->data, buffer->data + buffer->length);
+	RETURN_VAL_IF(error);
+	LTNSTermDestroy(term);
+
+	/* Roots keep a NUL byte after their tnetstring */
+	error = LTNSBufferReserve(buffer, 1);
+	RETURN_VAL_IF(error);
+	error = LTNSDataAccessCreatePrivate(data_access, buffer->data, buffer->length, FALSE);
+	RETURN_VAL_IF(error);
+	buffer->data[buffer->length] = '\0';
+
+	/* The root owns the memory from now on */
+	buffer->data = NULL;
+	buffer->length = 0;
+	buffer->capacity = 0;
+
+	return 0;
+}
+
 LTNSError LTNSDataAccessCreateNested( LTNSDataAccess **child, LTNSDataAccess *parent, LTNSTerm *term)
 {
 	char *tnetstring = NULL;
@@ -128,6 +188,18 @@ LTNSError LTNSDataAccessCreateNested( LTNSDataAccess **child, LTNSDataAccess *pa
 	error = LTNSTermGetTNetstring(term, &tnetstring, &length);
 	RETURN_VAL_IF( error );
 
+	/* Frozen trees don't change, their children needn't be tracked */
+	if (LTNSDataAccessIsFrozenTree(parent))
+	{
+		error = LTNSDataAccessCreatePrivate(child, tnetstring, length, FALSE);
+		RETURN_VAL_IF(error);
+		(*child)->parent = parent;
+		(*child)->offset = offset;
+		(*child)->detached = TRUE;
+		LTNS_STATS_LIVE_CHILDREN(1);
+		return 0;
+	}
+
 	/* Don't create new child if it is already in the parent's child list */
 	LTNSChildNode *node = LTNSDataAccessFindChildAt(parent, tnetstring);
 	if (node)
@@ -151,13 +223,12 @@ LTNSError LTNSDataAccessCreateNested( LTNSDataAccess **child, LTNSDataAccess *pa
 	}
 
 	(*child)->offset = offset;
+	LTNS_STATS_LIVE_CHILDREN(1);
 	return 0;
 }
 
 LTNSError LTNSDataAccessDestroy(LTNSDataAccess* data_access)
 {
-	LTNSChildNode *node, *to_delete;
-
 	if (!data_access || data_access->ref_count == 0)
 		return INVALID_ARGUMENT;
 
@@ -166,28 +237,21 @@ LTNSError LTNSDataAccessDestroy(LTNSDataAccess* data_access)
 	if (data_access->ref_count > 0)
 		return 0;
 
-	if (data_access->children)
-	{
-		node = data_access->children;
-		while (node)
-		{
-			/* Orphan the child */
-			node->child->parent = NULL;
-			to_delete = node;
-			node = node->next;
-			free(to_delete);
-		}
-	}
+	LTNSDataAccessOrphanChildren(data_access);
 
 	/* If data_access is root (ie has no parent) then we free the tnetstring */
 	if (IS_ROOT(data_access))
 	{
 		free(data_access->tnetstring);
+		if (data_access->journal)
+			LTNSJournalDestroy(data_access->journal);
 	}
-	else if (IS_CHILD(data_access) && !IS_ORPHAN(data_access))
+	else if (IS_CHILD(data_access) && !IS_ORPHAN(data_access) && !data_access->detached)
 	{
 		LTNSDataAccessDeleteChildAt(data_access->parent, data_access->tnetstring);
 	}
+	if (IS_CHILD(data_access))
+		LTNS_STATS_LIVE_CHILDREN(-1);
 
 	free(data_access);
 
@@ -212,6 +276,93 @@ LTNSError LTNSDataAccessChildren(LTNSDataAccess* data_access, LTNSChildNode** fi
 	return 0;
 }
 
+LTNSError LTNSDataAccessCountChildren(LTNSDataAccess* data_access, size_t* count)
+{
+	if (!data_access || !count)
+		return INVALID_ARGUMENT;
+
+	*count = 0;
+	LTNSChildNode *node = data_access->children;
+	while (node)
+	{
+		size_t nested = 0;
+		LTNSDataAccessCountChildren(node->child, &nested);
+		*count += 1 + nested;
+		node = node->next;
+	}
+
+	return 0;
+}
+
+LTNSError LTNSDataAccessVersion(LTNSDataAccess* data_access, uint64_t* version)
+{
+	if (!data_access || !version)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+
+	*version = data_access->version;
+	return 0;
+}
+
+LTNSError LTNSDataAccessMemsize(LTNSDataAccess* data_access, size_t* bytes)
+{
+	if (!data_access || !bytes)
+		return INVALID_ARGUMENT;
+
+	*bytes = sizeof(LTNSDataAccess);
+	if (IS_ROOT(data_access))
+		*bytes += data_access->length + 1;
+
+	LTNSChildNode *node = data_access->children;
+	while (node)
+	{
+		*bytes += sizeof(LTNSChildNode);
+		node = node->next;
+	}
+
+	return 0;
+}
+
+LTNSError LTNSDataAccessLength(LTNSDataAccess* data_access, size_t* length)
+{
+	if (!data_access || !length)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+
+	*length = data_access->length;
+	return 0;
+}
+
+LTNSError LTNSDataAccessPath(LTNSDataAccess* data_access, const char** keys, size_t* key_lengths, size_t* depth)
+{
+	LTNSDataAccess* node;
+	size_t i = 0;
+
+	if (!data_access || !depth || (keys && !key_lengths))
+		return INVALID_ARGUMENT;
+
+	for (node = data_access; IS_CHILD(node); node = node->parent)
+	{
+		if (IS_ORPHAN(node))
+			return INVALID_CHILD;
+		i++;
+	}
+	*depth = i;
+	if (!keys)
+		return 0;
+
+	for (node = data_access; IS_CHILD(node); node = node->parent)
+	{
+		i--;
+		LTNSError error = LTNSDataAccessKeyOf(node->parent, node->tnetstring, &keys[i], &key_lengths[i]);
+		RETURN_VAL_IF(error);
+	}
+
+	return 0;
+}
+
 LTNSError LTNSDataAccessOffset(LTNSDataAccess* data_access, size_t* offset)
 {
 	if (!data_access || !offset)
@@ -242,7 +393,89 @@ static LTNSError LTNSDataAccessTermOffset(LTNSDataAccess* data_access, LTNSTerm*
 	return 0;
 }
 
+LTNSError LTNSDataAccessFreeze(LTNSDataAccess* data_access)
+{
+	if (!data_access)
+		return INVALID_ARGUMENT;
+
+	LTNSDataAccess* root = LTNSDataAccessGetRoot(data_access);
+	if (!root)
+		return INVALID_CHILD;
+	if (root->frozen)
+		return 0;
+
+	/* Hash now, later hashes would write the cache from any thread */
+	LTNSDataAccessInvalidateHash(root);
+	root->hash = LTNSHash64(root->tnetstring, root->length, 0);
+	root->hash_valid = TRUE;
+	root->frozen = TRUE;
+	return 0;
+}
+
+LTNSError LTNSDataAccessIsFrozen(LTNSDataAccess* data_access, int* frozen)
+{
+	if (!data_access || !frozen)
+		return INVALID_ARGUMENT;
+
+	*frozen = LTNSDataAccessIsFrozenTree(data_access);
+	return 0;
+}
+
+LTNSError LTNSDataAccessSnapshot(LTNSDataAccess* data_access, LTNSDataAccess** snapshot)
+{
+	if (!data_access || !snapshot)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+
+	LTNSError error = LTNSDataAccessCreatePrivate(snapshot, data_access->tnetstring, data_access->length, TRUE);
+	RETURN_VAL_IF(error);
+	error = LTNSDataAccessFreeze(*snapshot);
+	if (error)
+	{
+		LTNSDataAccessDestroy(*snapshot);
+		*snapshot = NULL;
+	}
+	return error;
+}
+
+static int LTNSDataAccessIsFrozenTree(LTNSDataAccess* data_access)
+{
+	LTNSDataAccess* root = LTNSDataAccessGetRoot(data_access);
+	return root && root->frozen;
+}
+
+/* Get, Set and Remove only wrap the private versions with tracepoints */
 LTNSError LTNSDataAccessGet(LTNSDataAccess* data_access, const char* key, LTNSTerm** term)
+{
+	LTNS_PROBE2(get__entry, key, data_access ? data_access->length : 0);
+	LTNSError error = LTNSDataAccessGetPrivate(data_access, key, term);
+	LTNS_PROBE2(get__return, key, error);
+	return error;
+}
+
+LTNSError LTNSDataAccessSet(LTNSDataAccess* data_access, const char* key, LTNSTerm* term)
+{
+#ifdef HAVE_SYS_SDT_H
+	size_t value_length = 0;
+	if (term)
+		LTNSTermGetTNetstring(term, NULL, &value_length);
+	LTNS_PROBE3(set__entry, key, data_access ? data_access->length : 0, value_length);
+#endif
+	LTNSError error = LTNSDataAccessSetPrivate(data_access, key, term);
+	LTNS_PROBE3(set__return, key, error, data_access ? data_access->length : 0);
+	return error;
+}
+
+LTNSError LTNSDataAccessRemove(LTNSDataAccess* data_access, const char* key)
+{
+	LTNS_PROBE2(remove__entry, key, data_access ? data_access->length : 0);
+	LTNSError error = LTNSDataAccessRemovePrivate(data_access, key);
+	LTNS_PROBE3(remove__return, key, error, data_access ? data_access->length : 0);
+	return error;
+}
+
+static LTNSError LTNSDataAccessGetPrivate(LTNSDataAccess* data_access, const char* key, LTNSTerm** term)
 {
 	if (!term || !data_access)
 		return INVALID_ARGUMENT;
@@ -258,7 +491,7 @@ LTNSError LTNSDataAccessGet(LTNSDataAccess* data_access, const char* key, LTNSTe
 	return LTNSDataAccessFindValueTerm(data_access, key, term);
 }
 
-LTNSError LTNSDataAccessSet(LTNSDataAccess* data_access, const char* key, LTNSTerm* term)
+static LTNSError LTNSDataAccessSetPrivate(LTNSDataAccess* data_access, const char* key, LTNSTerm* term)
 {
 	LTNSError error = 0;
 	LTNSTerm *old_term = NULL;
@@ -267,16 +500,22 @@ LTNSError LTNSDataAccessSet(LTNSDataAccess* data_access, const char* key, LTNSTe
 		return INVALID_ARGUMENT;
 	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
 		return INVALID_CHILD;
+	if (LTNSDataAccessIsFrozenTree(data_access))
+		return FROZEN_DATA_ACCESS;
 
 	char* tnetstring;
 	size_t length = 0;
 	LTNSTerm *copy = NULL;
 	LTNSTermGetTNetstring(term, &tnetstring, &length);
-	char tnet_copy[length+1];
+	char* tnet_copy = NULL;
 	/* Check that the nested term is within this data_access (ie nested) */
 	if ((tnetstring >= data_access->tnetstring)
 		&& (tnetstring < (data_access->tnetstring + data_access->length)))
 	{
+		/* Not on the stack, values can be arbitrarily large */
+		tnet_copy = malloc(length + 1);
+		if (!tnet_copy)
+			return OUT_OF_MEMORY;
 		memcpy(tnet_copy, tnetstring, length);
 		tnet_copy[length] = '\0';
 		LTNSTermCreateFromTNestring(&copy, tnet_copy);
@@ -284,22 +523,35 @@ LTNSError LTNSDataAccessSet(LTNSDataAccess* data_access, const char* key, LTNSTe
 	}
 
 	/* Check if we are updating or adding */
-	error = LTNSDataAccessGet(data_access, key, &old_term);
+	error = LTNSDataAccessGetPrivate(data_access, key, &old_term);
 	if (!error && old_term)
 	{
+		LTNSDataAccessInvalidateHash(data_access);
+		data_access->version++;
 		error = LTNSDataAccessUpdate(data_access, key, old_term, term);
 		LTNSTermDestroy(old_term);
+		if (!error)
+			error = LTNSDataAccessRecord(data_access, LTNS_JOURNAL_SET, key, term);
 		LTNSTermDestroy(copy);
+		free(tnet_copy);
 		RETURN_VAL_IF(error);
 	}
 	else if (error == KEY_NOT_FOUND) // For add new
 	{
+		LTNSDataAccessInvalidateHash(data_access);
+		data_access->version++;
 		error = LTNSDataAccessAdd(data_access, key, term);
+		if (!error)
+			error = LTNSDataAccessRecord(data_access, LTNS_JOURNAL_SET, key, term);
 		LTNSTermDestroy(copy);
+		free(tnet_copy);
 		RETURN_VAL_IF(error);
 	}
 	else
+	{
 		LTNSTermDestroy(copy);
+		free(tnet_copy);
+	}
 	return 0;
 }
 
@@ -317,12 +569,62 @@ LTNSError LTNSDataAccessAsTerm(LTNSDataAccess* data_access, LTNSTerm** term)
 	return 0;
 }
 
-LTNSError LTNSDataAccessRemove(LTNSDataAccess* data_access, const char* key)
+LTNSError LTNSDataAccessEquals(LTNSDataAccess* data_access, LTNSDataAccess* other, int* equal)
+{
+	if (!data_access || !other || !equal)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+	if (IS_CHILD(other) && !LTNSDataAccessIsChildValid(other))
+		return INVALID_CHILD;
+
+	*equal = data_access->length == other->length &&
+		!memcmp(data_access->tnetstring, other->tnetstring, data_access->length);
+	return 0;
+}
+
+LTNSError LTNSDataAccessEquivalent(LTNSDataAccess* data_access, LTNSDataAccess* other, int* equivalent)
+{
+	LTNSError error = LTNSDataAccessEquals(data_access, other, equivalent);
+	RETURN_VAL_IF(error);
+	if (*equivalent)
+		return 0;
+
+	*equivalent = LTNSDataAccessTermsEquivalent(data_access->tnetstring, data_access->tnetstring + data_access->length,
+		other->tnetstring, other->tnetstring + other->length);
+	return 0;
+}
+
+LTNSError LTNSDataAccessHash(LTNSDataAccess* data_access, uint64_t* hash)
+{
+	if (!data_access || !hash)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+
+	if (data_access->hash_valid)
+	{
+		*hash = data_access->hash;
+		return 0;
+	}
+
+	*hash = LTNSHash64(data_access->tnetstring, data_access->length, 0);
+	if (!LTNSDataAccessIsFrozenTree(data_access))
+	{
+		data_access->hash = *hash;
+		data_access->hash_valid = TRUE;
+	}
+	return 0;
+}
+
+static LTNSError LTNSDataAccessRemovePrivate(LTNSDataAccess* data_access, const char* key)
 {
 	if (!data_access || !key)
 		return INVALID_ARGUMENT;
 	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
 		return INVALID_CHILD;
+	if (LTNSDataAccessIsFrozenTree(data_access))
+		return FROZEN_DATA_ACCESS;
 
 	/* Find the key position */
 	char* key_position = NULL;
@@ -348,7 +650,207 @@ LTNSError LTNSDataAccessRemove(LTNSDataAccess* data_access, const char* key)
 
 	char* tail_start = value_position + value_length;
 	long length_delta = key_position - tail_start;
-	return LTNSDataAccessShrink(data_access, tail_start, length_delta);
+	LTNSDataAccessInvalidateHash(data_access);
+	data_access->version++;
+	error = LTNSDataAccessShrink(data_access, tail_start, length_delta);
+	RETURN_VAL_IF(error);
+
+	return LTNSDataAccessRecord(data_access, LTNS_JOURNAL_REMOVE, key, NULL);
+}
+
+LTNSError LTNSDataAccessMerge(LTNSDataAccess* data_access, LTNSDataAccess* other, LTNSMergePolicy policy)
+{
+	if (!data_access || !other)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(other) && !LTNSDataAccessIsChildValid(other))
+		return INVALID_CHILD;
+
+	return LTNSDataAccessMergeTNetstring(data_access, other->tnetstring, other->length, policy);
+}
+
+LTNSError LTNSDataAccessMergeTNetstring(LTNSDataAccess* data_access, const char* tnetstring, size_t length, LTNSMergePolicy policy)
+{
+	char *payload, *other;
+	size_t payload_length, other_length;
+	LTNSType type;
+	LTNSBuffer merged, changed;
+
+	if (!data_access || !tnetstring)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+	if (LTNSDataAccessIsFrozenTree(data_access))
+		return FROZEN_DATA_ACCESS;
+
+	LTNSError error = LTNSTermScan(tnetstring, tnetstring + length, &other, &other_length, &type);
+	RETURN_VAL_IF(error);
+	if (other + other_length + 1 != tnetstring + length)
+		return INVALID_TNETSTRING;
+	if (type != LTNS_DICTIONARY)
+		return UNSUPPORTED_TOP_LEVEL_DATA_STRUCTURE;
+
+	error = LTNSTermScan(data_access->tnetstring, data_access->tnetstring + data_access->length, &payload, &payload_length, NULL);
+	RETURN_VAL_IF(error);
+
+	/* Build the whole merged payload first, other may point into our own
+	 * tnetstring and move once we start resizing */
+	LTNSDataAccess* root = LTNSDataAccessGetRoot(data_access);
+	error = LTNSBufferInit(&merged, payload_length + other_length);
+	RETURN_VAL_IF(error);
+	error = LTNSBufferInit(&changed, 0);
+	if (!error)
+		error = LTNSDataAccessMergePayloads(payload, payload + payload_length, other, other + other_length,
+				policy, &merged, root->journal ? &changed : NULL);
+	if (error)
+		goto cleanup;
+
+	/* Every child's position changes, so they are orphaned just like a
+	 * child whose value is overwritten by Set */
+	LTNSDataAccessOrphanChildren(data_access);
+	LTNSDataAccessInvalidateHash(data_access);
+	data_access->version++;
+
+	long length_delta = (long)merged.length - (long)payload_length;
+	char* tail_start = payload + payload_length;
+	if (length_delta < 0)
+		error = LTNSDataAccessShrink(data_access, tail_start, length_delta);
+	else if (length_delta > 0)
+		error = LTNSDataAccessExpand(data_access, tail_start, length_delta);
+	if (error)
+		goto cleanup;
+
+	/* The prefix may have changed width, find the payload again */
+	error = LTNSTermScan(data_access->tnetstring, data_access->tnetstring + data_access->length, &payload, &payload_length, NULL);
+	if (error)
+		goto cleanup;
+	memcpy(payload, merged.data, merged.length);
+
+	if (root->journal)
+		error = LTNSDataAccessRecordMerge(data_access, &merged, &changed);
+
+cleanup:
+	LTNSBufferDestroy(&merged);
+	LTNSBufferDestroy(&changed);
+	return error;
+}
+
+LTNSError LTNSDataAccessProject(LTNSDataAccess* data_access, const LTNSPath* paths, size_t path_count, LTNSBuffer* out)
+{
+	char* payload;
+	size_t payload_length, mark;
+
+	if (!data_access || (!paths && path_count > 0) || !out)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+
+	LTNSError error = LTNSTermScan(data_access->tnetstring, data_access->tnetstring + data_access->length, &payload, &payload_length, NULL);
+	RETURN_VAL_IF(error);
+
+	/* Each depth takes a row of done and a row of group flags after the
+	 * row of active flags it was given, allocated once for the recursion */
+	size_t i, depth = 0;
+	for (i = 0; i < path_count; i++)
+		if (paths[i].length > depth)
+			depth = paths[i].length;
+	size_t flags_size = (2 * depth + 1) * path_count;
+	char* flags = (char*)malloc(flags_size ? flags_size : 1);
+	if (!flags)
+		return OUT_OF_MEMORY;
+	memset(flags, TRUE, path_count);
+
+	size_t start = out->length;
+	error = LTNSBufferBeginTerm(out, &mark);
+	if (!error)
+		error = LTNSDataAccessProjectPayload(payload, payload + payload_length, paths, path_count, flags, 0, out);
+	if (!error)
+		error = LTNSBufferEndTerm(out, mark, LTNS_DICTIONARY);
+	if (error)
+		out->length = start;
+
+	free(flags);
+	return error;
+}
+
+LTNSError LTNSDataAccessEnableJournal(LTNSDataAccess* data_access, int fd)
+{
+	LTNSJournal* journal = NULL;
+
+	if (!data_access)
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+	if (LTNSDataAccessIsFrozenTree(data_access))
+		return FROZEN_DATA_ACCESS;
+
+	LTNSDataAccess* root = LTNSDataAccessGetRoot(data_access);
+	LTNSError error = LTNSJournalCreate(&journal, fd);
+	RETURN_VAL_IF(error);
+
+	if (root->journal)
+		LTNSJournalDestroy(root->journal);
+	root->journal = journal;
+
+	return 0;
+}
+
+LTNSError LTNSDataAccessDisableJournal(LTNSDataAccess* data_access)
+{
+	if (!data_access)
+		return INVALID_ARGUMENT;
+
+	LTNSDataAccess* root = LTNSDataAccessGetRoot(data_access);
+	if (!root)
+		return INVALID_CHILD;
+	if (root->frozen)
+		return FROZEN_DATA_ACCESS;
+
+	if (root->journal)
+		LTNSJournalDestroy(root->journal);
+	root->journal = NULL;
+
+	return 0;
+}
+
+LTNSError LTNSDataAccessGetJournal(LTNSDataAccess* data_access, LTNSJournal** journal)
+{
+	if (!data_access || !journal)
+		return INVALID_ARGUMENT;
+
+	LTNSDataAccess* root = LTNSDataAccessGetRoot(data_access);
+	if (!root)
+		return INVALID_CHILD;
+
+	*journal = root->journal;
+	return 0;
+}
+
+LTNSError LTNSDataAccessApplyJournal(LTNSDataAccess* data_access, const char* operations, size_t length)
+{
+	LTNSJournalOperation operation;
+	char *keys, *term;
+	size_t keys_length, term_length;
+	const char* next;
+	LTNSError error;
+
+	if (!data_access || (!operations && length > 0))
+		return INVALID_ARGUMENT;
+	if (IS_CHILD(data_access) && !LTNSDataAccessIsChildValid(data_access))
+		return INVALID_CHILD;
+	if (LTNSDataAccessIsFrozenTree(data_access))
+		return FROZEN_DATA_ACCESS;
+
+	const char* end = operations + length;
+	while (operations < end)
+	{
+		error = LTNSJournalNext(operations, end, &operation, &keys, &keys_length, &term, &term_length, &next);
+		RETURN_VAL_IF(error);
+		error = LTNSDataAccessApplyOperation(data_access, operation, keys, keys + keys_length, term, term_length);
+		RETURN_VAL_IF(error);
+		operations = next;
+	}
+
+	return 0;
 }
 
 static LTNSError LTNSDataAccessAdd(LTNSDataAccess* data_access, const char* key, LTNSTerm* value_term)
@@ -443,6 +945,7 @@ static LTNSError LTNSDataAccessShrink(LTNSDataAccess* data_access, char* tail_st
 
 	/* Update prefixes */
 	LTNSDataAccess *root = LTNSDataAccessGetRoot(data_access);
+	LTNS_PROBE2(shrink__entry, root->length, length_delta);
 	long total_length_delta = 0;
 	LTNSError error = LTNSDataAccessUpdatePrefixes(data_access, length_delta, 0, root, &total_length_delta);
 	RETURN_VAL_IF(error);
@@ -454,6 +957,7 @@ static LTNSError LTNSDataAccessShrink(LTNSDataAccess* data_access, char* tail_st
 	/* Move tail */
 	size_t tail_length = (root->tnetstring + root->length - length_delta + 1) - tail_start;
 	memmove(tail_start + length_delta, tail_start, tail_length);
+	LTNS_STATS_ADD(bytes_moved, tail_length);
 
 	/* Realloc root tnetstring */
 	error = LTNSDataAccessReallocTNetstring(root, root->length + 1);
@@ -463,7 +967,9 @@ static LTNSError LTNSDataAccessShrink(LTNSDataAccess* data_access, char* tail_st
 	tail_start = root->tnetstring + tail_offset;
 
 	/* Update offsets for every child after tail_start */
-	return LTNSDataAccessUpdateOffsets(root, length_delta, tail_start);
+	error = LTNSDataAccessUpdateOffsets(root, length_delta, tail_start);
+	LTNS_PROBE1(shrink__return, tail_length);
+	return error;
 }
 
 static LTNSError LTNSDataAccessExpand(LTNSDataAccess* data_access, char* tail_start, long length_delta)
@@ -472,6 +978,7 @@ static LTNSError LTNSDataAccessExpand(LTNSDataAccess* data_access, char* tail_st
 		return INVALID_ARGUMENT;
 
 	LTNSDataAccess *root = LTNSDataAccessGetRoot(data_access);
+	LTNS_PROBE2(expand__entry, root->length, length_delta);
 	size_t tail_offset = tail_start - root->tnetstring;
 
 	/* Realloc root tnetstring */
@@ -492,9 +999,12 @@ static LTNSError LTNSDataAccessExpand(LTNSDataAccess* data_access, char* tail_st
 	/* Move tail */
 	size_t tail_length = (root->tnetstring + root->length - length_delta + 1) - tail_start;
 	memmove(tail_start + length_delta, tail_start, tail_length);
+	LTNS_STATS_ADD(bytes_moved, tail_length);
 
 	/* Update offsets for every child after tail_start */
-	return LTNSDataAccessUpdateOffsets(root, length_delta, tail_start);
+	error = LTNSDataAccessUpdateOffsets(root, length_delta, tail_start);
+	LTNS_PROBE1(expand__return, tail_length);
+	return error;
 }
 
 static LTNSError LTNSDataAccessReallocTNetstring(LTNSDataAccess *data_access, size_t new_length)
@@ -505,6 +1015,7 @@ static LTNSError LTNSDataAccessReallocTNetstring(LTNSDataAccess *data_access, si
 	char* new_root_tnetstring = realloc(data_access->tnetstring,  new_length);
 	if (!new_root_tnetstring)
 		return OUT_OF_MEMORY;
+	LTNS_STATS_ADD(reallocs, 1);
 	data_access->tnetstring = new_root_tnetstring;
 	return LTNSDataAccessUpdateTNetstrings(data_access, data_access);
 }
@@ -539,53 +1050,17 @@ static LTNSError LTNSDataAccessAddChild(LTNSDataAccess* data_access, LTNSDataAcc
 
 static LTNSError LTNSDataAccessFindKeyPosition(LTNSDataAccess* data_access, const char* key, char** position, char** next)
 {
-	LTNSError error = 0;
-	LTNSTerm* term;
 	char* payload;
-	size_t payload_len;
-	size_t key_len = strlen(key);
-	size_t term_len;
-	char* tnetstring;
+	size_t payload_length;
 	char* end = data_access->tnetstring + data_access->length;
 
-
 	/* Skip the tnetstring pointer ahead of the prefix to the payload */
-	error = LTNSDataAccessAsTerm(data_access, &term);
+	LTNSError error = LTNSTermScan(data_access->tnetstring, end, &payload, &payload_length, NULL);
 	RETURN_VAL_IF(error);
-	error = LTNSTermGetPayload(term, &tnetstring, NULL, NULL);
-	RETURN_VAL_IF(LTNSTermDestroy(term));
-	RETURN_VAL_IF(error);
-
-	while (!error && tnetstring < end - 1)
-	{
-		error = LTNSTermCreateNested(&term, tnetstring, end);
-		RETURN_VAL_IF(error);
-		error = LTNSTermGetPayload(term, &payload, &payload_len, NULL);
-		RETURN_VAL_IF(LTNSTermDestroy(term));
-		RETURN_VAL_IF(error);
 
-		/* Check the parsed key matches search key */
-		if (key_len == payload_len && !memcmp(payload, key, key_len))
-		{
-			*position = tnetstring;
-			*next = payload + payload_len + 1;
-			return 0;
-		}
-		/* Skip key */
-		tnetstring = payload + payload_len + 1;
-		if (tnetstring > end)
-			break;
-		/* Get length of value term */
-		error = LTNSTermCreateNested(&term, tnetstring, end);
-		RETURN_VAL_IF(error);
-		error = LTNSTermGetTNetstring(term, NULL, &term_len);
-		RETURN_VAL_IF(LTNSTermDestroy(term));
-		RETURN_VAL_IF(error);
-		/* Skip key's value */
-		tnetstring += term_len;
-	}
-
-	return KEY_NOT_FOUND;
+	error = LTNSTermFindKey(payload, payload + payload_length, key, strlen(key), position, next);
+	LTNS_STATS_ADD(bytes_scanned, error ? payload_length : (size_t)(*next - payload));
+	return error;
 }
 
 static LTNSError LTNSDataAccessFindValueTerm(LTNSDataAccess* data_access, const char* key, LTNSTerm** term)
@@ -657,6 +1132,8 @@ static LTNSError LTNSDataAccessUpdatePrefixes(LTNSDataAccess* data_access, long
 		// previous recursions, so we need to add all previous shifts
 		size_t shift_length = (root->tnetstring + root->length + prefix_length_deltas + 1) - colon;
 		memmove(colon + prefix_length_delta, colon, shift_length);
+		LTNS_STATS_ADD(bytes_moved, shift_length);
+		LTNS_STATS_ADD(prefix_width_changes, 1);
 	}
 
 	// Write new prefix
@@ -686,6 +1163,7 @@ static LTNSError LTNSDataAccessUpdateOffsets(LTNSDataAccess* data_access, long o
 {
 	if (!data_access || offset_delta == 0)
 		return INVALID_ARGUMENT;
+	LTNS_STATS_ADD(nodes_visited, 1);
 
 	/* Only update children after point_of_change && never update root */
 	if (data_access->tnetstring > point_of_change && IS_CHILD(data_access))
@@ -757,6 +1235,10 @@ static int LTNSDataAccessIsChildValid(LTNSDataAccess* data_access)
 {
 	if (!data_access)
 		return FALSE;
+	/* Nothing gets orphaned in frozen trees and their child lists may be
+	 * changed by other threads releasing children cached before the freeze */
+	if (LTNSDataAccessIsFrozenTree(data_access))
+		return TRUE;
 
 	LTNSDataAccess* child = data_access;
 	LTNSDataAccess* parent = data_access->parent;
@@ -798,3 +1280,417 @@ static void LTNSDataAccessDeleteChildAt(LTNSDataAccess* data_access, char* posit
 		node = node->next;
 	}
 }
+
+/* Changing a dictionary changes the bytes of all enclosing dictionaries */
+static void LTNSDataAccessOrphanChildren(LTNSDataAccess* data_access)
+{
+	LTNSChildNode *to_delete, *node = data_access->children;
+	while (node)
+	{
+		/* Orphan the child */
+		node->child->parent = NULL;
+		to_delete = node;
+		node = node->next;
+		free(to_delete);
+	}
+	data_access->children = NULL;
+}
+
+static void LTNSDataAccessInvalidateHash(LTNSDataAccess* data_access)
+{
+	while (data_access)
+	{
+		data_access->hash_valid = FALSE;
+		data_access = data_access->parent;
+	}
+}
+
+static int LTNSDataAccessTermsEquivalent(const char* term, const char* term_end, const char* other, const char* other_end)
+{
+	char *payload, *other_payload;
+	size_t length, other_length;
+	LTNSType type, other_type;
+
+	if (LTNSTermScan(term, term_end, &payload, &length, &type) ||
+		LTNSTermScan(other, other_end, &other_payload, &other_length, &other_type))
+		return FALSE;
+	if (type != other_type)
+		return FALSE;
+	if (length == other_length && !memcmp(payload, other_payload, length))
+		return TRUE;
+
+	char* end = payload + length;
+	char* other_payload_end = other_payload + other_length;
+	char *position, *other_position;
+	char *key, *value, *other_value;
+	size_t key_length, value_length;
+	size_t pairs = 0, other_pairs = 0;
+
+	switch (type)
+	{
+	case LTNS_DICTIONARY:
+		/* Every key must map to an equivalent value in the other dictionary */
+		for (position = payload; position < end; pairs++)
+		{
+			if (LTNSTermScan(position, end, &key, &key_length, NULL))
+				return FALSE;
+			value = key + key_length + 1;
+			if (LTNSTermScan(value, end, &position, &value_length, NULL))
+				return FALSE;
+			position += value_length + 1;
+
+			if (LTNSTermFindKey(other_payload, other_payload_end, key, key_length, NULL, &other_value))
+				return FALSE;
+			if (!LTNSDataAccessTermsEquivalent(value, end, other_value, other_payload_end))
+				return FALSE;
+		}
+		/* ... and there must not be any extra keys */
+		for (other_position = other_payload; other_position < other_payload_end; other_pairs++)
+		{
+			if (LTNSTermScan(other_position, other_payload_end, &key, &key_length, NULL))
+				return FALSE;
+			value = key + key_length + 1;
+			if (LTNSTermScan(value, other_payload_end, &other_position, &value_length, NULL))
+				return FALSE;
+			other_position += value_length + 1;
+		}
+		return pairs == other_pairs;
+	case LTNS_LIST:
+		/* Lists keep their order but may contain dictionaries */
+		position = payload;
+		other_position = other_payload;
+		while (position < end && other_position < other_payload_end)
+		{
+			if (!LTNSDataAccessTermsEquivalent(position, end, other_position, other_payload_end))
+				return FALSE;
+			LTNSTermScan(position, end, &value, &value_length, NULL);
+			position = value + value_length + 1;
+			LTNSTermScan(other_position, other_payload_end, &value, &value_length, NULL);
+			other_position = value + value_length + 1;
+		}
+		return position == end && other_position == other_payload_end;
+	default:
+		return FALSE;
+	}
+}
+
+/* Appends the change to the root's journal, if it has one. The path is
+ * found by looking up each child's key in its parent. */
+static LTNSError LTNSDataAccessRecord(LTNSDataAccess* data_access, LTNSJournalOperation operation, const char* key, LTNSTerm* term)
+{
+	LTNSDataAccess *root = LTNSDataAccessGetRoot(data_access);
+	char* tnetstring = NULL;
+	size_t length = 0, depth = 0;
+	LTNSError error;
+
+	if (!root || !root->journal)
+		return 0;
+
+	error = LTNSDataAccessPath(data_access, NULL, NULL, &depth);
+	RETURN_VAL_IF(error);
+	depth++;
+
+	/* Documents may nest arbitrarily deep, the path isn't kept on the stack */
+	const char** keys = (const char**)malloc((sizeof(char*) + sizeof(size_t)) * depth);
+	if (!keys)
+		return OUT_OF_MEMORY;
+	size_t* key_lengths = (size_t*)(keys + depth);
+	error = LTNSDataAccessPath(data_access, keys, key_lengths, &depth);
+	if (!error)
+	{
+		keys[depth] = key;
+		key_lengths[depth] = strlen(key);
+		depth++;
+
+		if (term)
+			LTNSTermGetTNetstring(term, &tnetstring, &length);
+		error = LTNSJournalRecord(root->journal, operation, keys, key_lengths, depth, tnetstring, length);
+	}
+
+	free(keys);
+	return error;
+}
+
+static LTNSError LTNSDataAccessKeyOf(LTNSDataAccess* data_access, const char* value_position, const char** key, size_t* key_length)
+{
+	char *payload, *key_payload, *value;
+	size_t payload_length, value_length;
+	const char* tnet_end = data_access->tnetstring + data_access->length;
+
+	LTNSError error = LTNSTermScan(data_access->tnetstring, tnet_end, &payload, &payload_length, NULL);
+	RETURN_VAL_IF(error);
+
+	const char* position = payload;
+	const char* payload_end = payload + payload_length;
+	while (position < payload_end)
+	{
+		error = LTNSTermScan(position, payload_end, &key_payload, key_length, NULL);
+		RETURN_VAL_IF(error);
+		position = key_payload + *key_length + 1;
+		if (position == value_position)
+		{
+			*key = key_payload;
+			return 0;
+		}
+		error = LTNSTermScan(position, payload_end, &value, &value_length, NULL);
+		RETURN_VAL_IF(error);
+		position = value + value_length + 1;
+	}
+
+	return INVALID_CHILD;
+}
+
+static LTNSError LTNSDataAccessApplyOperation(LTNSDataAccess* data_access, LTNSJournalOperation operation,
+		const char* keys, const char* keys_end, char* term, size_t term_length)
+{
+	LTNSTerm* value_term = NULL;
+	LTNSDataAccess* child = NULL;
+	char* key;
+	size_t key_length;
+	LTNSType type;
+
+	LTNSError error = LTNSTermScan(keys, keys_end, &key, &key_length, &type);
+	RETURN_VAL_IF(error);
+	if (type != LTNS_STRING)
+		return INVALID_TNETSTRING;
+
+	/* Keys come from the caller's journal and may be of any length */
+	char* key_copy = (char*)malloc(key_length + 1);
+	if (!key_copy)
+		return OUT_OF_MEMORY;
+	memcpy(key_copy, key, key_length);
+	key_copy[key_length] = '\0';
+
+	/* Walk down the path, the last key is the one that changes */
+	const char* rest = key + key_length + 1;
+	if (rest < keys_end)
+	{
+		error = LTNSDataAccessGet(data_access, key_copy, &value_term);
+		free(key_copy);
+		RETURN_VAL_IF(error);
+		error = LTNSDataAccessCreateNested(&child, data_access, value_term);
+		LTNSTermDestroy(value_term);
+		RETURN_VAL_IF(error);
+		error = LTNSDataAccessApplyOperation(child, operation, rest, keys_end, term, term_length);
+		LTNSDataAccessDestroy(child);
+		return error;
+	}
+
+	if (operation == LTNS_JOURNAL_REMOVE)
+	{
+		/* Replaying a remove twice is fine */
+		error = LTNSDataAccessRemove(data_access, key_copy);
+		free(key_copy);
+		return error == KEY_NOT_FOUND ? 0 : error;
+	}
+
+	error = LTNSTermCreateNested(&value_term, term, term + term_length);
+	if (!error)
+	{
+		error = LTNSDataAccessSet(data_access, key_copy, value_term);
+		LTNSTermDestroy(value_term);
+	}
+	free(key_copy);
+
+	return error;
+}
+
+/* Writes the merged dictionary payload to out. Keys keep the order of
+ * payload, keys only found in other are appended. If changed is given the
+ * offsets in out of all keys taken from other are stored there. */
+static LTNSError LTNSDataAccessMergePayloads(const char* payload, const char* payload_end,
+		const char* other, const char* other_end, LTNSMergePolicy policy, LTNSBuffer* out, LTNSBuffer* changed)
+{
+	char *key, *value, *value_payload, *other_key, *other_value, *other_payload;
+	size_t key_length, value_length, other_length, key_offset, mark;
+	const char *position, *value_end, *other_value_end;
+	LTNSType type, other_type;
+	LTNSError error;
+
+	for (position = payload; position < payload_end; position = value_end)
+	{
+		error = LTNSTermScan(position, payload_end, &key, &key_length, &type);
+		RETURN_VAL_IF(error);
+		if (type != LTNS_STRING)
+			return INVALID_TNETSTRING;
+		value = key + key_length + 1;
+		error = LTNSTermScan(value, payload_end, &value_payload, &value_length, &type);
+		RETURN_VAL_IF(error);
+		value_end = value_payload + value_length + 1;
+
+		error = LTNSTermFindKey(other, other_end, key, key_length, &other_key, &other_value);
+		if (error == KEY_NOT_FOUND || (!error && policy == LTNS_MERGE_KEEP))
+		{
+			error = LTNSBufferAppend(out, position, value_end - position);
+			RETURN_VAL_IF(error);
+			continue;
+		}
+		RETURN_VAL_IF(error);
+
+		error = LTNSTermScan(other_value, other_end, &other_payload, &other_length, &other_type);
+		RETURN_VAL_IF(error);
+		other_value_end = other_payload + other_length + 1;
+
+		key_offset = out->length;
+		error = LTNSBufferAppend(out, position, value - position);
+		RETURN_VAL_IF(error);
+		if (policy == LTNS_MERGE_DEEP && type == LTNS_DICTIONARY && other_type == LTNS_DICTIONARY)
+		{
+			error = LTNSBufferBeginTerm(out, &mark);
+			RETURN_VAL_IF(error);
+			error = LTNSDataAccessMergePayloads(value_payload, value_payload + value_length,
+					other_payload, other_payload + other_length, policy, out, NULL);
+			RETURN_VAL_IF(error);
+			error = LTNSBufferEndTerm(out, mark, LTNS_DICTIONARY);
+		}
+		else
+			error = LTNSBufferAppend(out, other_value, other_value_end - other_value);
+		RETURN_VAL_IF(error);
+
+		if (changed)
+		{
+			error = LTNSBufferAppend(changed, (const char*)&key_offset, sizeof(key_offset));
+			RETURN_VAL_IF(error);
+		}
+	}
+
+	/* Keys only other has */
+	for (position = other; position < other_end; position = value_end)
+	{
+		error = LTNSTermScan(position, other_end, &key, &key_length, &type);
+		RETURN_VAL_IF(error);
+		if (type != LTNS_STRING)
+			return INVALID_TNETSTRING;
+		value = key + key_length + 1;
+		error = LTNSTermScan(value, other_end, &value_payload, &value_length, NULL);
+		RETURN_VAL_IF(error);
+		value_end = value_payload + value_length + 1;
+
+		error = LTNSTermFindKey(payload, payload_end, key, key_length, &other_key, &other_value);
+		if (!error)
+			continue;
+		if (error != KEY_NOT_FOUND)
+			return error;
+
+		key_offset = out->length;
+		error = LTNSBufferAppend(out, position, value_end - position);
+		RETURN_VAL_IF(error);
+		if (changed)
+		{
+			error = LTNSBufferAppend(changed, (const char*)&key_offset, sizeof(key_offset));
+			RETURN_VAL_IF(error);
+		}
+	}
+
+	return 0;
+}
+
+/* Journals a merge as sets of every key that changed */
+static LTNSError LTNSDataAccessRecordMerge(LTNSDataAccess* data_access, LTNSBuffer* merged, LTNSBuffer* changed)
+{
+	char *key, *value, *value_payload;
+	size_t key_length, value_length, key_offset, i;
+	LTNSTerm* term = NULL;
+	LTNSError error;
+
+	const char* end = merged->data + merged->length;
+	for (i = 0; i < changed->length; i += sizeof(size_t))
+	{
+		memcpy(&key_offset, changed->data + i, sizeof(size_t));
+		error = LTNSTermScan(merged->data + key_offset, end, &key, &key_length, NULL);
+		RETURN_VAL_IF(error);
+		value = key + key_length + 1;
+		error = LTNSTermScan(value, end, &value_payload, &value_length, NULL);
+		RETURN_VAL_IF(error);
+
+		/* Merged keys may be of any length, they are copied to the heap */
+		char* key_copy = (char*)malloc(key_length + 1);
+		if (!key_copy)
+			return OUT_OF_MEMORY;
+		memcpy(key_copy, key, key_length);
+		key_copy[key_length] = '\0';
+
+		error = LTNSTermCreateNested(&term, value, value_payload + value_length + 1);
+		if (!error)
+		{
+			error = LTNSDataAccessRecord(data_access, LTNS_JOURNAL_SET, key_copy, term);
+			LTNSTermDestroy(term);
+		}
+		free(key_copy);
+		RETURN_VAL_IF(error);
+	}
+
+	return 0;
+}
+
+/* Copies the values selected by the active paths from a dictionary payload.
+ * Paths sharing a key at depth end up in the same nested dictionary. The
+ * rows of done and group flags follow the active ones in flags. */
+static LTNSError LTNSDataAccessProjectPayload(const char* payload, const char* payload_end,
+		const LTNSPath* paths, size_t path_count, char* flags, size_t depth, LTNSBuffer* out)
+{
+	char *key_position, *value, *value_payload;
+	size_t value_length, start, mark, i, j;
+	LTNSType type;
+	LTNSError error;
+
+	const char* active = flags;
+	char* done = flags + path_count;
+	char* group = done + path_count;
+	memset(done, FALSE, path_count);
+
+	for (i = 0; i < path_count; i++)
+	{
+		if (!active[i] || done[i] || paths[i].length <= depth)
+			continue;
+
+		const char* key = paths[i].keys[depth];
+		int whole_value = FALSE;
+		memset(group, FALSE, path_count);
+		for (j = i; j < path_count; j++)
+		{
+			if (!active[j] || done[j] || paths[j].length <= depth || strcmp(paths[j].keys[depth], key))
+				continue;
+			group[j] = done[j] = TRUE;
+			if (paths[j].length == depth + 1)
+				whole_value = TRUE;
+		}
+
+		error = LTNSTermFindKey(payload, payload_end, key, strlen(key), &key_position, &value);
+		if (error == KEY_NOT_FOUND)
+			continue;
+		RETURN_VAL_IF(error);
+		error = LTNSTermScan(value, payload_end, &value_payload, &value_length, &type);
+		RETURN_VAL_IF(error);
+
+		/* The whole value covers every longer path with the same key */
+		if (whole_value)
+		{
+			error = LTNSBufferAppend(out, key_position, (value_payload + value_length + 1) - key_position);
+			RETURN_VAL_IF(error);
+			continue;
+		}
+		if (type != LTNS_DICTIONARY)
+			continue;
+
+		start = out->length;
+		error = LTNSBufferAppend(out, key_position, value - key_position);
+		RETURN_VAL_IF(error);
+		error = LTNSBufferBeginTerm(out, &mark);
+		RETURN_VAL_IF(error);
+		size_t nested_start = out->length;
+		error = LTNSDataAccessProjectPayload(value_payload, value_payload + value_length, paths, path_count, group, depth + 1, out);
+		RETURN_VAL_IF(error);
+
+		/* Leave out dictionaries where nothing was found */
+		if (out->length == nested_start)
+		{
+			out->length = start;
+			continue;
+		}
+		error = LTNSBufferEndTerm(out, mark, LTNS_DICTIONARY);
+		RETURN_VAL_IF(error);
+	}
+
+	return 0;
+}
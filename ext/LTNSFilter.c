@@ -0,0 +1,644 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "LTNSFilter.h"
+
+/* Bounds parentheses and negations, the only constructs parsed and
+ * evaluated recursively. Chains of || and && are handled in loops. */
+#define MAX_FILTER_NESTING 64
+#define MAX_NUMBER_LENGTH 64
+#define IS_IDENTIFIER_START(c) (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z') || (c) == '_')
+#define IS_IDENTIFIER_CHAR(c) (IS_IDENTIFIER_START(c) || ((c) >= '0' && (c) <= '9') || (c) == '-')
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+typedef enum
+{
+	FILTER_OR,
+	FILTER_AND,
+	FILTER_NOT,
+	FILTER_COMPARE,
+	FILTER_TRUTHY
+} LTNSFilterNodeType;
+
+typedef enum
+{
+	COMPARE_EQUAL,
+	COMPARE_NOT_EQUAL,
+	COMPARE_LESS,
+	COMPARE_LESS_EQUAL,
+	COMPARE_GREATER,
+	COMPARE_GREATER_EQUAL
+} LTNSFilterComparison;
+
+/* Either a key path or a literal in tnetstring payload form */
+typedef struct
+{
+	int is_path;
+	LTNSPath path;
+	LTNSType type;
+	const char* payload;
+	size_t payload_length;
+} LTNSFilterOperand;
+
+typedef struct
+{
+	LTNSFilterNodeType type;
+	LTNSFilterComparison comparison;
+	size_t left;
+	size_t right;
+	LTNSFilterOperand operands[2];
+} LTNSFilterNode;
+
+struct _LTNSFilter
+{
+	LTNSFilterNode* nodes;
+	size_t node_count;
+	size_t root;
+	const char** keys;
+	size_t key_count;
+	char* strings;
+	size_t strings_length;
+};
+
+typedef struct
+{
+	const char* position;
+	const char* end;
+	LTNSFilter* filter;
+	int depth;
+} LTNSFilterParser;
+
+static LTNSError LTNSFilterParseOr(LTNSFilterParser* parser, size_t* node);
+static LTNSError LTNSFilterParseAnd(LTNSFilterParser* parser, size_t* node);
+static LTNSError LTNSFilterParseChain(LTNSFilterParser* parser, LTNSFilterNodeType type, const char* token,
+		LTNSError (*parse_operand)(LTNSFilterParser*, size_t*), size_t* node);
+static LTNSError LTNSFilterParseUnary(LTNSFilterParser* parser, size_t* node);
+static LTNSError LTNSFilterParseComparison(LTNSFilterParser* parser, size_t* node);
+static LTNSError LTNSFilterParseOperand(LTNSFilterParser* parser, LTNSFilterOperand* operand);
+static LTNSError LTNSFilterParseString(LTNSFilterParser* parser, LTNSFilterOperand* operand);
+static LTNSError LTNSFilterParseNumber(LTNSFilterParser* parser, LTNSFilterOperand* operand);
+static LTNSError LTNSFilterParsePath(LTNSFilterParser* parser, LTNSFilterOperand* operand);
+static LTNSError LTNSFilterAddNode(LTNSFilterParser* parser, LTNSFilterNodeType type, size_t* node);
+static int LTNSFilterConsume(LTNSFilterParser* parser, const char* token);
+static void LTNSFilterSkipWhitespace(LTNSFilterParser* parser);
+
+static LTNSError LTNSFilterEvaluate(LTNSFilter* filter, size_t node, const char* tnetstring, const char* tnet_end, int* result);
+static LTNSError LTNSFilterResolve(LTNSFilterOperand* operand, const char* tnetstring, const char* tnet_end,
+		LTNSType* type, const char** payload, size_t* payload_length);
+static int LTNSFilterCompare(LTNSFilterComparison comparison, LTNSType type, const char* payload, size_t length,
+		LTNSType other_type, const char* other, size_t other_length);
+static int LTNSFilterParseDouble(const char* payload, size_t length, double* value);
+static int LTNSFilterParseInteger(const char* payload, size_t length, long long* value);
+
+LTNSError LTNSFilterCreate(LTNSFilter** filter, const char* expression, size_t length)
+{
+	LTNSFilterParser parser;
+
+	if (!filter || !expression)
+		return INVALID_ARGUMENT;
+
+	*filter = (LTNSFilter*)calloc(1, sizeof(LTNSFilter));
+	if (!*filter)
+		return OUT_OF_MEMORY;
+
+	/* Every node, key and literal takes up at least one character of the
+	 * expression, so these never need to grow */
+	(*filter)->nodes = (LTNSFilterNode*)calloc(length + 1, sizeof(LTNSFilterNode));
+	(*filter)->keys = (const char**)calloc(length + 1, sizeof(char*));
+	(*filter)->strings = (char*)malloc(2 * length + 1);
+	if (!(*filter)->nodes || !(*filter)->keys || !(*filter)->strings)
+	{
+		LTNSFilterDestroy(*filter);
+		*filter = NULL;
+		return OUT_OF_MEMORY;
+	}
+
+	parser.position = expression;
+	parser.end = expression + length;
+	parser.filter = *filter;
+	parser.depth = 0;
+
+	LTNSError error = LTNSFilterParseOr(&parser, &(*filter)->root);
+	LTNSFilterSkipWhitespace(&parser);
+	if (!error && parser.position != parser.end)
+		error = INVALID_FILTER;
+	if (error)
+	{
+		LTNSFilterDestroy(*filter);
+		*filter = NULL;
+	}
+
+	return error;
+}
+
+LTNSError LTNSFilterDestroy(LTNSFilter* filter)
+{
+	if (!filter)
+		return INVALID_ARGUMENT;
+
+	free(filter->nodes);
+	free(filter->keys);
+	free(filter->strings);
+	free(filter);
+
+	return 0;
+}
+
+LTNSError LTNSFilterMatch(LTNSFilter* filter, const char* tnetstring, size_t length, int* match)
+{
+	char* payload;
+	size_t payload_length;
+	LTNSType type;
+
+	if (!filter || !tnetstring || !match)
+		return INVALID_ARGUMENT;
+
+	LTNSError error = LTNSTermScan(tnetstring, tnetstring + length, &payload, &payload_length, &type);
+	RETURN_VAL_IF(error);
+	if (payload + payload_length + 1 != tnetstring + length)
+		return INVALID_TNETSTRING;
+	if (type != LTNS_DICTIONARY)
+		return UNSUPPORTED_TOP_LEVEL_DATA_STRUCTURE;
+
+	return LTNSFilterEvaluate(filter, filter->root, tnetstring, tnetstring + length, match);
+}
+
+/* Parsing */
+
+static LTNSError LTNSFilterParseOr(LTNSFilterParser* parser, size_t* node)
+{
+	return LTNSFilterParseChain(parser, FILTER_OR, "||", LTNSFilterParseAnd, node);
+}
+
+static LTNSError LTNSFilterParseAnd(LTNSFilterParser* parser, size_t* node)
+{
+	return LTNSFilterParseChain(parser, FILTER_AND, "&&", LTNSFilterParseUnary, node);
+}
+
+/* Chains lean right, a || b || c becomes a || (b || c), so that evaluation
+ * follows them in a loop however long they are */
+static LTNSError LTNSFilterParseChain(LTNSFilterParser* parser, LTNSFilterNodeType type, const char* token,
+		LTNSError (*parse_operand)(LTNSFilterParser*, size_t*), size_t* node)
+{
+	size_t operand, link, last = SIZE_MAX;
+	LTNSError error;
+
+	for (;;)
+	{
+		error = parse_operand(parser, &operand);
+		RETURN_VAL_IF(error);
+
+		link = operand;
+		if (LTNSFilterConsume(parser, token))
+		{
+			error = LTNSFilterAddNode(parser, type, &link);
+			RETURN_VAL_IF(error);
+			parser->filter->nodes[link].left = operand;
+		}
+
+		if (last == SIZE_MAX)
+			*node = link;
+		else
+			parser->filter->nodes[last].right = link;
+		if (link == operand)
+			return 0;
+		last = link;
+	}
+}
+
+static LTNSError LTNSFilterParseUnary(LTNSFilterParser* parser, size_t* node)
+{
+	size_t operand;
+	LTNSError error;
+
+	if (++parser->depth > MAX_FILTER_NESTING)
+		return INVALID_FILTER;
+
+	/* "!=" is only valid after an operand, so "!" here is always a not */
+	if (LTNSFilterConsume(parser, "!"))
+	{
+		error = LTNSFilterParseUnary(parser, &operand);
+		RETURN_VAL_IF(error);
+		error = LTNSFilterAddNode(parser, FILTER_NOT, node);
+		RETURN_VAL_IF(error);
+		parser->filter->nodes[*node].left = operand;
+	}
+	else if (LTNSFilterConsume(parser, "("))
+	{
+		error = LTNSFilterParseOr(parser, node);
+		RETURN_VAL_IF(error);
+		if (!LTNSFilterConsume(parser, ")"))
+			return INVALID_FILTER;
+	}
+	else
+	{
+		error = LTNSFilterParseComparison(parser, node);
+		RETURN_VAL_IF(error);
+	}
+
+	parser->depth--;
+	return 0;
+}
+
+static LTNSError LTNSFilterParseComparison(LTNSFilterParser* parser, size_t* node)
+{
+	static const struct
+	{
+		const char* token;
+		LTNSFilterComparison comparison;
+	} operators[] = {
+		{ "==", COMPARE_EQUAL },
+		{ "!=", COMPARE_NOT_EQUAL },
+		{ "<=", COMPARE_LESS_EQUAL },
+		{ ">=", COMPARE_GREATER_EQUAL },
+		{ "<", COMPARE_LESS },
+		{ ">", COMPARE_GREATER }
+	};
+	LTNSFilterOperand left;
+	size_t i;
+
+	LTNSError error = LTNSFilterParseOperand(parser, &left);
+	RETURN_VAL_IF(error);
+
+	for (i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+	{
+		if (!LTNSFilterConsume(parser, operators[i].token))
+			continue;
+
+		error = LTNSFilterAddNode(parser, FILTER_COMPARE, node);
+		RETURN_VAL_IF(error);
+		LTNSFilterNode* compare = &parser->filter->nodes[*node];
+		compare->comparison = operators[i].comparison;
+		compare->operands[0] = left;
+		return LTNSFilterParseOperand(parser, &compare->operands[1]);
+	}
+
+	/* A path on its own tests for a truthy value */
+	if (!left.is_path)
+		return INVALID_FILTER;
+	error = LTNSFilterAddNode(parser, FILTER_TRUTHY, node);
+	RETURN_VAL_IF(error);
+	parser->filter->nodes[*node].operands[0] = left;
+
+	return 0;
+}
+
+static LTNSError LTNSFilterParseOperand(LTNSFilterParser* parser, LTNSFilterOperand* operand)
+{
+	static const struct
+	{
+		const char* word;
+		LTNSType type;
+		const char* payload;
+	} literals[] = {
+		{ "true", LTNS_BOOLEAN, "true" },
+		{ "false", LTNS_BOOLEAN, "false" },
+		{ "null", LTNS_NULL, "" }
+	};
+	size_t i;
+
+	LTNSFilterSkipWhitespace(parser);
+	if (parser->position >= parser->end)
+		return INVALID_FILTER;
+
+	memset(operand, 0, sizeof(LTNSFilterOperand));
+	char c = *parser->position;
+	if (c == '"' || c == '\'')
+		return LTNSFilterParseString(parser, operand);
+	if (c == '-' || IS_DIGIT(c))
+		return LTNSFilterParseNumber(parser, operand);
+
+	for (i = 0; i < sizeof(literals) / sizeof(literals[0]); i++)
+	{
+		size_t length = strlen(literals[i].word);
+		if ((size_t)(parser->end - parser->position) >= length &&
+			!memcmp(parser->position, literals[i].word, length) &&
+			(parser->position + length == parser->end || !IS_IDENTIFIER_CHAR(parser->position[length])))
+		{
+			parser->position += length;
+			operand->type = literals[i].type;
+			operand->payload = literals[i].payload;
+			operand->payload_length = strlen(literals[i].payload);
+			return 0;
+		}
+	}
+
+	return LTNSFilterParsePath(parser, operand);
+}
+
+/* Single or double quoted, backslash escapes the next character */
+static LTNSError LTNSFilterParseString(LTNSFilterParser* parser, LTNSFilterOperand* operand)
+{
+	LTNSFilter* filter = parser->filter;
+	char quote = *parser->position++;
+	char* string = filter->strings + filter->strings_length;
+	size_t length = 0;
+
+	while (parser->position < parser->end && *parser->position != quote)
+	{
+		if (*parser->position == '\\')
+		{
+			parser->position++;
+			if (parser->position >= parser->end)
+				return INVALID_FILTER;
+		}
+		string[length++] = *parser->position++;
+	}
+	if (parser->position >= parser->end)
+		return INVALID_FILTER;
+	parser->position++;
+
+	string[length] = '\0';
+	filter->strings_length += length + 1;
+	operand->type = LTNS_STRING;
+	operand->payload = string;
+	operand->payload_length = length;
+
+	return 0;
+}
+
+static LTNSError LTNSFilterParseNumber(LTNSFilterParser* parser, LTNSFilterOperand* operand)
+{
+	LTNSFilter* filter = parser->filter;
+	const char* start = parser->position;
+	LTNSType type = LTNS_INTEGER;
+
+	if (*parser->position == '-')
+		parser->position++;
+	if (parser->position >= parser->end || !IS_DIGIT(*parser->position))
+		return INVALID_FILTER;
+	while (parser->position < parser->end && IS_DIGIT(*parser->position))
+		parser->position++;
+	if (parser->position < parser->end && *parser->position == '.')
+	{
+		type = LTNS_FLOAT;
+		parser->position++;
+		if (parser->position >= parser->end || !IS_DIGIT(*parser->position))
+			return INVALID_FILTER;
+		while (parser->position < parser->end && IS_DIGIT(*parser->position))
+			parser->position++;
+	}
+
+	size_t length = parser->position - start;
+	if (length >= MAX_NUMBER_LENGTH)
+		return INVALID_FILTER;
+
+	char* string = filter->strings + filter->strings_length;
+	memcpy(string, start, length);
+	string[length] = '\0';
+	filter->strings_length += length + 1;
+	operand->type = type;
+	operand->payload = string;
+	operand->payload_length = length;
+
+	return 0;
+}
+
+/* key(.key)*, keys are identifiers or quoted strings */
+static LTNSError LTNSFilterParsePath(LTNSFilterParser* parser, LTNSFilterOperand* operand)
+{
+	LTNSFilter* filter = parser->filter;
+	LTNSFilterOperand key;
+	LTNSError error;
+
+	operand->is_path = TRUE;
+	operand->path.keys = filter->keys + filter->key_count;
+	operand->path.length = 0;
+
+	for (;;)
+	{
+		LTNSFilterSkipWhitespace(parser);
+		if (parser->position >= parser->end)
+			return INVALID_FILTER;
+
+		if (*parser->position == '"' || *parser->position == '\'')
+		{
+			error = LTNSFilterParseString(parser, &key);
+			RETURN_VAL_IF(error);
+			filter->keys[filter->key_count++] = key.payload;
+		}
+		else
+		{
+			const char* start = parser->position;
+			if (!IS_IDENTIFIER_START(*parser->position))
+				return INVALID_FILTER;
+			while (parser->position < parser->end && IS_IDENTIFIER_CHAR(*parser->position))
+				parser->position++;
+
+			size_t length = parser->position - start;
+			char* string = filter->strings + filter->strings_length;
+			memcpy(string, start, length);
+			string[length] = '\0';
+			filter->strings_length += length + 1;
+			filter->keys[filter->key_count++] = string;
+		}
+		operand->path.length++;
+
+		LTNSFilterSkipWhitespace(parser);
+		if (parser->position >= parser->end || *parser->position != '.')
+			break;
+		parser->position++;
+	}
+
+	return 0;
+}
+
+static LTNSError LTNSFilterAddNode(LTNSFilterParser* parser, LTNSFilterNodeType type, size_t* node)
+{
+	*node = parser->filter->node_count++;
+	parser->filter->nodes[*node].type = type;
+	return 0;
+}
+
+static int LTNSFilterConsume(LTNSFilterParser* parser, const char* token)
+{
+	size_t length = strlen(token);
+
+	LTNSFilterSkipWhitespace(parser);
+	if ((size_t)(parser->end - parser->position) < length || memcmp(parser->position, token, length))
+		return FALSE;
+	/* Don't mistake the start of "!=" for a not */
+	if (length == 1 && token[0] == '!' && parser->position + 1 < parser->end && parser->position[1] == '=')
+		return FALSE;
+
+	parser->position += length;
+	return TRUE;
+}
+
+static void LTNSFilterSkipWhitespace(LTNSFilterParser* parser)
+{
+	while (parser->position < parser->end &&
+		(*parser->position == ' ' || *parser->position == '\t' || *parser->position == '\n' || *parser->position == '\r'))
+		parser->position++;
+}
+
+/* Evaluation */
+
+static LTNSError LTNSFilterEvaluate(LTNSFilter* filter, size_t node, const char* tnetstring, const char* tnet_end, int* result)
+{
+	LTNSFilterNode* current = &filter->nodes[node];
+	const char *payload, *other;
+	size_t length, other_length;
+	LTNSType type, other_type;
+	LTNSError error;
+
+	/* The right operand decides the result unless the left one short
+	 * circuits, so chains are followed here rather than recursed into */
+	while (current->type == FILTER_OR || current->type == FILTER_AND)
+	{
+		error = LTNSFilterEvaluate(filter, current->left, tnetstring, tnet_end, result);
+		RETURN_VAL_IF(error);
+		if (*result == (current->type == FILTER_OR))
+			return 0;
+		current = &filter->nodes[current->right];
+	}
+
+	switch (current->type)
+	{
+	case FILTER_OR:
+	case FILTER_AND:
+		/* Followed by the loop above */
+		break;
+	case FILTER_NOT:
+		error = LTNSFilterEvaluate(filter, current->left, tnetstring, tnet_end, result);
+		*result = !*result;
+		return error;
+	case FILTER_TRUTHY:
+		error = LTNSFilterResolve(&current->operands[0], tnetstring, tnet_end, &type, &payload, &length);
+		RETURN_VAL_IF(error);
+		*result = type != LTNS_UNDEFINED && type != LTNS_NULL &&
+			!(type == LTNS_BOOLEAN && length == 5 && !memcmp(payload, "false", 5));
+		return 0;
+	case FILTER_COMPARE:
+		error = LTNSFilterResolve(&current->operands[0], tnetstring, tnet_end, &type, &payload, &length);
+		RETURN_VAL_IF(error);
+		error = LTNSFilterResolve(&current->operands[1], tnetstring, tnet_end, &other_type, &other, &other_length);
+		RETURN_VAL_IF(error);
+		*result = LTNSFilterCompare(current->comparison, type, payload, length, other_type, other, other_length);
+		return 0;
+	}
+
+	return INVALID_FILTER;
+}
+
+/* *type is LTNS_UNDEFINED and the payload empty for missing paths */
+static LTNSError LTNSFilterResolve(LTNSFilterOperand* operand, const char* tnetstring, const char* tnet_end,
+		LTNSType* type, const char** payload, size_t* payload_length)
+{
+	char *value, *value_payload;
+
+	if (!operand->is_path)
+	{
+		*type = operand->type;
+		*payload = operand->payload;
+		*payload_length = operand->payload_length;
+		return 0;
+	}
+
+	LTNSError error = LTNSTermGetPath(tnetstring, tnet_end, &operand->path, &value);
+	if (error == KEY_NOT_FOUND)
+	{
+		*type = LTNS_UNDEFINED;
+		*payload = NULL;
+		*payload_length = 0;
+		return 0;
+	}
+	RETURN_VAL_IF(error);
+
+	error = LTNSTermScan(value, tnet_end, &value_payload, payload_length, type);
+	*payload = value_payload;
+	return error;
+}
+
+static int LTNSFilterCompare(LTNSFilterComparison comparison, LTNSType type, const char* payload, size_t length,
+		LTNSType other_type, const char* other, size_t other_length)
+{
+	int order;
+
+	if (type == LTNS_UNDEFINED || other_type == LTNS_UNDEFINED)
+		return FALSE;
+
+	int numeric = (type == LTNS_INTEGER || type == LTNS_FLOAT) && (other_type == LTNS_INTEGER || other_type == LTNS_FLOAT);
+	if (numeric && type == LTNS_INTEGER && other_type == LTNS_INTEGER)
+	{
+		long long value, other_value;
+		if (!LTNSFilterParseInteger(payload, length, &value) || !LTNSFilterParseInteger(other, other_length, &other_value))
+			return FALSE;
+		order = (value > other_value) - (value < other_value);
+	}
+	else if (numeric)
+	{
+		double value, other_value;
+		if (!LTNSFilterParseDouble(payload, length, &value) || !LTNSFilterParseDouble(other, other_length, &other_value))
+			return FALSE;
+		order = (value > other_value) - (value < other_value);
+	}
+	else if (type == other_type && type == LTNS_STRING)
+	{
+		order = memcmp(payload, other, MIN(length, other_length));
+		if (order == 0)
+			order = (length > other_length) - (length < other_length);
+	}
+	else if (type == other_type && (type == LTNS_BOOLEAN || type == LTNS_NULL))
+	{
+		/* Only equality makes sense here */
+		int equal = length == other_length && !memcmp(payload, other, length);
+		if (comparison == COMPARE_EQUAL)
+			return equal;
+		if (comparison == COMPARE_NOT_EQUAL)
+			return !equal;
+		return FALSE;
+	}
+	else
+	{
+		/* Lists, dictionaries and mismatched types are never equal */
+		return comparison == COMPARE_NOT_EQUAL;
+	}
+
+	switch (comparison)
+	{
+	case COMPARE_EQUAL:
+		return order == 0;
+	case COMPARE_NOT_EQUAL:
+		return order != 0;
+	case COMPARE_LESS:
+		return order < 0;
+	case COMPARE_LESS_EQUAL:
+		return order <= 0;
+	case COMPARE_GREATER:
+		return order > 0;
+	case COMPARE_GREATER_EQUAL:
+		return order >= 0;
+	}
+
+	return FALSE;
+}
+
+static int LTNSFilterParseDouble(const char* payload, size_t length, double* value)
+{
+	char number[MAX_NUMBER_LENGTH];
+	char* end;
+
+	if (length == 0 || length >= MAX_NUMBER_LENGTH)
+		return FALSE;
+	memcpy(number, payload, length);
+	number[length] = '\0';
+	*value = strtod(number, &end);
+
+	return end == number + length;
+}
+
+static int LTNSFilterParseInteger(const char* payload, size_t length, long long* value)
+{
+	char number[MAX_NUMBER_LENGTH];
+	char* end;
+
+	if (length == 0 || length >= MAX_NUMBER_LENGTH)
+		return FALSE;
+	memcpy(number, payload, length);
+	number[length] = '\0';
+	*value = strtoll(number, &end, 10);
+
+	return end == number + length;
+}
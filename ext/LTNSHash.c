@@ -0,0 +1,104 @@
+#include <string.h>
+
+#include "LTNSHash.h"
+
+#define PRIME64_1 11400714785074694791ULL
+#define PRIME64_2 14029467366897019727ULL
+#define PRIME64_3  1609587929392839161ULL
+#define PRIME64_4  9650029242287828579ULL
+#define PRIME64_5  2870177450012600261ULL
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline uint64_t LTNSHashRead64(const char* p)
+{
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint32_t LTNSHashRead32(const char* p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint64_t LTNSHashRound(uint64_t accumulator, uint64_t input)
+{
+	accumulator += input * PRIME64_2;
+	accumulator = ROTL64(accumulator, 31);
+	return accumulator * PRIME64_1;
+}
+
+static inline uint64_t LTNSHashMergeRound(uint64_t accumulator, uint64_t value)
+{
+	accumulator ^= LTNSHashRound(0, value);
+	return accumulator * PRIME64_1 + PRIME64_4;
+}
+
+/* NOTE: reads little endian words, hashes differ on big endian machines */
+uint64_t LTNSHash64(const char* data, size_t length, uint64_t seed)
+{
+	const char* p = data;
+	const char* end = data + length;
+	uint64_t hash;
+
+	if (length >= 32)
+	{
+		const char* limit = end - 32;
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+
+		do
+		{
+			v1 = LTNSHashRound(v1, LTNSHashRead64(p));
+			v2 = LTNSHashRound(v2, LTNSHashRead64(p + 8));
+			v3 = LTNSHashRound(v3, LTNSHashRead64(p + 16));
+			v4 = LTNSHashRound(v4, LTNSHashRead64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		hash = ROTL64(v1, 1) + ROTL64(v2, 7) + ROTL64(v3, 12) + ROTL64(v4, 18);
+		hash = LTNSHashMergeRound(hash, v1);
+		hash = LTNSHashMergeRound(hash, v2);
+		hash = LTNSHashMergeRound(hash, v3);
+		hash = LTNSHashMergeRound(hash, v4);
+	}
+	else
+	{
+		hash = seed + PRIME64_5;
+	}
+
+	hash += (uint64_t)length;
+
+	while (p + 8 <= end)
+	{
+		hash ^= LTNSHashRound(0, LTNSHashRead64(p));
+		hash = ROTL64(hash, 27) * PRIME64_1 + PRIME64_4;
+		p += 8;
+	}
+	if (p + 4 <= end)
+	{
+		hash ^= (uint64_t)LTNSHashRead32(p) * PRIME64_1;
+		hash = ROTL64(hash, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	while (p < end)
+	{
+		hash ^= (uint64_t)(unsigned char)*p * PRIME64_5;
+		hash = ROTL64(hash, 11) * PRIME64_1;
+		p++;
+	}
+
+	/* Avalanche */
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
@@ -0,0 +1,364 @@
+#include <errno.h>
+#include <string.h>
+
+#include "LTNSIndex.h"
+
+/* Longest number payload parsed, longer ones compare by their bytes */
+#define MAX_NUMBER_LENGTH 64
+#define MIN_CAPACITY 16
+
+typedef struct
+{
+	const char* value; // NOTE: the whole term, owned by the index unless it's a bound
+	size_t length;
+	const char* payload;
+	size_t payload_length;
+	LTNSType type;
+	int is_integer; // NOTE: integer holds the value exactly, else number does
+	int is_number;
+	long long integer;
+	double number;
+} LTNSIndexValue;
+
+struct _LTNSIndex
+{
+	LTNSPath path;
+	/* By document number, value is NULL for documents not indexed */
+	LTNSIndexValue* values;
+	size_t capacity;
+	/* Indexed documents by value, then by number */
+	size_t* order;
+	size_t count;
+};
+
+static LTNSError LTNSIndexReserve(LTNSIndex* index, size_t document);
+static LTNSError LTNSIndexRead(const char* tnetstring, const char* tnet_end, LTNSIndexValue* value);
+static int LTNSIndexRank(LTNSType type);
+static int LTNSIndexCompareValues(const LTNSIndexValue* value, const LTNSIndexValue* other);
+static int LTNSIndexCompareMixed(long long integer, double number);
+static int LTNSIndexCompare(LTNSIndex* index, size_t document, size_t other);
+static size_t LTNSIndexPosition(LTNSIndex* index, size_t document);
+static size_t LTNSIndexSearch(LTNSIndex* index, const LTNSIndexValue* bound, int after);
+
+LTNSError LTNSIndexCreate(LTNSIndex** index, const LTNSPath* path)
+{
+	if (!index || !path || (path->length && !path->keys))
+		return INVALID_ARGUMENT;
+
+	/* The keys are copied behind their pointers, in one allocation */
+	size_t i, size = sizeof(char*) * path->length;
+	for (i = 0; i < path->length; i++)
+		size += strlen(path->keys[i]) + 1;
+
+	*index = (LTNSIndex*)calloc(1, sizeof(LTNSIndex));
+	if (!*index)
+		return OUT_OF_MEMORY;
+	const char** keys = (const char**)malloc(size ? size : 1);
+	if (!keys)
+	{
+		free(*index);
+		*index = NULL;
+		return OUT_OF_MEMORY;
+	}
+
+	char* key = (char*)(keys + path->length);
+	for (i = 0; i < path->length; i++)
+	{
+		size = strlen(path->keys[i]) + 1;
+		memcpy(key, path->keys[i], size);
+		keys[i] = key;
+		key += size;
+	}
+	(*index)->path.keys = keys;
+	(*index)->path.length = path->length;
+
+	return 0;
+}
+
+LTNSError LTNSIndexDestroy(LTNSIndex* index)
+{
+	if (!index)
+		return INVALID_ARGUMENT;
+
+	size_t i;
+	for (i = 0; i < index->capacity; i++)
+		free((char*)index->values[i].value);
+	free(index->values);
+	free(index->order);
+	free((void*)index->path.keys);
+	free(index);
+	return 0;
+}
+
+LTNSError LTNSIndexUpdate(LTNSIndex* index, size_t document, const char* tnetstring, size_t length)
+{
+	if (!index || !tnetstring)
+		return INVALID_ARGUMENT;
+
+	char* found;
+	LTNSError error = LTNSTermGetPath(tnetstring, tnetstring + length, &index->path, &found);
+	if (error == KEY_NOT_FOUND)
+		return LTNSIndexRemove(index, document);
+	RETURN_VAL_IF(error);
+
+	LTNSIndexValue value;
+	error = LTNSIndexRead(found, tnetstring + length, &value);
+	RETURN_VAL_IF(error);
+
+	error = LTNSIndexReserve(index, document);
+	RETURN_VAL_IF(error);
+	LTNSIndexValue* current = &index->values[document];
+	if (current->value && current->length == value.length && !memcmp(current->value, value.value, value.length))
+		return 0;
+
+	char* copy = (char*)malloc(value.length);
+	if (!copy)
+		return OUT_OF_MEMORY;
+	memcpy(copy, value.value, value.length);
+	value.payload = copy + (value.payload - value.value);
+	value.value = copy;
+
+	LTNSIndexRemove(index, document);
+	*current = value;
+
+	size_t position = LTNSIndexPosition(index, document);
+	memmove(index->order + position + 1, index->order + position, sizeof(size_t) * (index->count - position));
+	index->order[position] = document;
+	index->count++;
+
+	return 0;
+}
+
+LTNSError LTNSIndexRemove(LTNSIndex* index, size_t document)
+{
+	if (!index)
+		return INVALID_ARGUMENT;
+	if (document >= index->capacity || !index->values[document].value)
+		return 0;
+
+	size_t position = LTNSIndexPosition(index, document);
+	memmove(index->order + position, index->order + position + 1, sizeof(size_t) * (index->count - position - 1));
+	index->count--;
+
+	free((char*)index->values[document].value);
+	index->values[document].value = NULL;
+	return 0;
+}
+
+LTNSError LTNSIndexCount(LTNSIndex* index, size_t* count)
+{
+	if (!index || !count)
+		return INVALID_ARGUMENT;
+
+	*count = index->count;
+	return 0;
+}
+
+LTNSError LTNSIndexFind(LTNSIndex* index, const LTNSIndexBound* low, const LTNSIndexBound* high,
+		size_t* first, size_t* last)
+{
+	if (!index || !first || !last)
+		return INVALID_ARGUMENT;
+	if ((low && !low->tnetstring) || (high && !high->tnetstring))
+		return INVALID_ARGUMENT;
+
+	LTNSIndexValue bound;
+	LTNSError error;
+
+	*first = 0;
+	if (low)
+	{
+		error = LTNSIndexRead(low->tnetstring, low->tnetstring + low->length, &bound);
+		RETURN_VAL_IF(error);
+		*first = LTNSIndexSearch(index, &bound, low->exclusive);
+	}
+
+	*last = index->count;
+	if (high)
+	{
+		error = LTNSIndexRead(high->tnetstring, high->tnetstring + high->length, &bound);
+		RETURN_VAL_IF(error);
+		*last = LTNSIndexSearch(index, &bound, !high->exclusive);
+	}
+
+	if (*last < *first)
+		*last = *first;
+	return 0;
+}
+
+LTNSError LTNSIndexDocument(LTNSIndex* index, size_t position, size_t* document)
+{
+	if (!index || !document || position >= index->count)
+		return INVALID_ARGUMENT;
+
+	*document = index->order[position];
+	return 0;
+}
+
+/* Makes room for the value of document. The order never holds more
+ * documents than there are values, so both grow together. */
+static LTNSError LTNSIndexReserve(LTNSIndex* index, size_t document)
+{
+	if (document < index->capacity)
+		return 0;
+
+	size_t capacity = index->capacity * 2;
+	if (capacity < MIN_CAPACITY)
+		capacity = MIN_CAPACITY;
+	if (capacity <= document)
+		capacity = document + 1;
+
+	/* Either array may end up larger than capacity when the other one can't
+	 * grow, capacity only changes once both have */
+	LTNSIndexValue* values = (LTNSIndexValue*)realloc(index->values, sizeof(LTNSIndexValue) * capacity);
+	if (!values)
+		return OUT_OF_MEMORY;
+	index->values = values;
+	size_t* order = (size_t*)realloc(index->order, sizeof(size_t) * capacity);
+	if (!order)
+		return OUT_OF_MEMORY;
+	index->order = order;
+
+	memset(values + index->capacity, 0, sizeof(LTNSIndexValue) * (capacity - index->capacity));
+	index->capacity = capacity;
+
+	return 0;
+}
+
+/* Scans the term at tnetstring and parses numbers once, so comparisons
+ * don't have to */
+static LTNSError LTNSIndexRead(const char* tnetstring, const char* tnet_end, LTNSIndexValue* value)
+{
+	char* payload;
+	LTNSError error = LTNSTermScan(tnetstring, tnet_end, &payload, &value->payload_length, &value->type);
+	RETURN_VAL_IF(error);
+
+	value->value = tnetstring;
+	value->payload = payload;
+	value->length = payload + value->payload_length + 1 - tnetstring;
+	value->is_integer = FALSE;
+	value->is_number = FALSE;
+	if (value->type != LTNS_INTEGER && value->type != LTNS_FLOAT)
+		return 0;
+	if (value->payload_length == 0 || value->payload_length >= MAX_NUMBER_LENGTH)
+		return 0;
+
+	char number[MAX_NUMBER_LENGTH];
+	char* end;
+	memcpy(number, payload, value->payload_length);
+	number[value->payload_length] = '\0';
+
+	if (value->type == LTNS_INTEGER)
+	{
+		errno = 0;
+		value->integer = strtoll(number, &end, 10);
+		value->is_integer = end == number + value->payload_length && errno != ERANGE;
+	}
+	value->number = strtod(number, &end);
+	value->is_number = end == number + value->payload_length && !isnan(value->number);
+	if (value->is_integer)
+		value->is_number = TRUE;
+
+	return 0;
+}
+
+static int LTNSIndexRank(LTNSType type)
+{
+	switch (type)
+	{
+	case LTNS_NULL:
+		return 0;
+	case LTNS_BOOLEAN:
+		return 1;
+	case LTNS_INTEGER:
+	case LTNS_FLOAT:
+		return 2;
+	case LTNS_STRING:
+		return 3;
+	case LTNS_LIST:
+		return 4;
+	default:
+		return 5;
+	}
+}
+
+static int LTNSIndexCompareValues(const LTNSIndexValue* value, const LTNSIndexValue* other)
+{
+	int rank = LTNSIndexRank(value->type), other_rank = LTNSIndexRank(other->type);
+	if (rank != other_rank)
+		return rank < other_rank ? -1 : 1;
+
+	if (value->is_integer && other->is_integer)
+		return (value->integer > other->integer) - (value->integer < other->integer);
+	/* Integers above 2^53 don't survive a conversion to double, so mixed
+	 * pairs are compared exactly too. Otherwise the order isn't transitive. */
+	if (value->is_integer && other->is_number)
+		return LTNSIndexCompareMixed(value->integer, other->number);
+	if (value->is_number && other->is_integer)
+		return -LTNSIndexCompareMixed(other->integer, value->number);
+	if (value->is_number && other->is_number)
+		return (value->number > other->number) - (value->number < other->number);
+	/* Numbers that don't parse come after those that do */
+	if (value->is_number != other->is_number)
+		return value->is_number ? -1 : 1;
+
+	int order = memcmp(value->payload, other->payload, MIN(value->payload_length, other->payload_length));
+	if (order)
+		return order < 0 ? -1 : 1;
+	return (value->payload_length > other->payload_length) - (value->payload_length < other->payload_length);
+}
+
+/* Compares without rounding: a double within the range of long long
+ * truncates exactly, and only its fraction decides against an equal integer */
+static int LTNSIndexCompareMixed(long long integer, double number)
+{
+	if (number >= 9223372036854775808.0)
+		return -1;
+	if (number < -9223372036854775808.0)
+		return 1;
+
+	long long truncated = (long long)number;
+	if (integer != truncated)
+		return integer < truncated ? -1 : 1;
+	return ((double)truncated < number) ? -1 : ((double)truncated > number);
+}
+
+static int LTNSIndexCompare(LTNSIndex* index, size_t document, size_t other)
+{
+	int order = LTNSIndexCompareValues(&index->values[document], &index->values[other]);
+	if (order)
+		return order;
+	return (document > other) - (document < other);
+}
+
+/* Where document goes in the order, or where it is if it's indexed */
+static size_t LTNSIndexPosition(LTNSIndex* index, size_t document)
+{
+	size_t low = 0, high = index->count, middle;
+	while (low < high)
+	{
+		middle = low + (high - low) / 2;
+		if (LTNSIndexCompare(index, index->order[middle], document) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
+
+/* The first position with a value after bound, or not before it */
+static size_t LTNSIndexSearch(LTNSIndex* index, const LTNSIndexValue* bound, int after)
+{
+	size_t low = 0, high = index->count, middle;
+	int order;
+	while (low < high)
+	{
+		middle = low + (high - low) / 2;
+		order = LTNSIndexCompareValues(&index->values[index->order[middle]], bound);
+		if (order < 0 || (after && order == 0))
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
+}
@@ -0,0 +1,195 @@
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "LTNSJournal.h"
+#include "LTNSTerm.h"
+
+#define OPERATION_SET "3:set,"
+#define OPERATION_REMOVE "6:remove,"
+
+struct _LTNSJournal
+{
+	LTNSBuffer operations;
+	int fd;
+};
+
+static LTNSError LTNSJournalAppendString(LTNSBuffer* buffer, const char* string, size_t length);
+static LTNSError LTNSJournalWrite(int fd, const char* data, size_t length);
+
+LTNSError LTNSJournalCreate(LTNSJournal** journal, int fd)
+{
+	if (!journal)
+		return INVALID_ARGUMENT;
+
+	*journal = (LTNSJournal*)calloc(1, sizeof(LTNSJournal));
+	if (!*journal)
+		return OUT_OF_MEMORY;
+
+	LTNSError error = LTNSBufferInit(&(*journal)->operations, 0);
+	if (error)
+	{
+		free(*journal);
+		*journal = NULL;
+		return error;
+	}
+	(*journal)->fd = fd;
+
+	return 0;
+}
+
+LTNSError LTNSJournalDestroy(LTNSJournal* journal)
+{
+	if (!journal)
+		return INVALID_ARGUMENT;
+
+	LTNSBufferDestroy(&journal->operations);
+	free(journal);
+
+	return 0;
+}
+
+LTNSError LTNSJournalRecord(LTNSJournal* journal, LTNSJournalOperation operation,
+		const char** keys, const size_t* key_lengths, size_t depth,
+		const char* term, size_t term_length)
+{
+	size_t mark, path_mark, start;
+	size_t i;
+	LTNSError error;
+
+	if (!journal || (depth > 0 && (!keys || !key_lengths)))
+		return INVALID_ARGUMENT;
+
+	LTNSBuffer* buffer = &journal->operations;
+	start = buffer->length;
+
+	error = LTNSBufferBeginTerm(buffer, &mark);
+	if (!error)
+	{
+		if (operation == LTNS_JOURNAL_SET)
+			error = LTNSBufferAppend(buffer, OPERATION_SET, strlen(OPERATION_SET));
+		else
+			error = LTNSBufferAppend(buffer, OPERATION_REMOVE, strlen(OPERATION_REMOVE));
+	}
+	if (!error)
+		error = LTNSBufferBeginTerm(buffer, &path_mark);
+	for (i = 0; !error && i < depth; i++)
+		error = LTNSJournalAppendString(buffer, keys[i], key_lengths[i]);
+	if (!error)
+		error = LTNSBufferEndTerm(buffer, path_mark, LTNS_LIST);
+	if (!error)
+	{
+		if (operation == LTNS_JOURNAL_SET && term)
+			error = LTNSBufferAppend(buffer, term, term_length);
+		else
+			error = LTNSBufferAppend(buffer, "0:~", 3);
+	}
+	if (!error)
+		error = LTNSBufferEndTerm(buffer, mark, LTNS_LIST);
+
+	if (!error && journal->fd >= 0)
+	{
+		/* Write-through mode keeps nothing in memory */
+		error = LTNSJournalWrite(journal->fd, buffer->data + start, buffer->length - start);
+		buffer->length = start;
+	}
+	if (error)
+		buffer->length = start;
+
+	return error;
+}
+
+LTNSError LTNSJournalGetOperations(LTNSJournal* journal, const char** operations, size_t* length)
+{
+	if (!journal || !operations || !length)
+		return INVALID_ARGUMENT;
+
+	*operations = journal->operations.data;
+	*length = journal->operations.length;
+
+	return 0;
+}
+
+LTNSError LTNSJournalClear(LTNSJournal* journal)
+{
+	if (!journal)
+		return INVALID_ARGUMENT;
+
+	journal->operations.length = 0;
+
+	return 0;
+}
+
+LTNSError LTNSJournalNext(const char* position, const char* end, LTNSJournalOperation* operation,
+		char** keys, size_t* keys_length, char** term, size_t* term_length, const char** next)
+{
+	char *payload, *name, *value;
+	size_t length, name_length, value_length;
+	LTNSType type;
+	LTNSError error;
+
+	if (!position || !end || !operation || !keys || !keys_length || !term || !term_length || !next)
+		return INVALID_ARGUMENT;
+
+	error = LTNSTermScan(position, end, &payload, &length, &type);
+	RETURN_VAL_IF(error);
+	if (type != LTNS_LIST)
+		return INVALID_TNETSTRING;
+	*next = payload + length + 1;
+	end = payload + length;
+
+	/* Operation name */
+	error = LTNSTermScan(payload, end, &name, &name_length, &type);
+	RETURN_VAL_IF(error);
+	if (type != LTNS_STRING)
+		return INVALID_TNETSTRING;
+	if (name_length == 3 && !memcmp(name, "set", 3))
+		*operation = LTNS_JOURNAL_SET;
+	else if (name_length == 6 && !memcmp(name, "remove", 6))
+		*operation = LTNS_JOURNAL_REMOVE;
+	else
+		return INVALID_TNETSTRING;
+
+	/* Path */
+	error = LTNSTermScan(name + name_length + 1, end, keys, keys_length, &type);
+	RETURN_VAL_IF(error);
+	if (type != LTNS_LIST || *keys_length == 0)
+		return INVALID_TNETSTRING;
+
+	/* New value */
+	*term = *keys + *keys_length + 1;
+	error = LTNSTermScan(*term, end, &value, &value_length, NULL);
+	RETURN_VAL_IF(error);
+	*term_length = (value + value_length + 1) - *term;
+
+	return 0;
+}
+
+static LTNSError LTNSJournalAppendString(LTNSBuffer* buffer, const char* string, size_t length)
+{
+	size_t mark;
+
+	LTNSError error = LTNSBufferBeginTerm(buffer, &mark);
+	RETURN_VAL_IF(error);
+	error = LTNSBufferAppend(buffer, string, length);
+	RETURN_VAL_IF(error);
+	return LTNSBufferEndTerm(buffer, mark, LTNS_STRING);
+}
+
+static LTNSError LTNSJournalWrite(int fd, const char* data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write(fd, data, length);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return IO_ERROR;
+		}
+		data += written;
+		length -= written;
+	}
+
+	return 0;
+}
@@ -0,0 +1,718 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "LTNSJson.h"
+
+#define ONES_64 0x0101010101010101ULL
+#define HIGHS_64 0x8080808080808080ULL
+/* Non-zero if any byte of x is zero */
+#define HAS_ZERO_BYTE(x) (((x) - ONES_64) & ~(x) & HIGHS_64)
+/* Non-zero if any byte of x is smaller than n (n <= 128) */
+#define HAS_BYTE_LESS(x, n) (((x) - ONES_64 * (n)) & ~(x) & HIGHS_64)
+/* Bounds recursion on hostile input */
+#define MAX_JSON_NESTING 512
+
+typedef struct
+{
+	const char* position;
+	const char* end;
+	LTNSBuffer* out;
+	int depth;
+} LTNSJsonParser;
+
+static LTNSError LTNSJsonWriteTerm(const char* tnetstring, const char* end, LTNSBuffer* out, const char** term_end);
+static LTNSError LTNSJsonWriteDictionary(const char* payload, size_t length, LTNSJsonFilter filter, const char** keys, size_t key_count, LTNSBuffer* out);
+static LTNSError LTNSJsonWriteList(const char* payload, size_t length, LTNSBuffer* out);
+static LTNSError LTNSJsonWriteString(const char* payload, size_t length, LTNSBuffer* out);
+static LTNSError LTNSJsonWriteNumber(const char* payload, size_t length, LTNSBuffer* out);
+static size_t LTNSJsonFindEscape(const char* string, size_t length);
+static size_t LTNSJsonUTF8Length(const unsigned char* string, size_t length);
+static const char* LTNSJsonScanNumber(const char* position, const char* end, LTNSType* type);
+static int LTNSJsonKeySelected(const char* key, size_t key_length, LTNSJsonFilter filter, const char** keys, size_t key_count);
+
+static LTNSError LTNSJsonParseValue(LTNSJsonParser* parser);
+static LTNSError LTNSJsonParseObject(LTNSJsonParser* parser);
+static LTNSError LTNSJsonParseArray(LTNSJsonParser* parser);
+static LTNSError LTNSJsonParseString(LTNSJsonParser* parser);
+static LTNSError LTNSJsonParseNumber(LTNSJsonParser* parser);
+static LTNSError LTNSJsonParseLiteral(LTNSJsonParser* parser, const char* literal, const char* tnetstring);
+static LTNSError LTNSJsonParseHex(LTNSJsonParser* parser, unsigned int* code_point);
+static LTNSError LTNSJsonAppendUTF8(LTNSBuffer* out, unsigned int code_point);
+static void LTNSJsonSkipWhitespace(LTNSJsonParser* parser);
+
+static const char hex_digits[] = "0123456789abcdef";
+
+LTNSError LTNSTermToJSON(LTNSTerm* term, LTNSBuffer* out)
+{
+	char* tnetstring;
+	size_t length;
+	const char* term_end;
+
+	if (!term || !out)
+		return INVALID_ARGUMENT;
+
+	LTNSError error = LTNSTermGetTNetstring(term, &tnetstring, &length);
+	RETURN_VAL_IF(error);
+
+	return LTNSJsonWriteTerm(tnetstring, tnetstring + length, out, &term_end);
+}
+
+LTNSError LTNSTermToJSONFiltered(LTNSTerm* term, LTNSJsonFilter filter, const char** keys, size_t key_count, LTNSBuffer* out)
+{
+	char* payload;
+	size_t length;
+	LTNSType type;
+
+	if (!term || !out || (filter != LTNS_JSON_ALL && key_count > 0 && !keys))
+		return INVALID_ARGUMENT;
+
+	LTNSError error = LTNSTermGetPayload(term, &payload, &length, &type);
+	RETURN_VAL_IF(error);
+	if (type != LTNS_DICTIONARY)
+		return INVALID_ARGUMENT;
+
+	return LTNSJsonWriteDictionary(payload, length, filter, keys, key_count, out);
+}
+
+LTNSError LTNSDataAccessToJSON(LTNSDataAccess* data_access, LTNSJsonFilter filter, const char** keys, size_t key_count, LTNSBuffer* out)
+{
+	LTNSTerm* term = NULL;
+
+	if (!data_access)
+		return INVALID_ARGUMENT;
+
+	LTNSError error = LTNSDataAccessAsTerm(data_access, &term);
+	RETURN_VAL_IF(error);
+	error = LTNSTermToJSONFiltered(term, filter, keys, key_count, out);
+	LTNSTermDestroy(term);
+
+	return error;
+}
+
+static LTNSError LTNSJsonWriteTerm(const char* tnetstring, const char* end, LTNSBuffer* out, const char** term_end)
+{
+	char* payload;
+	size_t length;
+	LTNSType type;
+
+	LTNSError error = LTNSTermScan(tnetstring, end, &payload, &length, &type);
+	RETURN_VAL_IF(error);
+	*term_end = payload + length + 1;
+
+	switch (type)
+	{
+	case LTNS_STRING:
+		return LTNSJsonWriteString(payload, length, out);
+	case LTNS_INTEGER:
+	case LTNS_FLOAT:
+		return LTNSJsonWriteNumber(payload, length, out);
+	case LTNS_BOOLEAN:
+		if (length == 4 && !memcmp(payload, "true", 4))
+			return LTNSBufferAppend(out, "true", 4);
+		if (length == 5 && !memcmp(payload, "false", 5))
+			return LTNSBufferAppend(out, "false", 5);
+		return INVALID_TNETSTRING;
+	case LTNS_NULL:
+		return LTNSBufferAppend(out, "null", 4);
+	case LTNS_LIST:
+		return LTNSJsonWriteList(payload, length, out);
+	case LTNS_DICTIONARY:
+		return LTNSJsonWriteDictionary(payload, length, LTNS_JSON_ALL, NULL, 0, out);
+	default:
+		return INVALID_TNETSTRING;
+	}
+}
+
+static LTNSError LTNSJsonWriteDictionary(const char* payload, size_t length, LTNSJsonFilter filter, const char** keys, size_t key_count, LTNSBuffer* out)
+{
+	const char* position = payload;
+	const char* end = payload + length;
+	char* key;
+	size_t key_length;
+	LTNSType key_type;
+	int first = TRUE;
+
+	LTNSError error = LTNSBufferAppendChar(out, '{');
+	RETURN_VAL_IF(error);
+
+	while (position < end)
+	{
+		error = LTNSTermScan(position, end, &key, &key_length, &key_type);
+		RETURN_VAL_IF(error);
+		if (key_type != LTNS_STRING)
+			return INVALID_TNETSTRING;
+		position = key + key_length + 1;
+
+		if (!LTNSJsonKeySelected(key, key_length, filter, keys, key_count))
+		{
+			/* Skip the value without transcoding it */
+			char* value;
+			size_t value_length;
+			error = LTNSTermScan(position, end, &value, &value_length, NULL);
+			RETURN_VAL_IF(error);
+			position = value + value_length + 1;
+			continue;
+		}
+
+		if (!first)
+		{
+			error = LTNSBufferAppendChar(out, ',');
+			RETURN_VAL_IF(error);
+		}
+		first = FALSE;
+
+		error = LTNSJsonWriteString(key, key_length, out);
+		RETURN_VAL_IF(error);
+		error = LTNSBufferAppendChar(out, ':');
+		RETURN_VAL_IF(error);
+		error = LTNSJsonWriteTerm(position, end, out, &position);
+		RETURN_VAL_IF(error);
+	}
+
+	return LTNSBufferAppendChar(out, '}');
+}
+
+static LTNSError LTNSJsonWriteList(const char* payload, size_t length, LTNSBuffer* out)
+{
+	const char* position = payload;
+	const char* end = payload + length;
+
+	LTNSError error = LTNSBufferAppendChar(out, '[');
+	RETURN_VAL_IF(error);
+
+	while (position < end)
+	{
+		if (position != payload)
+		{
+			error = LTNSBufferAppendChar(out, ',');
+			RETURN_VAL_IF(error);
+		}
+		error = LTNSJsonWriteTerm(position, end, out, &position);
+		RETURN_VAL_IF(error);
+	}
+
+	return LTNSBufferAppendChar(out, ']');
+}
+
+static LTNSError LTNSJsonWriteString(const char* payload, size_t length, LTNSBuffer* out)
+{
+	/* Room for the string without escapes, each escape reserves its own */
+	LTNSError error = LTNSBufferReserve(out, length + 2);
+	RETURN_VAL_IF(error);
+	out->data[out->length++] = '"';
+
+	while (length > 0)
+	{
+		/* Copy the run of bytes that need no escaping in one go */
+		size_t run = LTNSJsonFindEscape(payload, length);
+		memcpy(out->data + out->length, payload, run);
+		out->length += run;
+		payload += run;
+		length -= run;
+		if (length == 0)
+			break;
+
+		/* Multibyte characters are copied as they are once they are known
+		 * to be valid UTF-8, the JSON is tagged as such */
+		if ((unsigned char)*payload >= 0x80)
+		{
+			size_t sequence = LTNSJsonUTF8Length((const unsigned char*)payload, length);
+			if (!sequence)
+				return INVALID_TNETSTRING;
+			memcpy(out->data + out->length, payload, sequence);
+			out->length += sequence;
+			payload += sequence;
+			length -= sequence;
+			continue;
+		}
+
+		unsigned char c = (unsigned char)*payload++;
+		length--;
+		/* At most a six byte \u00XX escape, then the rest and the quote */
+		error = LTNSBufferReserve(out, 6 + length + 1);
+		RETURN_VAL_IF(error);
+		char* dest = out->data + out->length;
+		*dest++ = '\\';
+		switch (c)
+		{
+		case '"':  *dest++ = '"'; break;
+		case '\\': *dest++ = '\\'; break;
+		case '\b': *dest++ = 'b'; break;
+		case '\f': *dest++ = 'f'; break;
+		case '\n': *dest++ = 'n'; break;
+		case '\r': *dest++ = 'r'; break;
+		case '\t': *dest++ = 't'; break;
+		default:
+			*dest++ = 'u';
+			*dest++ = '0';
+			*dest++ = '0';
+			*dest++ = hex_digits[c >> 4];
+			*dest++ = hex_digits[c & 0xf];
+		}
+		out->length = dest - out->data;
+	}
+
+	out->data[out->length++] = '"';
+
+	return 0;
+}
+
+static LTNSError LTNSJsonWriteNumber(const char* payload, size_t length, LTNSBuffer* out)
+{
+	LTNSType type;
+
+	/* Reject payloads JSON can't represent, e.g. Infinity, NaN or +5 */
+	if (LTNSJsonScanNumber(payload, payload + length, &type) != payload + length)
+		return INVALID_TNETSTRING;
+
+	return LTNSBufferAppend(out, payload, length);
+}
+
+/* Returns the length of the prefix of string that can be copied verbatim,
+ * checking eight bytes per step. Stops at bytes outside ASCII too. */
+static size_t LTNSJsonFindEscape(const char* string, size_t length)
+{
+	size_t i = 0;
+	uint64_t word;
+
+	for (; i + 8 <= length; i += 8)
+	{
+		memcpy(&word, string + i, 8);
+		if ((word & HIGHS_64) ||
+			HAS_BYTE_LESS(word, 0x20) ||
+			HAS_ZERO_BYTE(word ^ (ONES_64 * '"')) ||
+			HAS_ZERO_BYTE(word ^ (ONES_64 * '\\')))
+			break;
+	}
+
+	for (; i < length; i++)
+	{
+		unsigned char c = (unsigned char)string[i];
+		if (c < 0x20 || c == '"' || c == '\\' || c >= 0x80)
+			return i;
+	}
+
+	return length;
+}
+
+/* Returns the length of the UTF-8 sequence string starts with, 0 for
+ * invalid, overlong or surrogate encodings */
+static size_t LTNSJsonUTF8Length(const unsigned char* string, size_t length)
+{
+	unsigned char min = 0x80, max = 0xbf;
+	size_t sequence, i;
+
+	if (string[0] >= 0xc2 && string[0] <= 0xdf)
+		sequence = 2;
+	else if (string[0] >= 0xe0 && string[0] <= 0xef)
+	{
+		sequence = 3;
+		if (string[0] == 0xe0)
+			min = 0xa0;
+		else if (string[0] == 0xed)
+			max = 0x9f;
+	}
+	else if (string[0] >= 0xf0 && string[0] <= 0xf4)
+	{
+		sequence = 4;
+		if (string[0] == 0xf0)
+			min = 0x90;
+		else if (string[0] == 0xf4)
+			max = 0x8f;
+	}
+	else
+		return 0;
+
+	if (length < sequence || string[1] < min || string[1] > max)
+		return 0;
+	for (i = 2; i < sequence; i++)
+		if (string[i] < 0x80 || string[i] > 0xbf)
+			return 0;
+
+	return sequence;
+}
+
+static int LTNSJsonKeySelected(const char* key, size_t key_length, LTNSJsonFilter filter, const char** keys, size_t key_count)
+{
+	size_t i;
+	int found = FALSE;
+
+	if (filter == LTNS_JSON_ALL)
+		return TRUE;
+
+	for (i = 0; i < key_count && !found; i++)
+		found = strlen(keys[i]) == key_length && !memcmp(keys[i], key, key_length);
+
+	return filter == LTNS_JSON_ONLY ? found : !found;
+}
+
+LTNSError LTNSJsonToTNetstring(const char* json, size_t length, LTNSBuffer* out)
+{
+	LTNSJsonParser parser;
+
+	if (!json || !out)
+		return INVALID_ARGUMENT;
+
+	parser.position = json;
+	parser.end = json + length;
+	parser.out = out;
+	parser.depth = 0;
+
+	size_t start = out->length;
+	LTNSJsonSkipWhitespace(&parser);
+	LTNSError error = LTNSJsonParseValue(&parser);
+	if (!error)
+	{
+		LTNSJsonSkipWhitespace(&parser);
+		if (parser.position != parser.end)
+			error = INVALID_JSON;
+	}
+	/* Don't leave half written terms behind */
+	if (error)
+		out->length = start;
+
+	return error;
+}
+
+static LTNSError LTNSJsonParseValue(LTNSJsonParser* parser)
+{
+	if (parser->position >= parser->end)
+		return INVALID_JSON;
+
+	switch (*parser->position)
+	{
+	case '{':
+		return LTNSJsonParseObject(parser);
+	case '[':
+		return LTNSJsonParseArray(parser);
+	case '"':
+		return LTNSJsonParseString(parser);
+	case 't':
+		return LTNSJsonParseLiteral(parser, "true", "4:true!");
+	case 'f':
+		return LTNSJsonParseLiteral(parser, "false", "5:false!");
+	case 'n':
+		return LTNSJsonParseLiteral(parser, "null", "0:~");
+	default:
+		return LTNSJsonParseNumber(parser);
+	}
+}
+
+static LTNSError LTNSJsonParseObject(LTNSJsonParser* parser)
+{
+	size_t mark;
+	LTNSError error;
+
+	if (++parser->depth > MAX_JSON_NESTING)
+		return INVALID_JSON;
+
+	error = LTNSBufferBeginTerm(parser->out, &mark);
+	RETURN_VAL_IF(error);
+
+	parser->position++; // skip '{'
+	LTNSJsonSkipWhitespace(parser);
+	if (parser->position < parser->end && *parser->position == '}')
+	{
+		parser->position++;
+		parser->depth--;
+		return LTNSBufferEndTerm(parser->out, mark, LTNS_DICTIONARY);
+	}
+
+	while (TRUE)
+	{
+		/* Keys are always strings */
+		if (parser->position >= parser->end || *parser->position != '"')
+			return INVALID_JSON;
+		error = LTNSJsonParseString(parser);
+		RETURN_VAL_IF(error);
+
+		LTNSJsonSkipWhitespace(parser);
+		if (parser->position >= parser->end || *parser->position != ':')
+			return INVALID_JSON;
+		parser->position++;
+		LTNSJsonSkipWhitespace(parser);
+
+		error = LTNSJsonParseValue(parser);
+		RETURN_VAL_IF(error);
+
+		LTNSJsonSkipWhitespace(parser);
+		if (parser->position >= parser->end)
+			return INVALID_JSON;
+		if (*parser->position == '}')
+			break;
+		if (*parser->position != ',')
+			return INVALID_JSON;
+		parser->position++;
+		LTNSJsonSkipWhitespace(parser);
+	}
+
+	parser->position++; // skip '}'
+	parser->depth--;
+	return LTNSBufferEndTerm(parser->out, mark, LTNS_DICTIONARY);
+}
+
+static LTNSError LTNSJsonParseArray(LTNSJsonParser* parser)
+{
+	size_t mark;
+	LTNSError error;
+
+	if (++parser->depth > MAX_JSON_NESTING)
+		return INVALID_JSON;
+
+	error = LTNSBufferBeginTerm(parser->out, &mark);
+	RETURN_VAL_IF(error);
+
+	parser->position++; // skip '['
+	LTNSJsonSkipWhitespace(parser);
+	if (parser->position < parser->end && *parser->position == ']')
+	{
+		parser->position++;
+		parser->depth--;
+		return LTNSBufferEndTerm(parser->out, mark, LTNS_LIST);
+	}
+
+	while (TRUE)
+	{
+		error = LTNSJsonParseValue(parser);
+		RETURN_VAL_IF(error);
+
+		LTNSJsonSkipWhitespace(parser);
+		if (parser->position >= parser->end)
+			return INVALID_JSON;
+		if (*parser->position == ']')
+			break;
+		if (*parser->position != ',')
+			return INVALID_JSON;
+		parser->position++;
+		LTNSJsonSkipWhitespace(parser);
+	}
+
+	parser->position++; // skip ']'
+	parser->depth--;
+	return LTNSBufferEndTerm(parser->out, mark, LTNS_LIST);
+}
+
+static LTNSError LTNSJsonParseString(LTNSJsonParser* parser)
+{
+	size_t mark;
+	LTNSError error = LTNSBufferBeginTerm(parser->out, &mark);
+	RETURN_VAL_IF(error);
+
+	parser->position++; // skip '"'
+	while (TRUE)
+	{
+		/* Copy the run up to the next quote or escape in one go */
+		const char* run = parser->position;
+		while (parser->position < parser->end &&
+			*parser->position != '"' && *parser->position != '\\')
+		{
+			if ((unsigned char)*parser->position < 0x20)
+				return INVALID_JSON;
+			parser->position++;
+		}
+		error = LTNSBufferAppend(parser->out, run, parser->position - run);
+		RETURN_VAL_IF(error);
+
+		if (parser->position >= parser->end)
+			return INVALID_JSON;
+		if (*parser->position == '"')
+			break;
+
+		/* Escape sequence */
+		parser->position++;
+		if (parser->position >= parser->end)
+			return INVALID_JSON;
+		char c = *parser->position++;
+		switch (c)
+		{
+		case '"':
+		case '\\':
+		case '/':
+			error = LTNSBufferAppendChar(parser->out, c);
+			break;
+		case 'b': error = LTNSBufferAppendChar(parser->out, '\b'); break;
+		case 'f': error = LTNSBufferAppendChar(parser->out, '\f'); break;
+		case 'n': error = LTNSBufferAppendChar(parser->out, '\n'); break;
+		case 'r': error = LTNSBufferAppendChar(parser->out, '\r'); break;
+		case 't': error = LTNSBufferAppendChar(parser->out, '\t'); break;
+		case 'u':
+		{
+			unsigned int code_point;
+			error = LTNSJsonParseHex(parser, &code_point);
+			RETURN_VAL_IF(error);
+			/* Combine surrogate pairs */
+			if (code_point >= 0xD800 && code_point <= 0xDBFF)
+			{
+				unsigned int low;
+				if (parser->end - parser->position < 6 ||
+					parser->position[0] != '\\' || parser->position[1] != 'u')
+					return INVALID_JSON;
+				parser->position += 2;
+				error = LTNSJsonParseHex(parser, &low);
+				RETURN_VAL_IF(error);
+				if (low < 0xDC00 || low > 0xDFFF)
+					return INVALID_JSON;
+				code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+			}
+			else if (code_point >= 0xDC00 && code_point <= 0xDFFF)
+			{
+				return INVALID_JSON;
+			}
+			error = LTNSJsonAppendUTF8(parser->out, code_point);
+			break;
+		}
+		default:
+			return INVALID_JSON;
+		}
+		RETURN_VAL_IF(error);
+	}
+
+	parser->position++; // skip '"'
+	return LTNSBufferEndTerm(parser->out, mark, LTNS_STRING);
+}
+
+static LTNSError LTNSJsonParseNumber(LTNSJsonParser* parser)
+{
+	const char* start = parser->position;
+	LTNSType type;
+	char prefix[MAX_PREFIX_LENGTH + 2];
+
+	const char* p = LTNSJsonScanNumber(start, parser->end, &type);
+	if (!p)
+		return INVALID_JSON;
+
+	/* The number's text is its payload, so the length is known up front */
+	size_t length = p - start;
+	int prefix_length = snprintf(prefix, sizeof(prefix), "%zu:", length);
+	LTNSError error = LTNSBufferReserve(parser->out, prefix_length + length + 1);
+	RETURN_VAL_IF(error);
+	LTNSBufferAppend(parser->out, prefix, prefix_length);
+	LTNSBufferAppend(parser->out, start, length);
+	LTNSBufferAppendChar(parser->out, (char)type);
+
+	parser->position = p;
+	return 0;
+}
+
+/* Returns the end of the JSON number at position, NULL if there is none.
+ * *type tells integers from floats. */
+static const char* LTNSJsonScanNumber(const char* position, const char* end, LTNSType* type)
+{
+	const char* p = position;
+
+	*type = LTNS_INTEGER;
+	if (p < end && *p == '-')
+		p++;
+	if (p >= end || *p < '0' || *p > '9')
+		return NULL;
+	/* No leading zeros */
+	if (*p == '0')
+		p++;
+	else
+		while (p < end && *p >= '0' && *p <= '9')
+			p++;
+
+	if (p < end && *p == '.')
+	{
+		*type = LTNS_FLOAT;
+		p++;
+		if (p >= end || *p < '0' || *p > '9')
+			return NULL;
+		while (p < end && *p >= '0' && *p <= '9')
+			p++;
+	}
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		*type = LTNS_FLOAT;
+		p++;
+		if (p < end && (*p == '+' || *p == '-'))
+			p++;
+		if (p >= end || *p < '0' || *p > '9')
+			return NULL;
+		while (p < end && *p >= '0' && *p <= '9')
+			p++;
+	}
+
+	return p;
+}
+
+static LTNSError LTNSJsonParseLiteral(LTNSJsonParser* parser, const char* literal, const char* tnetstring)
+{
+	size_t length = strlen(literal);
+
+	if ((size_t)(parser->end - parser->position) < length ||
+		memcmp(parser->position, literal, length) != 0)
+		return INVALID_JSON;
+	parser->position += length;
+
+	return LTNSBufferAppend(parser->out, tnetstring, strlen(tnetstring));
+}
+
+static LTNSError LTNSJsonParseHex(LTNSJsonParser* parser, unsigned int* code_point)
+{
+	int i;
+
+	if (parser->end - parser->position < 4)
+		return INVALID_JSON;
+
+	*code_point = 0;
+	for (i = 0; i < 4; i++)
+	{
+		char c = *parser->position++;
+		*code_point <<= 4;
+		if (c >= '0' && c <= '9')
+			*code_point |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			*code_point |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			*code_point |= c - 'A' + 10;
+		else
+			return INVALID_JSON;
+	}
+
+	return 0;
+}
+
+static LTNSError LTNSJsonAppendUTF8(LTNSBuffer* out, unsigned int code_point)
+{
+	char bytes[4];
+	size_t length;
+
+	if (code_point < 0x80)
+	{
+		bytes[0] = (char)code_point;
+		length = 1;
+	}
+	else if (code_point < 0x800)
+	{
+		bytes[0] = (char)(0xC0 | (code_point >> 6));
+		bytes[1] = (char)(0x80 | (code_point & 0x3F));
+		length = 2;
+	}
+	else if (code_point < 0x10000)
+	{
+		bytes[0] = (char)(0xE0 | (code_point >> 12));
+		bytes[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+		bytes[2] = (char)(0x80 | (code_point & 0x3F));
+		length = 3;
+	}
+	else
+	{
+		bytes[0] = (char)(0xF0 | (code_point >> 18));
+		bytes[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+		bytes[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+		bytes[3] = (char)(0x80 | (code_point & 0x3F));
+		length = 4;
+	}
+
+	return LTNSBufferAppend(out, bytes, length);
+}
+
+static void LTNSJsonSkipWhitespace(LTNSJsonParser* parser)
+{
+	while (parser->position < parser->end &&
+		(*parser->position == ' ' || *parser->position == '\t' ||
+		 *parser->position == '\n' || *parser->position == '\r'))
+		parser->position++;
+}
@@ -0,0 +1,442 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "LTNSLog.h"
+#include "LTNSTerm.h"
+#include "LTNSHash.h"
+#include "LTNSStream.h"
+
+#define INDEX_SUFFIX ".idx"
+#define INDEX_ENTRY_LENGTH 8
+#define CHECKSUM_LENGTH 16
+/* The checksum as a string term: "16:", the hex digits and "," */
+#define CHECKSUM_TERM_LENGTH (CHECKSUM_LENGTH + 4)
+
+struct _LTNSLog
+{
+	int fd;
+	int index_fd; // NOTE: -1 for read-only logs without an index file
+	int writable;
+	char* map;
+	size_t map_size; // NOTE: may run past the end of the log file
+	size_t mapped; // NOTE: bytes of the log file read through map
+	size_t length; // NOTE: bytes of complete entries in the log file
+	size_t* offsets;
+	size_t count;
+	size_t capacity;
+};
+
+static LTNSError LTNSLogLoad(LTNSLog* log);
+static LTNSError LTNSLogReadIndex(LTNSLog* log, size_t* indexed);
+static LTNSError LTNSLogRepair(LTNSLog* log, size_t indexed, size_t index_length);
+static LTNSError LTNSLogMap(LTNSLog* log, size_t length);
+static LTNSError LTNSLogReserve(LTNSLog* log, size_t additional);
+static LTNSError LTNSLogEntryEnd(LTNSLog* log, size_t offset, size_t* end);
+static LTNSError LTNSLogWrite(int fd, const char* data, size_t length);
+static LTNSError LTNSLogWriteIndex(LTNSLog* log, size_t first);
+
+LTNSError LTNSLogOpen(LTNSLog** log, const char* path, int writable)
+{
+	if (!log || !path)
+		return INVALID_ARGUMENT;
+
+	*log = (LTNSLog*)calloc(1, sizeof(LTNSLog));
+	char* index_path = (char*)malloc(strlen(path) + sizeof(INDEX_SUFFIX));
+	if (!*log || !index_path)
+	{
+		free(*log);
+		free(index_path);
+		*log = NULL;
+		return OUT_OF_MEMORY;
+	}
+	sprintf(index_path, "%s%s", path, INDEX_SUFFIX);
+
+	LTNSError error = 0;
+	int flags = writable ? O_RDWR | O_CREAT : O_RDONLY;
+	(*log)->writable = writable;
+	(*log)->index_fd = -1;
+	(*log)->fd = open(path, writable ? flags | O_APPEND : flags, 0644);
+	if ((*log)->fd < 0)
+		error = IO_ERROR;
+	else
+	{
+		/* Read-only logs get along without an index */
+		(*log)->index_fd = open(index_path, flags, 0644);
+		if ((*log)->index_fd < 0 && (writable || errno != ENOENT))
+			error = IO_ERROR;
+	}
+	free(index_path);
+
+	if (!error)
+		error = LTNSLogLoad(*log);
+	if (error)
+	{
+		int saved_errno = errno;
+		LTNSLogClose(*log);
+		*log = NULL;
+		errno = saved_errno;
+	}
+	return error;
+}
+
+LTNSError LTNSLogClose(LTNSLog* log)
+{
+	if (!log)
+		return INVALID_ARGUMENT;
+
+	if (log->map)
+		munmap(log->map, log->map_size);
+	if (log->fd >= 0)
+		close(log->fd);
+	if (log->index_fd >= 0)
+		close(log->index_fd);
+	free(log->offsets);
+	free(log);
+
+	return 0;
+}
+
+LTNSError LTNSLogAppend(LTNSLog* log, const char* tnetstring, size_t length, size_t* index)
+{
+	char header[MAX_PREFIX_LENGTH + 1 + CHECKSUM_TERM_LENGTH + 1];
+	char* payload;
+	size_t payload_length;
+
+	if (!log || !tnetstring || !log->writable)
+		return INVALID_ARGUMENT;
+	if (LTNSTermScan(tnetstring, tnetstring + length, &payload, &payload_length, NULL) ||
+			payload + payload_length + 1 != tnetstring + length)
+		return INVALID_TNETSTRING;
+
+	LTNSError error = LTNSLogReserve(log, 1);
+	RETURN_VAL_IF(error);
+
+	uint64_t checksum = LTNSHash64(tnetstring, length, 0);
+	int header_length = snprintf(header, sizeof(header), "%zu:%d:%016llx,",
+			CHECKSUM_TERM_LENGTH + length, CHECKSUM_LENGTH, (unsigned long long)checksum);
+	error = LTNSLogWrite(log->fd, header, header_length);
+	if (!error)
+		error = LTNSLogWrite(log->fd, tnetstring, length);
+	if (!error)
+		error = LTNSLogWrite(log->fd, "]", 1);
+	if (error)
+	{
+		/* Don't leave half an entry behind */
+		int saved_errno = errno;
+		if (ftruncate(log->fd, log->length)) {}
+		errno = saved_errno;
+		return error;
+	}
+
+	log->offsets[log->count++] = log->length;
+	log->length += header_length + length + 1;
+	if (index)
+		*index = log->count - 1;
+
+	/* The entry is in the log file, a missing index entry gets repaired
+	 * when the log is opened again */
+	return LTNSLogWriteIndex(log, log->count - 1);
+}
+
+LTNSError LTNSLogSync(LTNSLog* log)
+{
+	if (!log)
+		return INVALID_ARGUMENT;
+	if (!log->writable)
+		return 0;
+
+	if (fsync(log->fd) || fsync(log->index_fd))
+		return IO_ERROR;
+	return 0;
+}
+
+LTNSError LTNSLogCount(LTNSLog* log, size_t* count)
+{
+	if (!log || !count)
+		return INVALID_ARGUMENT;
+
+	*count = log->count;
+	return 0;
+}
+
+LTNSError LTNSLogGet(LTNSLog* log, size_t index, const char** record, size_t* length)
+{
+	char expected[CHECKSUM_LENGTH + 1];
+	char *payload, *checksum;
+	size_t payload_length, checksum_length, end;
+	LTNSType type;
+	LTNSError error;
+
+	if (!log || !record || !length || index >= log->count)
+		return INVALID_ARGUMENT;
+
+	/* Appended since the log file was mapped */
+	end = index + 1 < log->count ? log->offsets[index + 1] : log->length;
+	if (end > log->mapped)
+	{
+		error = LTNSLogMap(log, log->length);
+		RETURN_VAL_IF(error);
+	}
+
+	const char* entry = log->map + log->offsets[index];
+	error = LTNSTermScan(entry, log->map + end, &payload, &payload_length, &type);
+	RETURN_VAL_IF(error);
+	if (type != LTNS_LIST)
+		return INVALID_TNETSTRING;
+	error = LTNSTermScan(payload, payload + payload_length, &checksum, &checksum_length, &type);
+	RETURN_VAL_IF(error);
+	if (type != LTNS_STRING || checksum_length != CHECKSUM_LENGTH)
+		return INVALID_TNETSTRING;
+
+	*record = checksum + CHECKSUM_LENGTH + 1;
+	*length = payload + payload_length - *record;
+	snprintf(expected, sizeof(expected), "%016llx", (unsigned long long)LTNSHash64(*record, *length, 0));
+	if (memcmp(expected, checksum, CHECKSUM_LENGTH))
+		return CHECKSUM_MISMATCH;
+
+	return 0;
+}
+
+LTNSError LTNSLogPrefetch(LTNSLog* log, size_t first, size_t count)
+{
+	if (!log)
+		return INVALID_ARGUMENT;
+	if (first >= log->count || !count)
+		return 0;
+
+	size_t end = count < log->count - first ? log->offsets[first + count] : log->length;
+	if (end > log->mapped)
+	{
+		LTNSError error = LTNSLogMap(log, log->length);
+		RETURN_VAL_IF(error);
+	}
+
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t start = log->offsets[first] / page * page;
+	/* Only a hint, failing it changes nothing */
+	posix_madvise(log->map + start, end - start, POSIX_MADV_WILLNEED);
+
+	return 0;
+}
+
+/* Maps the log file and brings the index up to date with it */
+static LTNSError LTNSLogLoad(LTNSLog* log)
+{
+	struct stat log_stat, index_stat;
+	size_t indexed, end = 0, *offsets = NULL, count = 0, i;
+	LTNSError error;
+
+	if (fstat(log->fd, &log_stat))
+		return IO_ERROR;
+	index_stat.st_size = 0;
+	if (log->index_fd >= 0 && fstat(log->index_fd, &index_stat))
+		return IO_ERROR;
+
+	error = LTNSLogMap(log, log_stat.st_size);
+	if (!error)
+		error = LTNSLogReadIndex(log, &indexed);
+	RETURN_VAL_IF(error);
+
+	/* Entries appended after the index was last written */
+	if (log->count)
+		LTNSLogEntryEnd(log, log->offsets[log->count - 1], &end);
+	error = LTNSStreamSplit(log->map + end, log->mapped - end, 1, &offsets, &count);
+	if (!error)
+		error = LTNSLogReserve(log, count);
+	if (!error)
+	{
+		for (i = 0; i < count; i++)
+			log->offsets[log->count++] = end + offsets[i];
+		log->length = end + offsets[count];
+	}
+	free(offsets);
+	RETURN_VAL_IF(error);
+
+	if (log->writable)
+		error = LTNSLogRepair(log, indexed, index_stat.st_size);
+	return error;
+}
+
+/* Takes over the index entries up to the first one that doesn't fit the log
+ * file. Entries in between are checked by their checksums when read. */
+static LTNSError LTNSLogReadIndex(LTNSLog* log, size_t* indexed)
+{
+	unsigned char entries[INDEX_ENTRY_LENGTH * 512];
+	size_t end, i, j;
+	ssize_t bytes;
+	off_t position = 0;
+	int valid = TRUE;
+
+	*indexed = 0;
+	if (log->index_fd < 0)
+		return 0;
+
+	while (valid && (bytes = pread(log->index_fd, entries, sizeof(entries), position)) != 0)
+	{
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return IO_ERROR;
+		}
+		position += bytes;
+
+		LTNSError error = LTNSLogReserve(log, bytes / INDEX_ENTRY_LENGTH);
+		RETURN_VAL_IF(error);
+		for (i = 0; valid && i + INDEX_ENTRY_LENGTH <= (size_t)bytes; i += INDEX_ENTRY_LENGTH)
+		{
+			uint64_t offset = 0;
+			for (j = 0; j < INDEX_ENTRY_LENGTH; j++)
+				offset |= (uint64_t)entries[i + j] << (8 * j);
+			valid = offset < log->mapped && (!log->count || offset > log->offsets[log->count - 1]);
+			if (valid)
+				log->offsets[log->count++] = offset;
+		}
+		/* A torn last entry */
+		if ((size_t)bytes % INDEX_ENTRY_LENGTH)
+			valid = FALSE;
+	}
+
+	/* The last entry has to be complete, the ones after it are indexed
+	 * again from the log file */
+	while (log->count && LTNSLogEntryEnd(log, log->offsets[log->count - 1], &end))
+		log->count--;
+	*indexed = log->count;
+
+	return 0;
+}
+
+/* Cuts off an incomplete entry from the log file and rewrites the index
+ * from the first entry that was missing or wrong */
+static LTNSError LTNSLogRepair(LTNSLog* log, size_t indexed, size_t index_length)
+{
+	if (log->length < log->mapped)
+	{
+		if (ftruncate(log->fd, log->length))
+			return IO_ERROR;
+		LTNSError error = LTNSLogMap(log, log->length);
+		RETURN_VAL_IF(error);
+	}
+
+	if (index_length == indexed * INDEX_ENTRY_LENGTH && indexed == log->count)
+		return 0;
+	if (ftruncate(log->index_fd, indexed * INDEX_ENTRY_LENGTH))
+		return IO_ERROR;
+	for (; indexed < log->count; indexed++)
+	{
+		LTNSError error = LTNSLogWriteIndex(log, indexed);
+		RETURN_VAL_IF(error);
+	}
+
+	return 0;
+}
+
+/* Makes the first length bytes of the log file readable through the map.
+ * The map grows to at least twice its size, so appends only remap now and
+ * then: pages past the end of the file are mapped but never read. */
+static LTNSError LTNSLogMap(LTNSLog* log, size_t length)
+{
+	if (length <= log->map_size)
+	{
+		log->mapped = length;
+		return 0;
+	}
+
+	size_t size = log->map_size * 2;
+	if (size < length)
+		size = length;
+	char* map = (char*)mmap(NULL, size, PROT_READ, MAP_SHARED, log->fd, 0);
+	if (map == MAP_FAILED)
+		return IO_ERROR;
+	if (log->map)
+		munmap(log->map, log->map_size);
+	log->map = map;
+	log->map_size = size;
+	log->mapped = length;
+
+	return 0;
+}
+
+static LTNSError LTNSLogReserve(LTNSLog* log, size_t additional)
+{
+	if (log->count + additional <= log->capacity)
+		return 0;
+
+	size_t capacity = log->capacity ? log->capacity : 64;
+	while (capacity < log->count + additional)
+		capacity *= 2;
+	size_t* offsets = (size_t*)realloc(log->offsets, sizeof(size_t) * capacity);
+	if (!offsets)
+		return OUT_OF_MEMORY;
+	log->offsets = offsets;
+	log->capacity = capacity;
+
+	return 0;
+}
+
+static LTNSError LTNSLogEntryEnd(LTNSLog* log, size_t offset, size_t* end)
+{
+	char* payload;
+	size_t payload_length;
+	LTNSType type;
+
+	LTNSError error = LTNSTermScan(log->map + offset, log->map + log->mapped, &payload, &payload_length, &type);
+	RETURN_VAL_IF(error);
+	if (type != LTNS_LIST)
+		return INVALID_TNETSTRING;
+
+	*end = payload + payload_length + 1 - log->map;
+	return 0;
+}
+
+static LTNSError LTNSLogWrite(int fd, const char* data, size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write(fd, data, length);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return IO_ERROR;
+		}
+		data += written;
+		length -= written;
+	}
+
+	return 0;
+}
+
+/* Index entries are written in place, so a failed write can't shift the
+ * ones after it */
+static LTNSError LTNSLogWriteIndex(LTNSLog* log, size_t first)
+{
+	unsigned char entry[INDEX_ENTRY_LENGTH];
+	size_t written = 0, j;
+	uint64_t offset = log->offsets[first];
+
+	for (j = 0; j < INDEX_ENTRY_LENGTH; j++)
+		entry[j] = (unsigned char)(offset >> (8 * j));
+	while (written < INDEX_ENTRY_LENGTH)
+	{
+		ssize_t bytes = pwrite(log->index_fd, entry + written, INDEX_ENTRY_LENGTH - written,
+				(off_t)(first * INDEX_ENTRY_LENGTH + written));
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return IO_ERROR;
+		}
+		written += bytes;
+	}
+
+	return 0;
+}
@@ -0,0 +1,213 @@
+#include "LTNSSnapshot.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+/* A reader's state is its epoch shifted left by one, the lowest bit is set
+ * while it holds a version */
+#define READER_ACTIVE 1
+
+struct _LTNSSnapshotReader
+{
+	uint64_t state;
+	char used;
+	LTNSSnapshots* snapshots;
+	LTNSSnapshotReader* next;
+};
+
+typedef struct _LTNSRetiredVersion
+{
+	LTNSDataAccess* version;
+	uint64_t epoch; // NOTE: epoch the version was replaced in
+	struct _LTNSRetiredVersion* next;
+} LTNSRetiredVersion;
+
+struct _LTNSSnapshots
+{
+	LTNSDataAccess* current;
+	uint64_t epoch;
+	LTNSSnapshotReader* readers; // NOTE: only ever prepended to, until Destroy
+	LTNSRetiredVersion* retired; // NOTE: only touched by the writer
+};
+
+static int LTNSSnapshotsAdvanceEpoch(LTNSSnapshots* snapshots);
+
+LTNSError LTNSSnapshotsCreate(LTNSSnapshots** snapshots, LTNSDataAccess* data_access)
+{
+	if (!snapshots || !data_access)
+		return INVALID_ARGUMENT;
+
+	*snapshots = (LTNSSnapshots*)calloc(1, sizeof(LTNSSnapshots));
+	if (!*snapshots)
+		return OUT_OF_MEMORY;
+
+	LTNSError error = LTNSDataAccessSnapshot(data_access, &(*snapshots)->current);
+	if (error)
+	{
+		free(*snapshots);
+		*snapshots = NULL;
+	}
+	return error;
+}
+
+LTNSError LTNSSnapshotsDestroy(LTNSSnapshots* snapshots)
+{
+	if (!snapshots)
+		return INVALID_ARGUMENT;
+
+	while (snapshots->retired)
+	{
+		LTNSRetiredVersion* retired = snapshots->retired;
+		snapshots->retired = retired->next;
+		LTNSDataAccessDestroy(retired->version);
+		free(retired);
+	}
+	while (snapshots->readers)
+	{
+		LTNSSnapshotReader* reader = snapshots->readers;
+		snapshots->readers = reader->next;
+		free(reader);
+	}
+	LTNSDataAccessDestroy(snapshots->current);
+	free(snapshots);
+
+	return 0;
+}
+
+LTNSError LTNSSnapshotsPublish(LTNSSnapshots* snapshots, LTNSDataAccess* data_access)
+{
+	LTNSDataAccess* version = NULL;
+
+	if (!snapshots || !data_access)
+		return INVALID_ARGUMENT;
+
+	LTNSRetiredVersion* retired = (LTNSRetiredVersion*)malloc(sizeof(LTNSRetiredVersion));
+	if (!retired)
+		return OUT_OF_MEMORY;
+	LTNSError error = LTNSDataAccessSnapshot(data_access, &version);
+	if (error)
+	{
+		free(retired);
+		return error;
+	}
+
+	/* Readers acquiring from here on get the new version. Those that could
+	 * still get the old one announced an epoch up to the current one */
+	retired->version = __atomic_exchange_n(&snapshots->current, version, __ATOMIC_SEQ_CST);
+	retired->epoch = __atomic_load_n(&snapshots->epoch, __ATOMIC_SEQ_CST);
+	retired->next = snapshots->retired;
+	snapshots->retired = retired;
+
+	return LTNSSnapshotsReclaim(snapshots, NULL);
+}
+
+LTNSError LTNSSnapshotsReclaim(LTNSSnapshots* snapshots, size_t* pending)
+{
+	if (!snapshots)
+		return INVALID_ARGUMENT;
+
+	/* Two advances make everything retired so far unreachable */
+	if (snapshots->retired && LTNSSnapshotsAdvanceEpoch(snapshots))
+		LTNSSnapshotsAdvanceEpoch(snapshots);
+
+	uint64_t epoch = snapshots->epoch;
+	LTNSRetiredVersion** link = &snapshots->retired;
+	size_t count = 0;
+	while (*link)
+	{
+		LTNSRetiredVersion* retired = *link;
+		if (retired->epoch + 2 <= epoch)
+		{
+			*link = retired->next;
+			LTNSDataAccessDestroy(retired->version);
+			free(retired);
+		}
+		else
+		{
+			link = &retired->next;
+			count++;
+		}
+	}
+
+	if (pending)
+		*pending = count;
+	return 0;
+}
+
+LTNSError LTNSSnapshotsJoin(LTNSSnapshots* snapshots, LTNSSnapshotReader** reader)
+{
+	if (!snapshots || !reader)
+		return INVALID_ARGUMENT;
+
+	LTNSSnapshotReader* node;
+	for (node = __atomic_load_n(&snapshots->readers, __ATOMIC_ACQUIRE); node; node = node->next)
+	{
+		char unused = FALSE;
+		if (__atomic_compare_exchange_n(&node->used, &unused, TRUE, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		{
+			*reader = node;
+			return 0;
+		}
+	}
+
+	node = (LTNSSnapshotReader*)malloc(sizeof(LTNSSnapshotReader));
+	if (!node)
+		return OUT_OF_MEMORY;
+	node->state = 0;
+	node->used = TRUE;
+	node->snapshots = snapshots;
+	node->next = __atomic_load_n(&snapshots->readers, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&snapshots->readers, &node->next, node, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		;
+
+	*reader = node;
+	return 0;
+}
+
+LTNSError LTNSSnapshotsLeave(LTNSSnapshotReader* reader)
+{
+	if (!reader || (__atomic_load_n(&reader->state, __ATOMIC_RELAXED) & READER_ACTIVE))
+		return INVALID_ARGUMENT;
+
+	__atomic_store_n(&reader->used, FALSE, __ATOMIC_RELEASE);
+	return 0;
+}
+
+LTNSError LTNSSnapshotAcquire(LTNSSnapshotReader* reader, LTNSDataAccess** snapshot)
+{
+	if (!reader || !snapshot || (reader->state & READER_ACTIVE))
+		return INVALID_ARGUMENT;
+
+	/* The announcement has to be visible before the version is loaded, the
+	 * writer checks it after replacing the version */
+	LTNSSnapshots* snapshots = reader->snapshots;
+	uint64_t epoch = __atomic_load_n(&snapshots->epoch, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&reader->state, (epoch << 1) | READER_ACTIVE, __ATOMIC_SEQ_CST);
+	*snapshot = __atomic_load_n(&snapshots->current, __ATOMIC_SEQ_CST);
+
+	return 0;
+}
+
+LTNSError LTNSSnapshotRelease(LTNSSnapshotReader* reader)
+{
+	if (!reader || !(reader->state & READER_ACTIVE))
+		return INVALID_ARGUMENT;
+
+	__atomic_store_n(&reader->state, 0, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* The epoch only moves on once every active reader has seen it */
+static int LTNSSnapshotsAdvanceEpoch(LTNSSnapshots* snapshots)
+{
+	uint64_t epoch = snapshots->epoch;
+	LTNSSnapshotReader* reader;
+	for (reader = __atomic_load_n(&snapshots->readers, __ATOMIC_ACQUIRE); reader; reader = reader->next)
+	{
+		uint64_t state = __atomic_load_n(&reader->state, __ATOMIC_SEQ_CST);
+		if ((state & READER_ACTIVE) && (state >> 1) != epoch)
+			return FALSE;
+	}
+
+	__atomic_store_n(&snapshots->epoch, epoch + 1, __ATOMIC_SEQ_CST);
+	return TRUE;
+}
@@ -0,0 +1,29 @@
+#include <string.h>
+
+#include "LTNSStats.h"
+
+#ifndef LTNS_DISABLE_STATS
+__thread LTNSStats LTNSThreadStats;
+int64_t LTNSLiveChildren;
+#endif
+
+LTNSError LTNSStatsGet(LTNSStats* stats)
+{
+	if (!stats)
+		return INVALID_ARGUMENT;
+
+#ifdef LTNS_DISABLE_STATS
+	memset(stats, 0, sizeof(LTNSStats));
+#else
+	*stats = LTNSThreadStats;
+	stats->live_children = __atomic_load_n(&LTNSLiveChildren, __ATOMIC_RELAXED);
+#endif
+	return 0;
+}
+
+void LTNSStatsReset(void)
+{
+#ifndef LTNS_DISABLE_STATS
+	memset(&LTNSThreadStats, 0, sizeof(LTNSStats));
+#endif
+}
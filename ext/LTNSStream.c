@@ -0,0 +1,236 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "LTNSStream.h"
+#include "LTNSTerm.h"
+
+/* Smaller parts aren't worth a thread */
+#define MIN_PART_LENGTH (64 * 1024)
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+/* Offsets of records starting in [start, end), found by following the
+ * records from a guessed start. Where a chain of records breaks the next
+ * guess starts a new segment. */
+typedef struct
+{
+	const char* stream;
+	size_t length;
+	size_t start;
+	size_t end;
+	size_t* offsets;
+	size_t count;
+	size_t capacity;
+	/* Pairs of the index of a segment's first offset and the offset after
+	 * its last record */
+	size_t* segments;
+	size_t segment_count;
+	size_t segment_capacity;
+	LTNSError error;
+} LTNSStreamPart;
+
+static int LTNSStreamNext(const char* stream, size_t length, size_t offset, size_t* next);
+static size_t LTNSStreamGuess(LTNSStreamPart* part, size_t offset);
+static LTNSError LTNSStreamPush(size_t** offsets, size_t* count, size_t* capacity, size_t offset);
+static LTNSError LTNSStreamAppend(size_t** offsets, size_t* count, size_t* capacity, const size_t* values, size_t value_count);
+static void* LTNSStreamFollow(void* part);
+static LTNSError LTNSStreamChain(LTNSStreamPart* parts, size_t part_count, size_t** offsets, size_t* count);
+
+LTNSError LTNSStreamSplit(const char* stream, size_t length, size_t thread_count, size_t** offsets, size_t* count)
+{
+	if ((!stream && length) || !thread_count || !offsets || !count)
+		return INVALID_ARGUMENT;
+
+	size_t part_count = MIN(thread_count, length / MIN_PART_LENGTH);
+	if (!part_count)
+		part_count = 1;
+	LTNSStreamPart* parts = (LTNSStreamPart*)calloc(part_count, sizeof(LTNSStreamPart));
+	pthread_t* threads = (pthread_t*)malloc(sizeof(pthread_t) * part_count);
+	if (!parts || !threads)
+	{
+		free(parts);
+		free(threads);
+		return OUT_OF_MEMORY;
+	}
+
+	size_t i, started = 1;
+	for (i = 0; i < part_count; i++)
+	{
+		parts[i].stream = stream;
+		parts[i].length = length;
+		parts[i].start = length / part_count * i;
+		parts[i].end = i + 1 < part_count ? length / part_count * (i + 1) : length;
+	}
+	/* Parts without a thread are chained from scratch */
+	for (; started < part_count; started++)
+		if (pthread_create(&threads[started], NULL, LTNSStreamFollow, &parts[started]))
+			break;
+	LTNSStreamFollow(&parts[0]);
+	for (i = 1; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	LTNSError error = 0;
+	for (i = 0; i < started && !error; i++)
+		error = parts[i].error;
+	if (!error)
+		error = LTNSStreamChain(parts, part_count, offsets, count);
+
+	for (i = 0; i < part_count; i++)
+	{
+		free(parts[i].offsets);
+		free(parts[i].segments);
+	}
+	free(parts);
+	free(threads);
+	return error;
+}
+
+/* Sets *next to the end of the record at offset if there is one */
+static int LTNSStreamNext(const char* stream, size_t length, size_t offset, size_t* next)
+{
+	char* payload;
+	size_t payload_length;
+	if (offset >= length || LTNSTermScan(stream + offset, stream + length, &payload, &payload_length, NULL))
+		return FALSE;
+	*next = payload + payload_length + 1 - stream;
+	return TRUE;
+}
+
+/* The first record start from offset on within the part. Records start
+ * with a digit, and all but the first follow another record's type. */
+static size_t LTNSStreamGuess(LTNSStreamPart* part, size_t offset)
+{
+	const char* stream = part->stream;
+	size_t next;
+	for (; offset < part->end; offset++)
+	{
+		if (!IS_DIGIT(stream[offset]))
+			continue;
+		if (offset && !LTNSTypeIsValid(stream[offset - 1]))
+			continue;
+		if (LTNSStreamNext(stream, part->length, offset, &next))
+			return offset;
+	}
+	return part->end;
+}
+
+static LTNSError LTNSStreamPush(size_t** offsets, size_t* count, size_t* capacity, size_t offset)
+{
+	return LTNSStreamAppend(offsets, count, capacity, &offset, 1);
+}
+
+static LTNSError LTNSStreamAppend(size_t** offsets, size_t* count, size_t* capacity, const size_t* values, size_t value_count)
+{
+	if (*count + value_count > *capacity)
+	{
+		size_t new_capacity = *capacity ? *capacity : 64;
+		while (new_capacity < *count + value_count)
+			new_capacity *= 2;
+		size_t* new_offsets = (size_t*)realloc(*offsets, sizeof(size_t) * new_capacity);
+		if (!new_offsets)
+			return OUT_OF_MEMORY;
+		*offsets = new_offsets;
+		*capacity = new_capacity;
+	}
+	memcpy(*offsets + *count, values, sizeof(size_t) * value_count);
+	*count += value_count;
+	return 0;
+}
+
+static void* LTNSStreamFollow(void* ptr)
+{
+	LTNSStreamPart* part = (LTNSStreamPart*)ptr;
+	size_t offset = part->start, next, first, segment_end;
+
+	/* The first part starts at a record for sure */
+	if (part->start)
+		offset = LTNSStreamGuess(part, offset);
+	while (offset < part->end)
+	{
+		first = part->count;
+		for (segment_end = offset; offset < part->end; offset = next)
+		{
+			if (!LTNSStreamNext(part->stream, part->length, offset, &next))
+				break;
+			part->error = LTNSStreamPush(&part->offsets, &part->count, &part->capacity, offset);
+			if (part->error)
+				return NULL;
+			segment_end = next;
+		}
+		if (part->count > first)
+		{
+			part->error = LTNSStreamPush(&part->segments, &part->segment_count, &part->segment_capacity, first);
+			if (!part->error)
+				part->error = LTNSStreamPush(&part->segments, &part->segment_count, &part->segment_capacity, segment_end);
+			if (part->error)
+				return NULL;
+		}
+
+		/* A broken chain started at a wrong guess or the stream is broken
+		 * there, chaining the parts tells which */
+		if (offset < part->end)
+			offset = LTNSStreamGuess(part, offset + 1);
+	}
+
+	return NULL;
+}
+
+/* Follows the records from the start of the stream, taking over a part's
+ * segment once it reaches one of its offsets */
+static LTNSError LTNSStreamChain(LTNSStreamPart* parts, size_t part_count, size_t** offsets, size_t* count)
+{
+	size_t capacity = 0, offset = 0, next, i;
+	LTNSError error = 0;
+
+	*offsets = NULL;
+	*count = 0;
+	for (i = 0; i < part_count && !error; i++)
+	{
+		LTNSStreamPart* part = &parts[i];
+		size_t segment = 0;
+		while (offset < part->end && !error)
+		{
+			/* Offsets are sorted, so are the segments */
+			size_t low = 0, high = part->count;
+			while (low < high)
+			{
+				size_t middle = low + (high - low) / 2;
+				if (part->offsets[middle] < offset)
+					low = middle + 1;
+				else
+					high = middle;
+			}
+
+			if (low < part->count && part->offsets[low] == offset)
+			{
+				while (2 * (segment + 1) < part->segment_count && part->segments[2 * (segment + 1)] <= low)
+					segment++;
+				size_t last = 2 * (segment + 1) < part->segment_count ? part->segments[2 * (segment + 1)] : part->count;
+				error = LTNSStreamAppend(offsets, count, &capacity, part->offsets + low, last - low);
+				offset = part->segments[2 * segment + 1];
+				continue;
+			}
+
+			if (!LTNSStreamNext(part->stream, part->length, offset, &next))
+				break;
+			error = LTNSStreamPush(offsets, count, &capacity, offset);
+			offset = next;
+		}
+		/* The stream is broken where the chain stopped */
+		if (offset < part->end)
+			break;
+	}
+
+	/* Room for the end of the last record */
+	if (!error)
+		error = LTNSStreamPush(offsets, count, &capacity, offset);
+	if (error)
+	{
+		free(*offsets);
+		*offsets = NULL;
+		*count = 0;
+		return error;
+	}
+	(*count)--;
+
+	return 0;
+}
@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "LTNSTerm.h"
+#include "LTNSStats.h"
 
 struct _LTNSTerm
 {
@@ -153,36 +154,124 @@ LTNSError LTNSTermGetTNetstring( LTNSTerm *term, char** tnetstring, size_t* leng
 
 LTNSError LTNSTermParse(LTNSTerm* term, char* tnet_end)
 {
-	char* colon;
-	size_t prefix = 0;
+	char* payload;
+	size_t payload_length;
+	LTNSError error;
 
 	if (!term)
 		return INVALID_ARGUMENT;
 
-	prefix = (size_t)strtol(term->tnetstring, &colon, 10);
-	/* Prefix says payload longer than it is */
-	if (term->tnetstring + prefix >= tnet_end)
-		return INVALID_TNETSTRING;
+	error = LTNSTermScan(term->tnetstring, tnet_end, &payload, &payload_length, NULL);
+	RETURN_VAL_IF(error);
+
+	/* Total term length is:    prefix length + COLON + payload + TYPE */
+	term->length = (payload - term->tnetstring) + payload_length + 1;
+	term->payload_length = payload_length;
+	/* Pointer to the begining of the payload string */
+	term->payload = payload;
+
+	return 0;
+}
+
+LTNSError LTNSTermScan(const char* tnetstring, const char* tnet_end, char** payload, size_t* payload_length, LTNSType* type)
+{
+	const char* colon = tnetstring;
+	size_t prefix = 0;
+
+	if (!tnetstring || !tnet_end || !payload || !payload_length)
+		return INVALID_ARGUMENT;
+
+	/* Read the prefix without relying on a terminating NUL byte */
+	while (colon < tnet_end && *colon >= '0' && *colon <= '9')
+	{
+		prefix = prefix * 10 + (*colon - '0');
+		colon++;
+	}
 	/* No number found */
-	if (colon == term->tnetstring)
+	if (colon == tnetstring)
+		return INVALID_TNETSTRING;
+	/* Prefix longer than specification max length */
+	if (colon > (tnetstring + MAX_PREFIX_LENGTH))
 		return INVALID_TNETSTRING;
 	/* No colon found */
-	if (*colon != ':' || *colon == '\0')
+	if (colon >= tnet_end || *colon != ':')
 		return INVALID_TNETSTRING;
-	/* Prefix longer than specification max length */
-	if (colon > (term->tnetstring + MAX_PREFIX_LENGTH))
+	/* Prefix says payload longer than it is */
+	if ((size_t)(tnet_end - colon - 1) <= prefix)
 		return INVALID_TNETSTRING;
 
-	/* Total term length is:    prefix length + COLON + payload + TYPE */
-	term->length = (colon - term->tnetstring) + 1     + prefix  + 1;
-	term->payload_length = prefix;
-	/* Pointer to the begining of the payload string */
-	term->payload = colon + 1;
-
 	/* Check type */
-	if (!LTNSTypeIsValid(term->payload[term->payload_length]))
+	if (!LTNSTypeIsValid(colon[1 + prefix]))
 		return INVALID_TNETSTRING;
 
+	*payload = (char*)colon + 1;
+	*payload_length = prefix;
+	if (type)
+		*type = (LTNSType)colon[1 + prefix];
+
+	LTNS_STATS_ADD(terms_parsed, 1);
 	return 0;
 }
 
+LTNSError LTNSTermFindKey(const char* payload, const char* payload_end, const char* key, size_t key_length, char** key_position, char** value_position)
+{
+	const char* position = payload;
+	char* found_key;
+	size_t found_key_length;
+	char* value;
+	size_t value_length;
+	LTNSError error;
+
+	if (!payload || !payload_end || !key)
+		return INVALID_ARGUMENT;
+
+	while (position < payload_end)
+	{
+		error = LTNSTermScan(position, payload_end, &found_key, &found_key_length, NULL);
+		RETURN_VAL_IF(error);
+
+		/* Check the parsed key matches search key */
+		if (found_key_length == key_length && !memcmp(found_key, key, key_length))
+		{
+			if (key_position)
+				*key_position = (char*)position;
+			if (value_position)
+				*value_position = found_key + found_key_length + 1;
+			return 0;
+		}
+
+		/* Skip key and its value */
+		position = found_key + found_key_length + 1;
+		error = LTNSTermScan(position, payload_end, &value, &value_length, NULL);
+		RETURN_VAL_IF(error);
+		position = value + value_length + 1;
+	}
+
+	return KEY_NOT_FOUND;
+}
+
+LTNSError LTNSTermGetPath(const char* tnetstring, const char* tnet_end, const LTNSPath* path, char** value)
+{
+	char* payload;
+	size_t payload_length, i;
+	LTNSType type;
+	LTNSError error;
+
+	if (!tnetstring || !tnet_end || !path || !value)
+		return INVALID_ARGUMENT;
+
+	*value = (char*)tnetstring;
+	for (i = 0; i < path->length; i++)
+	{
+		error = LTNSTermScan(*value, tnet_end, &payload, &payload_length, &type);
+		RETURN_VAL_IF(error);
+		if (type != LTNS_DICTIONARY)
+			return KEY_NOT_FOUND;
+
+		tnet_end = payload + payload_length;
+		error = LTNSTermFindKey(payload, tnet_end, path->keys[i], strlen(path->keys[i]), NULL, value);
+		RETURN_VAL_IF(error);
+	}
+
+	return 0;
+}
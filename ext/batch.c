@@ -0,0 +1,193 @@
+#include <ruby.h>
+#include <unistd.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "batch.h"
+#include "gvl.h"
+#include "parse.h"
+#include "slow_operation.h"
+
+extern VALUE eInvalidTNetString;
+
+/* LTNSBatchExtract's arguments and result, to run it without the GVL */
+typedef struct _ExtractArgs
+{
+	const char** documents;
+	size_t* lengths;
+	size_t document_count;
+	LTNSPath* paths;
+	size_t path_count;
+	LTNSExtract* results;
+	size_t thread_count;
+	LTNSError error;
+} ExtractArgs;
+
+/* LTNSStreamSplit's arguments and result, to run it without the GVL */
+typedef struct _SplitArgs
+{
+	const char* stream;
+	size_t length;
+	size_t thread_count;
+	size_t* offsets;
+	size_t count;
+	LTNSError error;
+} SplitArgs;
+
+static size_t ltns_batch_thread_count(VALUE options);
+static VALUE ltns_extract_results(ExtractArgs* args);
+static void* ltns_extract_without_gvl(void* ptr);
+static void* ltns_split_without_gvl(void* ptr);
+
+/* Looks up each path, a key or an array of keys, in each tnetstring and
+ * returns an array of the values per tnetstring, nil where a path is
+ * missing. The lookups run on threads: (default: all processors) C threads
+ * without the GVL, ruby objects are only created afterwards */
+VALUE ltns_extract_many(int argc, VALUE* argv, VALUE module __attribute__ ((unused)))
+{
+	VALUE documents, paths, options = Qnil;
+	rb_scan_args(argc, argv, "2:", &documents, &paths, &options);
+	documents = rb_convert_type(documents, T_ARRAY, "Array", "to_ary");
+	paths = rb_convert_type(paths, T_ARRAY, "Array", "to_ary");
+	size_t thread_count = ltns_batch_thread_count(options);
+
+	/* Convert everything first so nothing raises while we hold C memory */
+	long key_count = 0;
+	paths = ltns_da_convert_paths(RARRAY_LEN(paths), RARRAY_CONST_PTR(paths), &key_count);
+	long i, document_count = RARRAY_LEN(documents);
+	size_t total_length = 0;
+	for (i = 0; i < document_count; i++)
+	{
+		VALUE document = rb_ary_entry(documents, i);
+		StringValue(document);
+		total_length += RSTRING_LEN(document);
+	}
+
+	/* Other threads can't change the documents behind our back when we keep
+	 * the GVL, otherwise read frozen copies */
+	if (ltns_releases_gvl(total_length))
+	{
+		VALUE stable = rb_ary_new2(document_count);
+		for (i = 0; i < document_count; i++)
+			rb_ary_push(stable, rb_str_new_frozen(rb_ary_entry(documents, i)));
+		documents = stable;
+	}
+
+	VALUE documents_tmp, lengths_tmp, paths_tmp, keys_tmp, results_tmp;
+	ExtractArgs args;
+	args.document_count = document_count;
+	args.path_count = RARRAY_LEN(paths);
+	args.thread_count = thread_count;
+	args.documents = ALLOCV_N(const char*, documents_tmp, args.document_count);
+	args.lengths = ALLOCV_N(size_t, lengths_tmp, args.document_count);
+	args.paths = ALLOCV_N(LTNSPath, paths_tmp, args.path_count);
+	args.results = ALLOCV_N(LTNSExtract, results_tmp, args.document_count * args.path_count);
+	const char** c_keys = ALLOCV_N(const char*, keys_tmp, key_count);
+	ltns_da_fill_paths(paths, args.paths, c_keys);
+	for (i = 0; i < document_count; i++)
+	{
+		VALUE document = rb_ary_entry(documents, i);
+		args.documents[i] = RSTRING_PTR(document);
+		args.lengths[i] = RSTRING_LEN(document);
+	}
+
+	double start = ltns_slow_operation_start();
+	ltns_without_gvl(total_length, ltns_extract_without_gvl, &args);
+	ltns_slow_operation_finish("extract_many", Qnil, NULL, total_length, start);
+
+	VALUE results = Qnil;
+	if (!args.error)
+		results = ltns_extract_results(&args);
+	ALLOCV_END(documents_tmp);
+	ALLOCV_END(lengths_tmp);
+	ALLOCV_END(paths_tmp);
+	ALLOCV_END(keys_tmp);
+	ALLOCV_END(results_tmp);
+	RB_GC_GUARD(documents);
+	RB_GC_GUARD(paths);
+	ltns_da_raise_on_error(args.error);
+
+	return results;
+}
+
+/* Offsets of the records in a string of concatenated tnetstrings, found on
+ * threads: (default: all processors) C threads. Record i is
+ * stream.byteslice(offsets[i], offsets[i + 1] - offsets[i]), the last offset
+ * is where the last complete record ends. */
+VALUE ltns_split_offsets(int argc, VALUE* argv, VALUE module __attribute__ ((unused)))
+{
+	VALUE stream, options = Qnil;
+	rb_scan_args(argc, argv, "1:", &stream, &options);
+	StringValue(stream);
+	size_t thread_count = ltns_batch_thread_count(options);
+
+	stream = ltns_stable_string(stream);
+	SplitArgs args = { RSTRING_PTR(stream), RSTRING_LEN(stream), thread_count, NULL, 0, 0 };
+	double start = ltns_slow_operation_start();
+	ltns_without_gvl(args.length, ltns_split_without_gvl, &args);
+	ltns_slow_operation_finish("split_offsets", Qnil, NULL, args.length, start);
+	RB_GC_GUARD(stream);
+	ltns_da_raise_on_error(args.error);
+
+	VALUE offsets = rb_ary_new2(args.count + 1);
+	size_t i;
+	for (i = 0; i <= args.count; i++)
+		rb_ary_push(offsets, SIZET2NUM(args.offsets[i]));
+	free(args.offsets);
+
+	return offsets;
+}
+
+static size_t ltns_batch_thread_count(VALUE options)
+{
+	VALUE threads = options == Qnil ? Qnil : rb_hash_aref(options, ID2SYM(rb_intern("threads")));
+	if (threads == Qnil)
+	{
+		long processors = sysconf(_SC_NPROCESSORS_ONLN);
+		return processors > 0 ? (size_t)processors : 1;
+	}
+
+	long thread_count = NUM2LONG(threads);
+	if (thread_count < 1)
+		rb_raise(rb_eArgError, "threads must be positive");
+	return (size_t)thread_count;
+}
+
+/* Values still point into the documents, which the caller keeps alive */
+static VALUE ltns_extract_results(ExtractArgs* args)
+{
+	VALUE results = rb_ary_new2(args->document_count);
+	size_t i, j;
+	for (i = 0; i < args->document_count; i++)
+	{
+		VALUE values = rb_ary_new2(args->path_count);
+		LTNSExtract* extract = args->results + i * args->path_count;
+		for (j = 0; j < args->path_count; j++)
+		{
+			VALUE value = Qnil;
+			if (extract[j].tnetstring &&
+					!ltns_parse(extract[j].tnetstring, extract[j].tnetstring + extract[j].length, &value))
+				rb_raise(eInvalidTNetString, "Invalid TNetstring");
+			rb_ary_push(values, value);
+		}
+		rb_ary_push(results, values);
+	}
+
+	return results;
+}
+
+static void* ltns_extract_without_gvl(void* ptr)
+{
+	ExtractArgs* args = (ExtractArgs*)ptr;
+	args->error = LTNSBatchExtract(args->documents, args->lengths, args->document_count,
+			args->paths, args->path_count, args->results, args->thread_count);
+	return NULL;
+}
+
+static void* ltns_split_without_gvl(void* ptr)
+{
+	SplitArgs* args = (SplitArgs*)ptr;
+	args->error = LTNSStreamSplit(args->stream, args->length, args->thread_count, &args->offsets, &args->count);
+	return NULL;
+}
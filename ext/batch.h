@@ -0,0 +1,9 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <ruby.h>
+
+VALUE ltns_extract_many(int argc, VALUE* argv, VALUE module);
+VALUE ltns_split_offsets(int argc, VALUE* argv, VALUE module);
+
+#endif
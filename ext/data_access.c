@@ -1,9 +1,23 @@
+#include <ruby.h>
+#ifdef HAVE_RUBY_RACTOR_H
+#include <ruby/ractor.h>
+#endif
 
 #include "LTNS.h"
 
 #include "data_access.h"
 #include "parse.h"
 #include "dump.h"
+#include "json.h"
+#include "journal.h"
+#include "filter.h"
+#include "batch.h"
+#include "log.h"
+#include "index.h"
+#include "stats.h"
+#include "slow_operation.h"
+#include "recorder.h"
+#include "gvl.h"
 
 VALUE cDataAccess;
 VALUE cModule;
@@ -11,17 +25,80 @@ VALUE eInvalidTNetString;
 VALUE eUnsupportedTopLevelDataStructure;
 VALUE eInvalidScope;
 VALUE eKeyNotFound;
+VALUE eInvalidJSON;
+VALUE eInvalidFilter;
+VALUE eChecksumMismatch;
+VALUE cFilter;
+VALUE cLog;
+VALUE cIndex;
+#ifdef HAVE_RUBY_RACTOR_H
+/* true in the Ractor that loaded the extension */
+static rb_ractor_local_key_t main_ractor_key;
+#endif
+
+/* Shorter strings are copied even from frozen documents, that is cheaper
+ * than referencing the document */
+#define SHARED_STRING_MIN_LENGTH 256
+/* How long writers sleep between checks for threads reading the document */
+#define READER_POLL_INTERVAL ((struct timeval){ 0, 100 })
 
 typedef struct _Wrapper
 {
 	VALUE parent;
+	/* ObjectSpace::WeakMap of cached LTNSDataAccess children to their
+	 * DataAccess objects, nil until the first nested get */
+	VALUE children;
+	/* Hash of keys to frozen scalar values if memoizing, else nil. Valid
+	 * while the version of data_access is memo_version */
+	VALUE memo;
+	uint64_t memo_version;
+	/* Array of the Index objects self is in, nil if none */
+	VALUE indexes;
+	/* Frozen String over the document of a frozen root, strings read from
+	 * the document share its bytes. Else nil */
+	VALUE string;
+	/* Threads reading the document without the GVL and threads waiting to
+	 * change it, only counted on the root */
+	unsigned int readers;
+	unsigned int writers;
 	LTNSDataAccess* data_access;
 } Wrapper;
 
+/* LTNSDataAccessCreate's arguments and result, to run it without the GVL */
+typedef struct _CreateArgs
+{
+	LTNSDataAccess** data_access;
+	const char* tnetstring;
+	size_t length;
+	LTNSError error;
+} CreateArgs;
+
+const rb_data_type_t ltns_da_type =
+{
+	"LazyTNetstring::DataAccess",
+	{
+		ltns_da_mark,
+		ltns_da_free,
+		ltns_da_memsize,
+#ifdef HAVE_RB_GC_LOCATION
+		ltns_da_compact,
+#endif
+	},
+	0, 0,
+	/* parent, children, memo and indexes are only ever written through RB_OBJ_WRITE */
+	LTNS_TYPED_DATA_FLAGS
+};
+
 
-static void ltns_da_raise_on_error(LTNSError error);
-static VALUE ltns_da_key2str(VALUE key);
 static VALUE ltns_da_to_hash_helper(VALUE pair, VALUE hash);
+static VALUE ltns_da_fetch(VALUE self, Wrapper* wrapper, VALUE key, const char* key_cstr);
+static VALUE ltns_da_wrap_child(VALUE self, Wrapper* wrapper, LTNSDataAccess* child);
+static void ltns_da_memoize(VALUE self, Wrapper* wrapper);
+static uint64_t ltns_da_memo_sync(Wrapper* wrapper);
+static void ltns_da_memo_forget(Wrapper* wrapper, VALUE key);
+static VALUE ltns_da_string_at(VALUE self, const char* data, size_t length);
+static void* ltns_da_create_without_gvl(void* ptr);
+static void ltns_da_freeze_document(VALUE self);
 
 
 VALUE ltns_da_alloc(VALUE class)
@@ -31,17 +108,45 @@ VALUE ltns_da_alloc(VALUE class)
 		ltns_da_raise_on_error(OUT_OF_MEMORY);
 
 	wrapper->parent = Qnil;
+	wrapper->children = Qnil;
+	wrapper->memo = Qnil;
+	wrapper->indexes = Qnil;
+	wrapper->string = Qnil;
 	wrapper->data_access = NULL;
 
-	VALUE obj = Data_Wrap_Struct(class, ltns_da_mark, ltns_da_free, wrapper);
+	VALUE obj = TypedData_Wrap_Struct(class, &ltns_da_type, wrapper);
 	return obj;
 }
 
 void ltns_da_mark(void* ptr)
 {
 	Wrapper *wrapper = (Wrapper*)ptr;
+#ifdef HAVE_RB_GC_LOCATION
+	rb_gc_mark_movable(wrapper->parent);
+	rb_gc_mark_movable(wrapper->children);
+	rb_gc_mark_movable(wrapper->memo);
+	rb_gc_mark_movable(wrapper->indexes);
+	rb_gc_mark_movable(wrapper->string);
+#else
 	rb_gc_mark(wrapper->parent);
+	rb_gc_mark(wrapper->children);
+	rb_gc_mark(wrapper->memo);
+	rb_gc_mark(wrapper->indexes);
+	rb_gc_mark(wrapper->string);
+#endif
+}
+
+#ifdef HAVE_RB_GC_LOCATION
+void ltns_da_compact(void* ptr)
+{
+	Wrapper *wrapper = (Wrapper*)ptr;
+	wrapper->parent = rb_gc_location(wrapper->parent);
+	wrapper->children = rb_gc_location(wrapper->children);
+	wrapper->memo = rb_gc_location(wrapper->memo);
+	wrapper->indexes = rb_gc_location(wrapper->indexes);
+	wrapper->string = rb_gc_location(wrapper->string);
 }
+#endif
 
 void ltns_da_free(void* ptr)
 {
@@ -51,10 +156,23 @@ void ltns_da_free(void* ptr)
 	free(wrapper);
 }
 
+/* Children report their own struct, the root also the document */
+size_t ltns_da_memsize(const void* ptr)
+{
+	const Wrapper *wrapper = (const Wrapper*)ptr;
+	size_t bytes = 0;
+	if (wrapper->data_access)
+		LTNSDataAccessMemsize(wrapper->data_access, &bytes);
+	return sizeof(Wrapper) + bytes;
+}
+
+/* DataAccess.new(tnetstring = '0:}', memoize: false), memoizing keeps the
+ * scalar values read from self and its children frozen until their key
+ * changes */
 VALUE ltns_da_init(int argc, VALUE* argv, VALUE self)
 {
-	VALUE tnetstring = Qnil;
-	rb_scan_args(argc, argv, "01", &tnetstring);
+	VALUE tnetstring = Qnil, options = Qnil;
+	rb_scan_args(argc, argv, "01:", &tnetstring, &options);
 	if (tnetstring == Qnil)
 	{
 		tnetstring = rb_str_new2("0:}"); // Default to empty hash
@@ -67,25 +185,129 @@ VALUE ltns_da_init(int argc, VALUE* argv, VALUE self)
 	}
 
 	Wrapper *wrapper;
-	Data_Get_Struct(self, Wrapper, wrapper);
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
 
-	LTNSError error = LTNSDataAccessCreate(&wrapper->data_access, RSTRING_PTR(tnetstring), RSTRING_LEN(tnetstring));
-	ltns_da_raise_on_error(error);
+	tnetstring = ltns_stable_string(tnetstring);
+	CreateArgs args = { &wrapper->data_access, RSTRING_PTR(tnetstring), RSTRING_LEN(tnetstring), 0 };
+	ltns_without_gvl(args.length, ltns_da_create_without_gvl, &args);
+	RB_GC_GUARD(tnetstring);
+	ltns_da_raise_on_error(args.error);
+
+	if (options != Qnil && RTEST(rb_hash_aref(options, ID2SYM(rb_intern("memoize")))))
+		ltns_da_memoize(self, wrapper);
 
 	return self;
 }
 
+/* Validating and copying the document doesn't need the GVL */
+static void* ltns_da_create_without_gvl(void* ptr)
+{
+	CreateArgs* args = (CreateArgs*)ptr;
+	args->error = LTNSDataAccessCreate(args->data_access, args->tnetstring, args->length);
+	return NULL;
+}
+
+VALUE ltns_da_wrap(LTNSDataAccess* data_access, VALUE parent)
+{
+	VALUE obj = ltns_da_alloc(cDataAccess);
+	Wrapper *wrapper;
+	TypedData_Get_Struct(obj, Wrapper, &ltns_da_type, wrapper);
+	wrapper->data_access = data_access;
+	RB_OBJ_WRITE(obj, &wrapper->parent, parent);
+
+	/* Children of memoizing objects memoize, too */
+	if (parent != Qnil)
+	{
+		Wrapper *parent_wrapper;
+		TypedData_Get_Struct(parent, Wrapper, &ltns_da_type, parent_wrapper);
+		if (parent_wrapper->memo != Qnil)
+			ltns_da_memoize(obj, wrapper);
+	}
+	return obj;
+}
+
+static void ltns_da_memoize(VALUE self, Wrapper* wrapper)
+{
+	RB_OBJ_WRITE(self, &wrapper->memo, rb_hash_new());
+	ltns_da_raise_on_error(LTNSDataAccessVersion(wrapper->data_access, &wrapper->memo_version));
+}
+
+/* Drops the memoized values if data_access changed behind self's back, e.g.
+ * through a merge or a journal, and returns its version. Raises like get if
+ * data_access was orphaned */
+static uint64_t ltns_da_memo_sync(Wrapper* wrapper)
+{
+	uint64_t version;
+	ltns_da_raise_on_error(LTNSDataAccessVersion(wrapper->data_access, &version));
+	if (version != wrapper->memo_version)
+	{
+		rb_hash_clear(wrapper->memo);
+		wrapper->memo_version = version;
+	}
+	return version;
+}
+
+/* After self changed key, the memo has to be in sync from before */
+static void ltns_da_memo_forget(Wrapper* wrapper, VALUE key)
+{
+	rb_hash_delete(wrapper->memo, key);
+	LTNSDataAccessVersion(wrapper->data_access, &wrapper->memo_version);
+}
+
+LTNSDataAccess* ltns_da_get_data_access(VALUE self)
+{
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	return wrapper->data_access;
+}
+
+/* The outermost DataAccess object self was reached from */
+VALUE ltns_da_root(VALUE self)
+{
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	while (wrapper->parent != Qnil)
+	{
+		self = wrapper->parent;
+		TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	}
+	return self;
+}
+
 VALUE ltns_da_get(VALUE self, VALUE key)
 {
 	Wrapper *wrapper;
-	Data_Get_Struct(self, Wrapper, wrapper);
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
 	key = ltns_da_key2str(key);
 	char* key_cstr = StringValueCStr(key);
 
+	ltns_record(RECORD_GET, self, wrapper->data_access, key_cstr, LTNS_UNDEFINED, 0);
+	if (wrapper->memo != Qnil)
+	{
+		ltns_da_memo_sync(wrapper);
+		VALUE memoized = rb_hash_lookup2(wrapper->memo, key, Qundef);
+		if (memoized != Qundef)
+			return memoized;
+	}
+	double start = ltns_slow_operation_start();
+	VALUE ret = ltns_da_fetch(self, wrapper, key, key_cstr);
+	ltns_slow_operation_finish("get", key, wrapper->data_access, 0, start);
+
+	return ret;
+}
+
+/* Looks key up in the document and converts its value, the term is gone by
+ * the time it returns so the slow operation hook may raise */
+static VALUE ltns_da_fetch(VALUE self, Wrapper* wrapper, VALUE key, const char* key_cstr)
+{
 	LTNSTerm *term = NULL;
 	LTNSError error = LTNSDataAccessGet(wrapper->data_access, key_cstr, &term);
 	if (error == KEY_NOT_FOUND)
+	{
+		if (wrapper->memo != Qnil)
+			rb_hash_aset(wrapper->memo, key, Qnil);
 		return Qnil;
+	}
 	if (error)
 	{
 		LTNSTermDestroy(term);
@@ -108,11 +330,7 @@ VALUE ltns_da_get(VALUE self, VALUE key)
 			ltns_da_raise_on_error(error);
 		}
 
-		ret = ltns_da_alloc(cDataAccess);
-		Wrapper* child_wrapper;
-		Data_Get_Struct(ret, Wrapper, child_wrapper);
-		child_wrapper->data_access = child;
-		child_wrapper->parent = self;
+		ret = ltns_da_wrap_child(self, wrapper, child);
 	}
 	else
 	{
@@ -120,45 +338,126 @@ VALUE ltns_da_get(VALUE self, VALUE key)
 		char* tnetstring;
 		size_t length;
 		LTNSTermGetTNetstring(term, &tnetstring, &length);
-		if (!ltns_parse(tnetstring, tnetstring + length, &ret))
+		if (type == LTNS_STRING)
+		{
+			char* payload;
+			LTNSTermGetPayload(term, &payload, &length, NULL);
+			ret = ltns_da_string_at(self, payload, length);
+		}
+		else if (!ltns_parse(tnetstring, tnetstring + length, &ret))
 		{
 			LTNSTermDestroy(term);
 			ltns_da_raise_on_error(INVALID_TNETSTRING);
 		}
+		if (wrapper->memo != Qnil)
+			rb_hash_aset(wrapper->memo, key, rb_obj_freeze(ret));
 	}
 	LTNSTermDestroy(term);
 
 	return ret;
 }
 
+/* Returns the DataAccess object already wrapping child if there still is one.
+ * LTNSDataAccessCreateNested finds the cached child by its position and keeps
+ * it across moves, so the child itself is the key. child keeps the reference
+ * it got for a new object only */
+static VALUE ltns_da_wrap_child(VALUE self, Wrapper* wrapper, LTNSDataAccess* child)
+{
+	static ID id_aref = 0, id_aset = 0;
+	if (!id_aref)
+	{
+		id_aref = rb_intern("[]");
+		id_aset = rb_intern("[]=");
+	}
+
+	/* Children of frozen documents are new every time, there's no cache that
+	 * Ractors sharing the document would write to */
+	int frozen = FALSE;
+	LTNSDataAccessIsFrozen(child, &frozen);
+	if (frozen)
+		return ltns_da_wrap(child, self);
+
+	VALUE handle = ULL2NUM((uintptr_t)child);
+
+	if (wrapper->children != Qnil)
+	{
+		VALUE cached = rb_funcall(wrapper->children, id_aref, 1, handle);
+		/* Orphaned children are replaced, a new child may reuse the address of
+		 * a freed one whose object is gone */
+		if (cached != Qnil && ltns_da_get_data_access(cached) == child)
+		{
+			LTNSDataAccessDestroy(child);
+			return cached;
+		}
+	}
+	else
+	{
+		VALUE children = rb_class_new_instance(0, NULL, rb_path2class("ObjectSpace::WeakMap"));
+		RB_OBJ_WRITE(self, &wrapper->children, children);
+	}
+
+	VALUE obj = ltns_da_wrap(child, self);
+	rb_funcall(wrapper->children, id_aset, 2, handle, obj);
+	return obj;
+}
+
 VALUE ltns_da_set(VALUE self, VALUE key, VALUE new_value)
 {
 	Wrapper *wrapper;
-	Data_Get_Struct(self, Wrapper, wrapper);
-	key = ltns_da_key2str(key);
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	ltns_da_check_frozen(self);
+	/* Other threads may run while the change waits for readers */
+	key = rb_str_new_frozen(ltns_da_key2str(key));
 	char* key_cstr = StringValueCStr(key);
 
 	if (new_value == Qnil)
 		return ltns_da_delete(self, key);
 
-	LTNSError error = 0;
-	LTNSTerm *term = NULL;
-	/* Get the tnetstring if new_value is a DataAccess */
-	if (strncmp(rb_class2name(CLASS_OF(new_value)), "LazyTNetstring::DataAccess", 26) == 0)
-	{
-		Wrapper *wrapper;
-		Data_Get_Struct(new_value, Wrapper, wrapper);
-		error = LTNSDataAccessAsTerm(wrapper->data_access, &term);
-	}
-	else /* Other wise just try do dump new_value */
+	ltns_record_snapshot(self, wrapper->data_access);
+	/* DataAccess values are read once readers are done, as they may be
+	 * parts of this document. Others are dumped first, that runs ruby code */
+	LTNSDataAccess* source = NULL;
+	VALUE dumped = Qnil;
+	char* dumped_cstr = NULL;
+	if (IS_DATA_ACCESS(new_value))
+		source = ltns_da_get_data_access(new_value);
+	else
 	{
-		VALUE new_value_dumped = ltns_dump(cModule, new_value);
-		char* new_value_dumped_cstr = StringValueCStr(new_value_dumped);
-		error = LTNSTermCreateFromTNestring(&term, new_value_dumped_cstr);
+		dumped = ltns_dump(cModule, new_value);
+		dumped_cstr = StringValueCStr(dumped);
 	}
-	ltns_da_raise_on_error(error);
-	error = LTNSDataAccessSet(wrapper->data_access, key_cstr, term);
+	if (wrapper->memo != Qnil)
+		ltns_da_memo_sync(wrapper);
+
+	double start = ltns_slow_operation_start();
+	LTNSTerm *term = NULL;
+	LTNSError error;
+	ltns_da_begin_write(self);
+	if (source)
+		error = LTNSDataAccessAsTerm(source, &term);
+	else
+		error = LTNSTermCreateFromTNestring(&term, dumped_cstr);
+	if (!error)
+		error = LTNSDataAccessSet(wrapper->data_access, key_cstr, term);
+	ltns_da_end_write(self);
+	RB_GC_GUARD(new_value);
+	RB_GC_GUARD(dumped);
+	if (!term)
+		ltns_da_raise_on_error(error);
+	char* payload;
+	size_t length;
+	LTNSType type;
+	LTNSTermGetPayload(term, &payload, &length, &type);
 	LTNSTermDestroy(term);
+	/* The document changed even if writing the journal failed */
+	if (error != IO_ERROR)
+		ltns_da_raise_on_error(error);
+	if (wrapper->memo != Qnil)
+		ltns_da_memo_forget(wrapper, key);
+	ltns_da_changed(self);
+	ltns_record(RECORD_SET, self, wrapper->data_access, key_cstr, type, length);
+	/* Last, the hook may raise */
+	ltns_slow_operation_finish("set", key, wrapper->data_access, 0, start);
 	ltns_da_raise_on_error(error);
 
 	return Qnil;
@@ -166,14 +465,32 @@ VALUE ltns_da_set(VALUE self, VALUE key, VALUE new_value)
 
 VALUE ltns_da_delete(VALUE self, VALUE key)
 {
-	VALUE ret = ltns_da_get(self, key);
+	ltns_da_check_frozen(self);
 
 	Wrapper *wrapper;
-	Data_Get_Struct(self, Wrapper, wrapper);
-	key = ltns_da_key2str(key);
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	/* Other threads may run while the change waits for readers */
+	key = rb_str_new_frozen(ltns_da_key2str(key));
 	char* key_cstr = StringValueCStr(key);
 
+	/* The old value is only returned, reading it isn't recorded as a get */
+	if (wrapper->memo != Qnil)
+		ltns_da_memo_sync(wrapper);
+	VALUE ret = ltns_da_fetch(self, wrapper, key, key_cstr);
+
+	ltns_record(RECORD_DELETE, self, wrapper->data_access, key_cstr, LTNS_UNDEFINED, 0);
+	double start = ltns_slow_operation_start();
+	ltns_da_begin_write(self);
 	LTNSError error = LTNSDataAccessRemove(wrapper->data_access, key_cstr);
+	ltns_da_end_write(self);
+	if (error != KEY_NOT_FOUND && error != IO_ERROR)
+		ltns_da_raise_on_error(error);
+	/* get synced the memo */
+	if (wrapper->memo != Qnil)
+		ltns_da_memo_forget(wrapper, key);
+	if (error != KEY_NOT_FOUND)
+		ltns_da_changed(self);
+	ltns_slow_operation_finish("delete", key, wrapper->data_access, 0, start);
 	if (error != KEY_NOT_FOUND)
 		ltns_da_raise_on_error(error);
 
@@ -212,7 +529,7 @@ VALUE ltns_da_decrement_value_ruby(VALUE self, VALUE key)
 VALUE ltns_da_get_root_tnetstring(VALUE self)
 {
 	Wrapper *wrapper;
-	Data_Get_Struct(self, Wrapper, wrapper);
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
 
 	LTNSDataAccess *root = LTNSDataAccessGetRoot(wrapper->data_access);
 	if (!root)
@@ -224,13 +541,13 @@ VALUE ltns_da_get_root_tnetstring(VALUE self)
 	size_t length;
 	LTNSTermGetTNetstring(term, &tnetstring, &length);
 	LTNSTermDestroy(term);
-	return rb_str_new(tnetstring, length);
+	return ltns_da_string_at(self, tnetstring, length);
 }
 
 VALUE ltns_da_get_tnetstring(VALUE self)
 {
 	Wrapper *wrapper;
-	Data_Get_Struct(self, Wrapper, wrapper);
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
 
 	LTNSTerm *term = NULL;
 	LTNSError error = LTNSDataAccessAsTerm(wrapper->data_access, &term);
@@ -239,13 +556,136 @@ VALUE ltns_da_get_tnetstring(VALUE self)
 	size_t length;
 	LTNSTermGetTNetstring(term, &tnetstring, &length);
 	LTNSTermDestroy(term);
-	return rb_str_new(tnetstring, length);
+	return ltns_da_string_at(self, tnetstring, length);
+}
+
+/* Copies data out of self's document unless the root is frozen, then
+ * longer strings are substrings of the root's string. Ruby shares the bytes
+ * of substrings running to the end of the document, the others it copies */
+static VALUE ltns_da_string_at(VALUE self, const char* data, size_t length)
+{
+	if (length < SHARED_STRING_MIN_LENGTH)
+		return rb_str_new(data, length);
+
+	Wrapper *wrapper;
+	TypedData_Get_Struct(ltns_da_root(self), Wrapper, &ltns_da_type, wrapper);
+	if (wrapper->string == Qnil)
+		return rb_str_new(data, length);
+
+	return rb_str_substr(wrapper->string, data - RSTRING_PTR(wrapper->string), length);
+}
+
+/* Lets index know when self or anything below it changes */
+void ltns_da_add_index(VALUE self, VALUE index)
+{
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	if (OBJ_FROZEN(ltns_da_root(self)))
+		return;
+	if (wrapper->indexes == Qnil)
+		RB_OBJ_WRITE(self, &wrapper->indexes, rb_ary_new());
+	rb_ary_push(wrapper->indexes, index);
+}
+
+void ltns_da_remove_index(VALUE self, VALUE index)
+{
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	if (wrapper->indexes != Qnil)
+		rb_ary_delete(wrapper->indexes, index);
+}
+
+/* Updates the indexes of self and of the objects it was reached from */
+void ltns_da_changed(VALUE self)
+{
+	Wrapper *wrapper;
+	long i;
+	for (; self != Qnil; self = wrapper->parent)
+	{
+		TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+		if (wrapper->indexes == Qnil)
+			continue;
+		for (i = 0; i < RARRAY_LEN(wrapper->indexes); i++)
+			ltns_index_update(rb_ary_entry(wrapper->indexes, i), self);
+	}
+}
+
+/* Frozen roots lend their bytes to strings, nothing below them may change */
+void ltns_da_check_frozen(VALUE self)
+{
+	rb_check_frozen(self);
+	rb_check_frozen(ltns_da_root(self));
+}
+
+static VALUE ltns_da_wait_for_readers(VALUE ptr)
+{
+	Wrapper *wrapper = (Wrapper*)ptr;
+	while (wrapper->readers)
+		rb_thread_wait_for(READER_POLL_INTERVAL);
+	return Qnil;
+}
+
+/* Readers need the GVL back to unlock, so the writer sleeps meanwhile. New
+ * readers see the waiting writer and keep the GVL until the change ends.
+ * Other threads may have frozen the document since it was checked. */
+void ltns_da_begin_write(VALUE self)
+{
+	Wrapper *wrapper;
+	VALUE root = ltns_da_root(self);
+	TypedData_Get_Struct(root, Wrapper, &ltns_da_type, wrapper);
+	wrapper->writers++;
+
+	int state = 0;
+	if (wrapper->readers)
+		rb_protect(ltns_da_wait_for_readers, (VALUE)wrapper, &state);
+	if (state)
+	{
+		wrapper->writers--;
+		rb_jump_tag(state);
+	}
+	if (OBJ_FROZEN(self) || OBJ_FROZEN(root))
+	{
+		wrapper->writers--;
+		ltns_da_check_frozen(self);
+	}
+}
+
+void ltns_da_end_write(VALUE self)
+{
+	Wrapper *wrapper;
+	TypedData_Get_Struct(ltns_da_root(self), Wrapper, &ltns_da_type, wrapper);
+	wrapper->writers--;
+}
+
+/* Frozen roots can't change and may be shared by Ractors, they aren't
+ * counted. Fails while a change waits or runs so writers aren't starved by
+ * new readers, the caller then reads with the GVL. */
+int ltns_da_lock(VALUE self)
+{
+	Wrapper *wrapper;
+	VALUE root = ltns_da_root(self);
+	TypedData_Get_Struct(root, Wrapper, &ltns_da_type, wrapper);
+	if (OBJ_FROZEN(root))
+		return TRUE;
+	if (wrapper->writers)
+		return FALSE;
+	wrapper->readers++;
+	return TRUE;
+}
+
+void ltns_da_unlock(VALUE self)
+{
+	Wrapper *wrapper;
+	VALUE root = ltns_da_root(self);
+	TypedData_Get_Struct(root, Wrapper, &ltns_da_type, wrapper);
+	if (!OBJ_FROZEN(root))
+		wrapper->readers--;
 }
 
 VALUE ltns_da_get_offset(VALUE self)
 {
 	Wrapper *wrapper;
-	Data_Get_Struct(self, Wrapper, wrapper);
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
 
 	size_t offset;
 	LTNSDataAccessOffset(wrapper->data_access, &offset);
@@ -254,11 +694,15 @@ VALUE ltns_da_get_offset(VALUE self)
 
 VALUE ltns_da_is_empty(VALUE self)
 {
-	VALUE scoped_data = ltns_da_get_tnetstring(self);
-	char* tnetstring = StringValueCStr(scoped_data);
-	if (strncmp(tnetstring, "0:}", 3) == 0)
-		return Qtrue;
-	return Qfalse;
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+
+	LTNSTerm *term = NULL;
+	size_t length;
+	ltns_da_raise_on_error(LTNSDataAccessAsTerm(wrapper->data_access, &term));
+	LTNSTermGetPayloadLength(term, &length);
+	LTNSTermDestroy(term);
+	return length == 0 ? Qtrue : Qfalse;
 }
 
 VALUE ltns_da_each(VALUE self)
@@ -270,7 +714,7 @@ VALUE ltns_da_each(VALUE self)
 		return Qnil;
 
 	Wrapper *wrapper;
-	Data_Get_Struct(self, Wrapper, wrapper);
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
 
 	LTNSTerm *term = NULL;
 	LTNSError error = LTNSDataAccessAsTerm(wrapper->data_access, &term);
@@ -365,24 +809,18 @@ VALUE ltns_da_values(VALUE self)
 	return values;
 }
 
-VALUE ltns_da_as_json(int argc, VALUE* argv, VALUE self)
-{
-	/* FIXME: Support options argument */
-	return ltns_da_to_hash(self);
-}
-
 VALUE ltns_da_initialize_copy(VALUE copy, VALUE orig)
 {
 	if (copy == orig)
 		return copy;
 
-	Wrapper *copy_wrapper, *orig_wrapper;
-	Data_Get_Struct(copy, Wrapper, copy_wrapper);
-	Data_Get_Struct(orig, Wrapper, orig_wrapper);
-
-	if (TYPE(orig) != T_DATA || RDATA(orig)->dfree != (RUBY_DATA_FUNC)ltns_da_free)
+	if (!IS_DATA_ACCESS(orig))
 		rb_raise(rb_eTypeError, "Wrong argument type");
 
+	Wrapper *copy_wrapper, *orig_wrapper;
+	TypedData_Get_Struct(copy, Wrapper, &ltns_da_type, copy_wrapper);
+	TypedData_Get_Struct(orig, Wrapper, &ltns_da_type, orig_wrapper);
+
 	if (copy_wrapper->data_access)
 		ltns_da_raise_on_error(INVALID_ARGUMENT);
 
@@ -396,21 +834,238 @@ VALUE ltns_da_initialize_copy(VALUE copy, VALUE orig)
 	LTNSTermDestroy(term);
 
 	/* Create new root copy from original */
-	copy_wrapper->parent = Qnil;
-	error = LTNSDataAccessCreate(&copy_wrapper->data_access, tnetstring, length);
-	ltns_da_raise_on_error(error);
+	RB_OBJ_WRITE(copy, &copy_wrapper->parent, Qnil);
+	CreateArgs args = { &copy_wrapper->data_access, tnetstring, length, 0 };
+	ltns_da_without_gvl(orig, length, ltns_da_create_without_gvl, &args);
+	ltns_da_raise_on_error(args.error);
+	if (orig_wrapper->memo != Qnil)
+		ltns_da_memoize(copy, copy_wrapper);
 
 	return copy;
 }
 
 VALUE ltns_da_eql(VALUE self, VALUE other)
 {
-	if (TYPE(other) != T_DATA || RDATA(other)->dfree != (RUBY_DATA_FUNC)ltns_da_free)
+	if (!IS_DATA_ACCESS(other))
 		return Qfalse;
 
-	VALUE self_tnetstring = ltns_da_get_tnetstring(self);
-	VALUE other_tnetstring = ltns_da_get_tnetstring(other);
-	return rb_funcall(self_tnetstring, rb_intern("=="), 1, other_tnetstring);
+	Wrapper *wrapper, *other_wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	TypedData_Get_Struct(other, Wrapper, &ltns_da_type, other_wrapper);
+
+	/* Compare the live byte ranges in place instead of copying them */
+	int equal = FALSE;
+	LTNSError error = LTNSDataAccessEquals(wrapper->data_access, other_wrapper->data_access, &equal);
+	ltns_da_raise_on_error(error);
+	return equal ? Qtrue : Qfalse;
+}
+
+VALUE ltns_da_equivalent(VALUE self, VALUE other)
+{
+	if (!IS_DATA_ACCESS(other))
+		return Qfalse;
+
+	Wrapper *wrapper, *other_wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	TypedData_Get_Struct(other, Wrapper, &ltns_da_type, other_wrapper);
+
+	int equivalent = FALSE;
+	LTNSError error = LTNSDataAccessEquivalent(wrapper->data_access, other_wrapper->data_access, &equivalent);
+	ltns_da_raise_on_error(error);
+	return equivalent ? Qtrue : Qfalse;
+}
+
+/* other is a DataAccess or a tnetstring, policy one of :deep, :replace or :keep */
+VALUE ltns_da_deep_merge(int argc, VALUE* argv, VALUE self)
+{
+	VALUE other = Qnil, policy = Qnil;
+	rb_scan_args(argc, argv, "11", &other, &policy);
+
+	LTNSMergePolicy merge_policy = LTNS_MERGE_DEEP;
+	if (policy == ID2SYM(rb_intern("replace")))
+		merge_policy = LTNS_MERGE_REPLACE;
+	else if (policy == ID2SYM(rb_intern("keep")))
+		merge_policy = LTNS_MERGE_KEEP;
+	else if (policy != Qnil && policy != ID2SYM(rb_intern("deep")))
+		rb_raise(rb_eArgError, "unknown merge policy");
+	ltns_da_check_frozen(self);
+
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+
+	LTNSError error;
+	if (IS_DATA_ACCESS(other))
+	{
+		Wrapper *other_wrapper;
+		TypedData_Get_Struct(other, Wrapper, &ltns_da_type, other_wrapper);
+		ltns_da_begin_write(self);
+		error = LTNSDataAccessMerge(wrapper->data_access, other_wrapper->data_access, merge_policy);
+		ltns_da_end_write(self);
+	}
+	else
+	{
+		/* Other threads may run while the change waits for readers */
+		StringValue(other);
+		other = rb_str_new_frozen(other);
+		ltns_da_begin_write(self);
+		error = LTNSDataAccessMergeTNetstring(wrapper->data_access, RSTRING_PTR(other), RSTRING_LEN(other), merge_policy);
+		ltns_da_end_write(self);
+		RB_GC_GUARD(other);
+	}
+	if (error != IO_ERROR)
+		ltns_da_raise_on_error(error);
+	ltns_da_changed(self);
+	ltns_da_raise_on_error(error);
+
+	return self;
+}
+
+/* Each path is a key or an array of keys */
+VALUE ltns_da_slice(int argc, VALUE* argv, VALUE self)
+{
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+
+	/* Convert every key first so nothing raises while we hold C memory */
+	long key_count = 0;
+	VALUE paths = ltns_da_convert_paths(argc, argv, &key_count);
+
+	VALUE paths_tmp, keys_tmp;
+	LTNSPath* c_paths = ALLOCV_N(LTNSPath, paths_tmp, argc);
+	const char** c_keys = ALLOCV_N(const char*, keys_tmp, key_count);
+	ltns_da_fill_paths(paths, c_paths, c_keys);
+
+	LTNSBuffer buffer;
+	LTNSDataAccess *data_access = NULL;
+	LTNSError error = LTNSBufferInit(&buffer, 0);
+	if (!error)
+	{
+		error = LTNSDataAccessProject(wrapper->data_access, c_paths, argc, &buffer);
+		if (!error)
+			error = LTNSDataAccessCreateFromBuffer(&data_access, &buffer);
+		LTNSBufferDestroy(&buffer);
+	}
+	ALLOCV_END(paths_tmp);
+	ALLOCV_END(keys_tmp);
+	RB_GC_GUARD(paths);
+	ltns_da_raise_on_error(error);
+
+	return ltns_da_wrap(data_access, Qnil);
+}
+
+VALUE ltns_da_convert_paths(long count, const VALUE* paths, long* key_count)
+{
+	VALUE converted = rb_ary_new2(count);
+	long i, j;
+	*key_count = 0;
+	for (i = 0; i < count; i++)
+	{
+		VALUE path = rb_check_array_type(paths[i]);
+		if (path == Qnil)
+			path = rb_ary_new3(1, paths[i]);
+		VALUE keys = rb_ary_new2(RARRAY_LEN(path));
+		for (j = 0; j < RARRAY_LEN(path); j++)
+		{
+			VALUE key = ltns_da_key2str(rb_ary_entry(path, j));
+			StringValueCStr(key);
+			rb_ary_push(keys, rb_str_new_frozen(key));
+		}
+		*key_count += RARRAY_LEN(keys);
+		rb_ary_push(converted, keys);
+	}
+
+	return converted;
+}
+
+void ltns_da_fill_paths(VALUE paths, LTNSPath* c_paths, const char** c_keys)
+{
+	long i, j;
+	for (i = 0; i < RARRAY_LEN(paths); i++)
+	{
+		VALUE keys = rb_ary_entry(paths, i);
+		c_paths[i].keys = c_keys;
+		c_paths[i].length = RARRAY_LEN(keys);
+		for (j = 0; j < RARRAY_LEN(keys); j++)
+			*c_keys++ = RSTRING_PTR(rb_ary_entry(keys, j));
+	}
+}
+
+VALUE ltns_da_fingerprint(VALUE self)
+{
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+
+	uint64_t hash = 0;
+	LTNSError error = LTNSDataAccessHash(wrapper->data_access, &hash);
+	ltns_da_raise_on_error(error);
+	return ULL2NUM(hash);
+}
+
+VALUE ltns_da_hash(VALUE self)
+{
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+
+	uint64_t hash = 0;
+	LTNSError error = LTNSDataAccessHash(wrapper->data_access, &hash);
+	ltns_da_raise_on_error(error);
+	/* Stay within Fixnum range so no Bignum gets allocated */
+	return LONG2FIX((long)(hash & FIXNUM_MAX));
+}
+
+/* Freezing a root freezes its document, reading it then has no side effects
+ * and Ractor.make_shareable can share it. Frozen objects don't cache their
+ * children or memoize values anymore */
+VALUE ltns_da_freeze(VALUE self)
+{
+	if (OBJ_FROZEN(self))
+		return self;
+
+	ltns_da_freeze_document(self);
+	return rb_call_super(0, NULL);
+}
+
+static void ltns_da_freeze_document(VALUE self)
+{
+	static ID id_document = 0;
+	Wrapper *wrapper;
+	TypedData_Get_Struct(self, Wrapper, &ltns_da_type, wrapper);
+	if (wrapper->data_access && wrapper->parent == Qnil)
+	{
+		ltns_da_raise_on_error(LTNSDataAccessFreeze(wrapper->data_access));
+
+		/* The document can't move or change anymore and roots keep a NUL
+		 * after it. Made now as Ractors may share the root once it's frozen,
+		 * the hidden reference keeps the document alive for the string */
+		LTNSTerm *term = NULL;
+		char* tnetstring;
+		size_t length;
+		ltns_da_raise_on_error(LTNSDataAccessAsTerm(wrapper->data_access, &term));
+		LTNSTermGetTNetstring(term, &tnetstring, &length);
+		LTNSTermDestroy(term);
+		if (!id_document)
+			id_document = rb_intern("__ltns_document__");
+		VALUE string = rb_str_new_static(tnetstring, length);
+		rb_ivar_set(string, id_document, self);
+		RB_OBJ_WRITE(self, &wrapper->string, rb_obj_freeze(string));
+	}
+	RB_OBJ_WRITE(self, &wrapper->children, Qnil);
+	RB_OBJ_WRITE(self, &wrapper->memo, Qnil);
+	/* Frozen documents don't change, indexes needn't hear of them */
+	RB_OBJ_WRITE(self, &wrapper->indexes, Qnil);
+}
+
+/* clone sets the frozen flag itself instead of calling freeze */
+VALUE ltns_da_initialize_clone(int argc, VALUE* argv, VALUE self)
+{
+	VALUE orig = Qnil, options = Qnil;
+	rb_scan_args(argc, argv, "1:", &orig, &options);
+
+	ltns_da_initialize_copy(self, orig);
+	VALUE freeze = options == Qnil ? Qnil : rb_hash_aref(options, ID2SYM(rb_intern("freeze")));
+	if (freeze == Qtrue || (freeze == Qnil && OBJ_FROZEN(orig)))
+		ltns_da_freeze_document(self);
+	return self;
 }
 
 VALUE ltns_da_inspect(VALUE self)
@@ -419,7 +1074,7 @@ VALUE ltns_da_inspect(VALUE self)
 	return rb_funcall(tnetstring, rb_intern("inspect"), 0);
 }
 
-static void ltns_da_raise_on_error(LTNSError error)
+void ltns_da_raise_on_error(LTNSError error)
 {
 	VALUE rb_Exception;
 	switch (error)
@@ -437,13 +1092,38 @@ static void ltns_da_raise_on_error(LTNSError error)
 		rb_raise(eInvalidScope, "Invalid scope");
 	case KEY_NOT_FOUND:
 		rb_raise(eKeyNotFound, "Key not found");
+	case INVALID_JSON:
+		rb_raise(eInvalidJSON, "Invalid JSON");
+	case INVALID_FILTER:
+		rb_raise(eInvalidFilter, "Invalid filter expression");
+	case FROZEN_DATA_ACCESS:
+		rb_raise(rb_eFrozenError, "can't modify frozen LazyTNetstring::DataAccess");
+	case IO_ERROR:
+		rb_sys_fail(NULL);
+	case CHECKSUM_MISMATCH:
+		rb_raise(eChecksumMismatch, "Checksum mismatch");
 	default:
 		rb_Exception = rb_const_get(rb_cObject, rb_intern("ArgumentError"));
 		rb_raise(rb_Exception, "Invalid argument");
 	}
 }
 
-static VALUE ltns_da_key2str(VALUE key)
+int ltns_is_main_ractor(void)
+{
+#ifdef HAVE_RUBY_RACTOR_H
+	return rb_ractor_local_storage_value(main_ractor_key) == Qtrue;
+#else
+	return TRUE;
+#endif
+}
+
+void ltns_check_main_ractor(void)
+{
+	if (!ltns_is_main_ractor())
+		rb_raise(rb_eRuntimeError, "only the main Ractor can change LazyTNetstring's hooks and settings");
+}
+
+VALUE ltns_da_key2str(VALUE key)
 {
 	VALUE str = key;
 
@@ -461,14 +1141,36 @@ static VALUE ltns_da_key2str(VALUE key)
 
 void Init_lazy_tnetstring()
 {
+#ifdef HAVE_RB_EXT_RACTOR_SAFE
+	rb_ext_ractor_safe(true);
+#endif
+#ifdef HAVE_RUBY_RACTOR_H
+	main_ractor_key = rb_ractor_local_storage_value_newkey();
+	rb_ractor_local_storage_value_set(main_ractor_key, Qtrue);
+#endif
 	cModule = rb_define_module("LazyTNetstring");
 	rb_define_module_function(cModule, "dump", ltns_dump, 1);
 	rb_define_module_function(cModule, "parse", ltns_parse_ruby, 1);
+	rb_define_module_function(cModule, "from_json", ltns_from_json, 1);
+	rb_define_module_function(cModule, "apply_journal", ltns_apply_journal, 2);
+	rb_define_module_function(cModule, "stats", ltns_stats, 0);
+	rb_define_module_function(cModule, "reset_stats", ltns_reset_stats, 0);
+	rb_define_module_function(cModule, "on_slow_operation", ltns_on_slow_operation, -1);
+	rb_define_module_function(cModule, "start_recording", ltns_start_recording, 1);
+	rb_define_module_function(cModule, "stop_recording", ltns_stop_recording, 0);
+	rb_define_module_function(cModule, "recording?", ltns_is_recording, 0);
+	rb_define_module_function(cModule, "gvl_release_threshold", ltns_gvl_release_threshold, 0);
+	rb_define_module_function(cModule, "gvl_release_threshold=", ltns_set_gvl_release_threshold, 1);
+	rb_define_module_function(cModule, "extract_many", ltns_extract_many, -1);
+	rb_define_module_function(cModule, "split_offsets", ltns_split_offsets, -1);
 
 	eInvalidTNetString = rb_define_class_under(cModule, "InvalidTNetString", rb_eStandardError);
 	eUnsupportedTopLevelDataStructure = rb_define_class_under(cModule, "UnsupportedTopLevelDataStructure", rb_eStandardError);
 	eInvalidScope = rb_define_class_under(cModule, "InvalidScope", rb_eStandardError);
 	eKeyNotFound = rb_define_class_under(cModule, "KeyNotFound", rb_eStandardError);
+	eInvalidJSON = rb_define_class_under(cModule, "InvalidJSON", rb_eStandardError);
+	eInvalidFilter = rb_define_class_under(cModule, "InvalidFilter", rb_eStandardError);
+	eChecksumMismatch = rb_define_class_under(cModule, "ChecksumMismatch", rb_eStandardError);
 
 	cDataAccess = rb_define_class_under(cModule, "DataAccess", rb_cObject);
 	rb_define_alloc_func(cDataAccess, ltns_da_alloc);
@@ -489,10 +1191,57 @@ void Init_lazy_tnetstring()
 	rb_define_alias(cDataAccess, "each_pair", "each");
 	rb_define_method(cDataAccess, "to_hash", ltns_da_to_hash, 0);
 	rb_define_method(cDataAccess, "as_json", ltns_da_as_json, -1);
+	rb_define_method(cDataAccess, "to_json", ltns_da_to_json, -1);
 	rb_define_method(cDataAccess, "initialize_copy", ltns_da_initialize_copy, 1);
+	rb_define_method(cDataAccess, "initialize_clone", ltns_da_initialize_clone, -1);
 	rb_define_method(cDataAccess, "eql?", ltns_da_eql, 1);
 	rb_define_alias(cDataAccess, "==", "eql?");
+	rb_define_method(cDataAccess, "hash", ltns_da_hash, 0);
+	rb_define_method(cDataAccess, "fingerprint", ltns_da_fingerprint, 0);
+	rb_define_method(cDataAccess, "equivalent?", ltns_da_equivalent, 1);
+	rb_define_method(cDataAccess, "deep_merge!", ltns_da_deep_merge, -1);
+	rb_define_method(cDataAccess, "slice", ltns_da_slice, -1);
 	rb_define_method(cDataAccess, "inspect", ltns_da_inspect, 0);
+	rb_define_method(cDataAccess, "freeze", ltns_da_freeze, 0);
+	rb_define_method(cDataAccess, "enable_journal", ltns_da_enable_journal, -1);
+	rb_define_method(cDataAccess, "disable_journal", ltns_da_disable_journal, 0);
+	rb_define_method(cDataAccess, "journal", ltns_da_journal, 0);
+	rb_define_method(cDataAccess, "clear_journal", ltns_da_clear_journal, 0);
 	rb_define_method(cDataAccess, "keys", ltns_da_keys, 0);
 	rb_define_method(cDataAccess, "values", ltns_da_values, 0);
+	rb_define_method(cDataAccess, "stats", ltns_da_stats, 0);
+
+	cFilter = rb_define_class_under(cModule, "Filter", rb_cObject);
+	rb_define_alloc_func(cFilter, ltns_filter_alloc);
+	rb_define_method(cFilter, "initialize", ltns_filter_init, 1);
+	rb_define_method(cFilter, "match?", ltns_filter_match, 1);
+	rb_define_method(cFilter, "select", ltns_filter_select, 1);
+	rb_define_attr(cFilter, "expression", 1, 0);
+
+	cLog = rb_define_class_under(cModule, "Log", rb_cObject);
+	rb_include_module(cLog, rb_mEnumerable);
+	rb_define_alloc_func(cLog, ltns_log_alloc);
+	rb_define_method(cLog, "initialize", ltns_log_init, -1);
+	rb_define_method(cLog, "append", ltns_log_append, 1);
+	rb_define_method(cLog, "[]", ltns_log_get, 1);
+	rb_define_method(cLog, "each", ltns_log_each, 0);
+	rb_define_method(cLog, "size", ltns_log_size, 0);
+	rb_define_alias(cLog, "length", "size");
+	rb_define_method(cLog, "sync", ltns_log_sync, 0);
+	rb_define_method(cLog, "close", ltns_log_close, 0);
+	rb_define_method(cLog, "closed?", ltns_log_is_closed, 0);
+	rb_define_attr(cLog, "path", 1, 0);
+
+	cIndex = rb_define_class_under(cModule, "Index", rb_cObject);
+	rb_define_alloc_func(cIndex, ltns_index_alloc);
+	rb_define_method(cIndex, "initialize", ltns_index_init, -1);
+	rb_define_method(cIndex, "add", ltns_index_add, 1);
+	rb_define_alias(cIndex, "<<", "add");
+	rb_define_method(cIndex, "delete", ltns_index_delete, 1);
+	rb_define_method(cIndex, "find", ltns_index_find, 1);
+	rb_define_method(cIndex, "range", ltns_index_range, 1);
+	rb_define_method(cIndex, "size", ltns_index_size, 0);
+	rb_define_alias(cIndex, "length", "size");
+	rb_define_method(cIndex, "documents", ltns_index_documents, 0);
+	rb_define_attr(cIndex, "path", 1, 0);
 }
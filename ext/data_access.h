@@ -3,12 +3,31 @@
 
 #include <ruby.h>
 
+#include "LTNS.h"
+
 void Init_lazy_tnetstring();
 
+extern const rb_data_type_t ltns_da_type;
+#define IS_DATA_ACCESS(obj) (rb_typeddata_is_kind_of((obj), &ltns_da_type))
+
+/* Frozen DataAccess and Filter objects can be shared between Ractors */
+#ifdef RUBY_TYPED_FROZEN_SHAREABLE
+#define LTNS_TYPED_DATA_FLAGS (RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED | RUBY_TYPED_FROZEN_SHAREABLE)
+#else
+#define LTNS_TYPED_DATA_FLAGS (RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED)
+#endif
+
 VALUE ltns_da_alloc(VALUE class);
 void ltns_da_mark(void* ptr);
 void ltns_da_free(void* ptr);
+size_t ltns_da_memsize(const void* ptr);
+#ifdef HAVE_RB_GC_LOCATION
+void ltns_da_compact(void* ptr);
+#endif
 VALUE ltns_da_init(int argc, VALUE* argv, VALUE self);
+VALUE ltns_da_wrap(LTNSDataAccess* data_access, VALUE parent);
+LTNSDataAccess* ltns_da_get_data_access(VALUE self);
+VALUE ltns_da_root(VALUE self);
 VALUE ltns_da_get(VALUE self, VALUE key);
 VALUE ltns_da_set(VALUE self, VALUE key, VALUE new_value);
 VALUE ltns_da_delete(VALUE self, VALUE key);
@@ -19,8 +38,38 @@ VALUE ltns_da_each(VALUE self);
 VALUE ltns_da_to_hash(VALUE self);
 VALUE ltns_da_keys(VALUE self);
 VALUE ltns_da_values(VALUE self);
-VALUE ltns_da_as_json(int argc, VALUE* argv, VALUE self);
 VALUE ltns_da_eql(VALUE self, VALUE other);
+VALUE ltns_da_equivalent(VALUE self, VALUE other);
+VALUE ltns_da_deep_merge(int argc, VALUE* argv, VALUE self);
+VALUE ltns_da_slice(int argc, VALUE* argv, VALUE self);
+VALUE ltns_da_fingerprint(VALUE self);
+VALUE ltns_da_hash(VALUE self);
 VALUE ltns_da_inspect(VALUE self);
+VALUE ltns_da_freeze(VALUE self);
+
+void ltns_da_raise_on_error(LTNSError error);
+void ltns_da_check_frozen(VALUE self);
+/* Bracket every C call changing self's document, it waits for threads
+ * reading the document without the GVL. No ruby code may run in between. */
+void ltns_da_begin_write(VALUE self);
+void ltns_da_end_write(VALUE self);
+/* Counts a thread reading self's document without the GVL. Returns FALSE
+ * while a change is under way, the document has to be read with the GVL
+ * then. Readers only read bytes of terms taken with the GVL. */
+int ltns_da_lock(VALUE self);
+void ltns_da_unlock(VALUE self);
+VALUE ltns_da_key2str(VALUE key);
+/* Indexes self is in hear of every change through set, delete and merges */
+void ltns_da_add_index(VALUE self, VALUE index);
+void ltns_da_remove_index(VALUE self, VALUE index);
+void ltns_da_changed(VALUE self);
+/* Converts each path, a key or an array of keys, to an array of frozen
+ * strings. ltns_da_fill_paths then points c_paths at them, taking key_count
+ * entries of c_keys */
+VALUE ltns_da_convert_paths(long count, const VALUE* paths, long* key_count);
+void ltns_da_fill_paths(VALUE paths, LTNSPath* c_paths, const char** c_keys);
+/* Hooks and settings are global, only the main Ractor may use them */
+int ltns_is_main_ractor(void);
+void ltns_check_main_ractor(void);
 
 #endif
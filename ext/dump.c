@@ -1,4 +1,4 @@
-#include <st.h>
+#include <ruby.h>
 
 #include "LTNS.h"
 
@@ -52,7 +52,7 @@ VALUE ltns_dump(VALUE module __attribute__ ((unused)), VALUE val)
 		ret = ltns_dump_string(rb_sym_to_s(val));
 		break;
 	case T_DATA:
-		if (RDATA(val)->dfree == (RUBY_DATA_FUNC)ltns_da_free)
+		if (IS_DATA_ACCESS(val))
 			ret = ltns_da_get_tnetstring(val);
 		else
 			ret = Qnil;
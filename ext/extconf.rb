@@ -1,4 +1,18 @@
 require 'mkmf'
 $CFLAGS += ' -Iinclude'
+# gem install lazy_tnetstring -- --disable-stats compiles the counters out
+$CFLAGS += ' -DLTNS_DISABLE_STATS' unless enable_config('stats', true)
+# static tracepoints, see include/LTNSProbes.h
+have_header('sys/sdt.h')
+# compaction support for DataAccess, ruby 2.7+
+have_func('rb_gc_location')
+# long reads of large documents let other threads run, ruby 2.0+
+have_header('ruby/thread.h')
+have_func('rb_thread_call_without_gvl', 'ruby/thread.h')
+# frozen documents can be shared between Ractors, ruby 3.0+
+have_header('ruby/ractor.h')
+have_func('rb_ext_ractor_safe')
+# LazyTNetstring.extract_many and split_offsets spread their work over threads
+have_library('pthread', 'pthread_create')
 CONFIG['warnflags'] = ' -Wall' if CONFIG['warnflags']
 create_makefile('lazy_tnetstring')
@@ -0,0 +1,125 @@
+#include <ruby.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "filter.h"
+#include "gvl.h"
+
+static LTNSFilter* ltns_filter_get(VALUE self);
+static int ltns_filter_match_document(LTNSFilter* filter, VALUE document);
+static void* ltns_filter_match_without_gvl(void* ptr);
+
+typedef struct _MatchArgs
+{
+	LTNSFilter* filter;
+	const char* tnetstring;
+	size_t length;
+	int match;
+	LTNSError error;
+} MatchArgs;
+
+static const rb_data_type_t ltns_filter_type =
+{
+	"LazyTNetstring::Filter",
+	{ NULL, ltns_filter_free, NULL, },
+	0, 0,
+	LTNS_TYPED_DATA_FLAGS
+};
+
+VALUE ltns_filter_alloc(VALUE class)
+{
+	return TypedData_Wrap_Struct(class, &ltns_filter_type, NULL);
+}
+
+void ltns_filter_free(void* ptr)
+{
+	if (ptr)
+		LTNSFilterDestroy((LTNSFilter*)ptr);
+}
+
+VALUE ltns_filter_init(VALUE self, VALUE expression)
+{
+	StringValue(expression);
+	/* Other threads may be matching against the filter without the GVL */
+	if (RTYPEDDATA_DATA(self))
+		rb_raise(rb_eTypeError, "already initialized filter");
+
+	LTNSFilter* filter = NULL;
+	LTNSError error = LTNSFilterCreate(&filter, RSTRING_PTR(expression), RSTRING_LEN(expression));
+	ltns_da_raise_on_error(error);
+
+	RTYPEDDATA_DATA(self) = filter;
+	rb_iv_set(self, "@expression", rb_str_new_frozen(expression));
+
+	return self;
+}
+
+/* document is a tnetstring or a DataAccess */
+VALUE ltns_filter_match(VALUE self, VALUE document)
+{
+	return ltns_filter_match_document(ltns_filter_get(self), document) ? Qtrue : Qfalse;
+}
+
+/* Returns the documents the filter matches */
+VALUE ltns_filter_select(VALUE self, VALUE documents)
+{
+	LTNSFilter* filter = ltns_filter_get(self);
+	documents = rb_convert_type(documents, T_ARRAY, "Array", "to_ary");
+
+	VALUE selected = rb_ary_new();
+	long i;
+	for (i = 0; i < RARRAY_LEN(documents); i++)
+	{
+		VALUE document = rb_ary_entry(documents, i);
+		if (ltns_filter_match_document(filter, document))
+			rb_ary_push(selected, document);
+	}
+
+	return selected;
+}
+
+static LTNSFilter* ltns_filter_get(VALUE self)
+{
+	LTNSFilter* filter;
+	TypedData_Get_Struct(self, LTNSFilter, &ltns_filter_type, filter);
+	if (!filter)
+		rb_raise(rb_eArgError, "uninitialized filter");
+	return filter;
+}
+
+static int ltns_filter_match_document(LTNSFilter* filter, VALUE document)
+{
+	MatchArgs args = { filter, NULL, 0, FALSE, 0 };
+
+	if (IS_DATA_ACCESS(document))
+	{
+		LTNSTerm* term = NULL;
+		char* tnetstring;
+		LTNSError error = LTNSDataAccessAsTerm(ltns_da_get_data_access(document), &term);
+		ltns_da_raise_on_error(error);
+		LTNSTermGetTNetstring(term, &tnetstring, &args.length);
+		LTNSTermDestroy(term);
+		args.tnetstring = tnetstring;
+		ltns_da_without_gvl(document, args.length, ltns_filter_match_without_gvl, &args);
+	}
+	else
+	{
+		StringValue(document);
+		document = ltns_stable_string(document);
+		args.tnetstring = RSTRING_PTR(document);
+		args.length = RSTRING_LEN(document);
+		ltns_without_gvl(args.length, ltns_filter_match_without_gvl, &args);
+		RB_GC_GUARD(document);
+	}
+	ltns_da_raise_on_error(args.error);
+
+	return args.match;
+}
+
+static void* ltns_filter_match_without_gvl(void* ptr)
+{
+	MatchArgs* args = (MatchArgs*)ptr;
+	args->error = LTNSFilterMatch(args->filter, args->tnetstring, args->length, &args->match);
+	return NULL;
+}
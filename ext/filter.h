@@ -0,0 +1,12 @@
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+#include <ruby.h>
+
+VALUE ltns_filter_alloc(VALUE class);
+void ltns_filter_free(void* ptr);
+VALUE ltns_filter_init(VALUE self, VALUE expression);
+VALUE ltns_filter_match(VALUE self, VALUE document);
+VALUE ltns_filter_select(VALUE self, VALUE documents);
+
+#endif
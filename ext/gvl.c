@@ -0,0 +1,79 @@
+#include <ruby.h>
+#ifdef HAVE_RUBY_THREAD_H
+#include <ruby/thread.h>
+#endif
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "gvl.h"
+
+/* Below a megabyte handing the GVL over costs more than the other threads
+ * gain */
+#define DEFAULT_GVL_RELEASE_THRESHOLD (1024 * 1024)
+
+static size_t gvl_release_threshold = DEFAULT_GVL_RELEASE_THRESHOLD;
+
+VALUE ltns_gvl_release_threshold(VALUE module __attribute__ ((unused)))
+{
+	if (gvl_release_threshold == SIZE_MAX)
+		return Qnil;
+	return SIZET2NUM(gvl_release_threshold);
+}
+
+/* Bytes from which work runs without the GVL, nil keeps it always */
+VALUE ltns_set_gvl_release_threshold(VALUE module __attribute__ ((unused)), VALUE threshold)
+{
+	ltns_check_main_ractor();
+	if (threshold == Qnil)
+	{
+		gvl_release_threshold = SIZE_MAX;
+		return threshold;
+	}
+
+	if (RTEST(rb_funcall(threshold, rb_intern("<"), 1, INT2FIX(0))))
+		rb_raise(rb_eArgError, "negative threshold");
+	gvl_release_threshold = NUM2SIZET(threshold);
+	return threshold;
+}
+
+int ltns_releases_gvl(size_t length)
+{
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+	return length >= gvl_release_threshold;
+#else
+	return FALSE;
+#endif
+}
+
+void ltns_without_gvl(size_t length, void* (*function)(void*), void* data)
+{
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+	/* The work can't be interrupted, other threads only wait for it */
+	if (ltns_releases_gvl(length))
+	{
+		rb_thread_call_without_gvl(function, data, NULL, NULL);
+		return;
+	}
+#endif
+	function(data);
+}
+
+void ltns_da_without_gvl(VALUE self, size_t length, void* (*function)(void*), void* data)
+{
+	if (!ltns_releases_gvl(length) || !ltns_da_lock(self))
+	{
+		function(data);
+		return;
+	}
+
+	ltns_without_gvl(length, function, data);
+	ltns_da_unlock(self);
+}
+
+VALUE ltns_stable_string(VALUE string)
+{
+	if (!ltns_releases_gvl(RSTRING_LEN(string)))
+		return string;
+	return rb_str_new_frozen(string);
+}
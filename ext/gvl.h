@@ -0,0 +1,21 @@
+#ifndef __GVL_H__
+#define __GVL_H__
+
+#include <ruby.h>
+
+VALUE ltns_gvl_release_threshold(VALUE module);
+VALUE ltns_set_gvl_release_threshold(VALUE module, VALUE threshold);
+
+/* Pure C work on length bytes runs without the GVL once length reaches
+ * LazyTNetstring.gvl_release_threshold. function must not touch ruby objects
+ * and the bytes it reads have to stay put: read strings through
+ * ltns_stable_string and DataAccess objects with ltns_da_without_gvl, which
+ * keeps their document from changing meanwhile. */
+int ltns_releases_gvl(size_t length);
+void ltns_without_gvl(size_t length, void* (*function)(void*), void* data);
+void ltns_da_without_gvl(VALUE self, size_t length, void* (*function)(void*), void* data);
+/* A frozen string sharing string's bytes if they'll be read without the GVL,
+ * changing string then copies it. Otherwise string itself */
+VALUE ltns_stable_string(VALUE string);
+
+#endif
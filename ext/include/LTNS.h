@@ -1,3 +1,12 @@
 #include "LTNSDataAccess.h"
 #include "LTNSTerm.h"
-
+#include "LTNSBuffer.h"
+#include "LTNSJson.h"
+#include "LTNSJournal.h"
+#include "LTNSSnapshot.h"
+#include "LTNSFilter.h"
+#include "LTNSBatch.h"
+#include "LTNSStream.h"
+#include "LTNSLog.h"
+#include "LTNSIndex.h"
+#include "LTNSStats.h"
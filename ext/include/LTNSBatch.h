@@ -0,0 +1,26 @@
+#ifndef __LTNSBATCH_H__
+#define __LTNSBATCH_H__
+
+#include "LTNSCommon.h"
+#include "LTNSTerm.h"
+
+/* A value found by LTNSBatchExtract, tnetstring points into the document
+ * and is NULL if the path is missing */
+typedef struct
+{
+	const char* tnetstring;
+	size_t length;
+} LTNSExtract;
+
+/* Looks up every path in every document without copying or allocating per
+ * document. results holds document_count * path_count values, the one at
+ * paths[j] in documents[i] is results[i * path_count + j]. Documents are
+ * only checked along the paths, values that can't be reached are missing.
+ *
+ * Documents are handed out in chunks to up to thread_count threads, the
+ * calling thread being one of them. Fewer threads run for small batches or
+ * if no more can be created. */
+LTNSError LTNSBatchExtract(const char* const* documents, const size_t* lengths, size_t document_count,
+		const LTNSPath* paths, size_t path_count, LTNSExtract* results, size_t thread_count);
+
+#endif//__LTNSBATCH_H__
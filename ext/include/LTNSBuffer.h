@@ -0,0 +1,29 @@
+#ifndef __LTNSBUFFER_H__
+#define __LTNSBUFFER_H__
+
+#include <stdlib.h>
+
+#include "LTNSCommon.h"
+
+/* Growing output buffer used when building tnetstrings or JSON in one pass */
+typedef struct
+{
+	char* data;
+	size_t length;
+	size_t capacity;
+} LTNSBuffer;
+
+LTNSError LTNSBufferInit(LTNSBuffer* buffer, size_t capacity);
+LTNSError LTNSBufferDestroy(LTNSBuffer* buffer);
+
+LTNSError LTNSBufferReserve(LTNSBuffer* buffer, size_t additional);
+LTNSError LTNSBufferAppend(LTNSBuffer* buffer, const char* data, size_t length);
+LTNSError LTNSBufferAppendChar(LTNSBuffer* buffer, char c);
+
+/* Writing a term whose payload length isn't known up front: BeginTerm
+ * reserves room for the largest prefix, EndTerm writes the prefix and
+ * type once the payload has been appended. */
+LTNSError LTNSBufferBeginTerm(LTNSBuffer* buffer, size_t* mark);
+LTNSError LTNSBufferEndTerm(LTNSBuffer* buffer, size_t mark, LTNSType type);
+
+#endif//__LTNSBUFFER_H__
@@ -30,7 +30,12 @@ typedef enum
 	INVALID_CHILD,
 	OUT_OF_MEMORY,
 	INVALID_ARGUMENT,
-	KEY_NOT_FOUND	
+	KEY_NOT_FOUND,
+	INVALID_JSON,
+	INVALID_FILTER,
+	FROZEN_DATA_ACCESS,
+	IO_ERROR, // NOTE: errno tells what failed
+	CHECKSUM_MISMATCH
 } LTNSError;
 
 int LTNSTypeIsValid( char type );
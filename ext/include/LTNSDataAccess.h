@@ -3,10 +3,20 @@
 
 #include "LTNSCommon.h"
 #include "LTNSTerm.h"
+#include "LTNSBuffer.h"
+#include "LTNSHash.h"
+#include "LTNSJournal.h"
 
 struct _LTNSDataAccess;
 typedef struct _LTNSDataAccess LTNSDataAccess;
 
+typedef enum
+{
+	LTNS_MERGE_REPLACE = 0, // values from the source win
+	LTNS_MERGE_KEEP,        // existing values win, only new keys are added
+	LTNS_MERGE_DEEP         // like replace, but dictionaries on both sides are merged
+} LTNSMergePolicy;
+
 typedef struct LTNSChildNode
 {
 	LTNSDataAccess* child;
@@ -15,14 +25,44 @@ typedef struct LTNSChildNode
 
 
 LTNSError LTNSDataAccessCreate(LTNSDataAccess** data_access, const char* tnetstring, size_t length);
+/* Takes over the buffer's memory instead of copying it */
+LTNSError LTNSDataAccessCreateFromBuffer(LTNSDataAccess** data_access, LTNSBuffer* buffer);
 LTNSError LTNSDataAccessCreateNested(LTNSDataAccess** child, LTNSDataAccess* parent, LTNSTerm *term);
 
 LTNSError LTNSDataAccessDestroy(LTNSDataAccess* data_access);
 
 LTNSError LTNSDataAccessParent(LTNSDataAccess* data_access, LTNSDataAccess** parent);
 LTNSError LTNSDataAccessChildren(LTNSDataAccess* data_access, LTNSChildNode** first_child);
+/* Number of cached children below data_access, at any depth */
+LTNSError LTNSDataAccessCountChildren(LTNSDataAccess* data_access, size_t* count);
+/* Changes whenever a key of data_access is set or removed, changes below a
+ * nested dictionary only change that dictionary's version */
+LTNSError LTNSDataAccessVersion(LTNSDataAccess* data_access, uint64_t* version);
+/* Bytes data_access itself holds: its struct and list of cached children,
+ * and for the root the document */
+LTNSError LTNSDataAccessMemsize(LTNSDataAccess* data_access, size_t* bytes);
+/* Length of the tnetstring data_access covers, prefix and type included */
+LTNSError LTNSDataAccessLength(LTNSDataAccess* data_access, size_t* length);
 
 LTNSError LTNSDataAccessOffset(LTNSDataAccess* data_access, size_t* offset);
+/* Keys leading from the root to data_access. Keys point into the document and
+ * aren't NUL terminated. With keys NULL only *depth is set, so callers can
+ * size the arrays first. */
+LTNSError LTNSDataAccessPath(LTNSDataAccess* data_access, const char** keys, size_t* key_lengths, size_t* depth);
+
+/* Makes the whole tree of data_access read-only, changes return
+ * FROZEN_DATA_ACCESS. Frozen trees stop caching children: nested accesses
+ * created afterwards aren't linked into their parent, so reading a frozen
+ * tree never writes to it and needs no locks between threads. Such children
+ * point into their parents and the document without the root knowing about
+ * them: destroy them before their parents and the root. Children of frozen
+ * trees always count as valid, so using one after the root is gone isn't
+ * caught. */
+LTNSError LTNSDataAccessFreeze(LTNSDataAccess* data_access);
+LTNSError LTNSDataAccessIsFrozen(LTNSDataAccess* data_access, int* frozen);
+/* A frozen root holding a copy of the tnetstring data_access covers, see
+ * LTNSSnapshot.h to hand such copies to other threads */
+LTNSError LTNSDataAccessSnapshot(LTNSDataAccess* data_access, LTNSDataAccess** snapshot);
 
 LTNSError LTNSDataAccessGet(LTNSDataAccess* data_access, const char* key, LTNSTerm** term);
 LTNSError LTNSDataAccessSet(LTNSDataAccess* data_access, const char* key, LTNSTerm* term);
@@ -30,6 +70,31 @@ LTNSError LTNSDataAccessRemove(LTNSDataAccess* data_access, const char* key);
 
 LTNSError LTNSDataAccessAsTerm(LTNSDataAccess* data_access, LTNSTerm** term);
 
+/* Byte-wise equality of the scoped tnetstrings */
+LTNSError LTNSDataAccessEquals(LTNSDataAccess* data_access, LTNSDataAccess* other, int* equal);
+/* Equality ignoring the order of dictionary keys */
+LTNSError LTNSDataAccessEquivalent(LTNSDataAccess* data_access, LTNSDataAccess* other, int* equivalent);
+/* Content hash of the scoped tnetstring, cached until the next change */
+LTNSError LTNSDataAccessHash(LTNSDataAccess* data_access, uint64_t* hash);
+
+/* Merges the keys of other into data_access in a single resize. Children of
+ * data_access get orphaned. */
+LTNSError LTNSDataAccessMerge(LTNSDataAccess* data_access, LTNSDataAccess* other, LTNSMergePolicy policy);
+LTNSError LTNSDataAccessMergeTNetstring(LTNSDataAccess* data_access, const char* tnetstring, size_t length, LTNSMergePolicy policy);
+
+/* Copies the values at paths into out as a new dictionary, keeping the
+ * nesting of the paths. Values aren't parsed, missing paths are left out. */
+LTNSError LTNSDataAccessProject(LTNSDataAccess* data_access, const LTNSPath* paths, size_t path_count, LTNSBuffer* out);
+
+/* Records every Set and Remove below the root in a journal, see
+ * LTNSJournal.h. Paths in the journal are relative to the root. */
+LTNSError LTNSDataAccessEnableJournal(LTNSDataAccess* data_access, int fd);
+LTNSError LTNSDataAccessDisableJournal(LTNSDataAccess* data_access);
+/* *journal is NULL if journaling isn't enabled */
+LTNSError LTNSDataAccessGetJournal(LTNSDataAccess* data_access, LTNSJournal** journal);
+/* Replays journal operations. Sets are absolute so replaying is idempotent. */
+LTNSError LTNSDataAccessApplyJournal(LTNSDataAccess* data_access, const char* operations, size_t length);
+
 LTNSDataAccess *LTNSDataAccessGetRoot( LTNSDataAccess* data_access );
 
 #endif
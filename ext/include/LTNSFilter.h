@@ -0,0 +1,24 @@
+#ifndef __LTNSFILTER_H__
+#define __LTNSFILTER_H__
+
+#include "LTNSCommon.h"
+#include "LTNSTerm.h"
+
+struct _LTNSFilter;
+typedef struct _LTNSFilter LTNSFilter;
+
+/* Compiles a predicate such as
+ *
+ *   status == "active" && (user.level > 10 || !user.banned)
+ *
+ * Operands are dotted key paths or string, number, true, false and null
+ * literals. A path on its own is true if it exists and isn't null or false.
+ * Comparisons with a missing path are false. Returns INVALID_FILTER on
+ * syntax errors. */
+LTNSError LTNSFilterCreate(LTNSFilter** filter, const char* expression, size_t length);
+LTNSError LTNSFilterDestroy(LTNSFilter* filter);
+
+/* Evaluates the filter on a dictionary tnetstring without copying it */
+LTNSError LTNSFilterMatch(LTNSFilter* filter, const char* tnetstring, size_t length, int* match);
+
+#endif//__LTNSFILTER_H__
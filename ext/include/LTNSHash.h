@@ -0,0 +1,10 @@
+#ifndef __LTNSHASH_H__
+#define __LTNSHASH_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* 64 bit non-cryptographic content hash (XXH64) */
+uint64_t LTNSHash64(const char* data, size_t length, uint64_t seed);
+
+#endif//__LTNSHASH_H__
@@ -0,0 +1,47 @@
+#ifndef __LTNSINDEX_H__
+#define __LTNSINDEX_H__
+
+#include "LTNSCommon.h"
+#include "LTNSTerm.h"
+
+struct _LTNSIndex;
+typedef struct _LTNSIndex LTNSIndex;
+
+/* A bound of a range lookup, a single tnetstring value. NULL bounds are open. */
+typedef struct
+{
+	const char* tnetstring;
+	size_t length;
+	int exclusive;
+} LTNSIndexBound;
+
+/* A secondary index of the values many dictionaries hold at one path.
+ * Documents are numbered by the caller, densely from 0. The index keeps a
+ * copy of each document's value in order, so lookups are binary searches
+ * that never touch the documents.
+ *
+ * Values order by type first: null, booleans, numbers, strings, lists and
+ * dictionaries. Integers and floats compare by their numbers, everything
+ * else by its payload bytes. Documents with equal values order by their
+ * numbers. */
+LTNSError LTNSIndexCreate(LTNSIndex** index, const LTNSPath* path);
+LTNSError LTNSIndexDestroy(LTNSIndex* index);
+
+/* Reads the value at the path of the dictionary tnetstring with a single
+ * lookup and indexes document under it, replacing its previous value.
+ * Documents missing the path aren't indexed. Unchanged values cost a
+ * comparison. */
+LTNSError LTNSIndexUpdate(LTNSIndex* index, size_t document, const char* tnetstring, size_t length);
+/* Takes document out of the index, if it's in there */
+LTNSError LTNSIndexRemove(LTNSIndex* index, size_t document);
+
+/* Number of documents indexed */
+LTNSError LTNSIndexCount(LTNSIndex* index, size_t* count);
+/* Positions [*first, *last) in value order of the documents with values
+ * between low and high. Pass the same bound twice for an equality lookup. */
+LTNSError LTNSIndexFind(LTNSIndex* index, const LTNSIndexBound* low, const LTNSIndexBound* high,
+		size_t* first, size_t* last);
+/* The document at position in value order */
+LTNSError LTNSIndexDocument(LTNSIndex* index, size_t position, size_t* document);
+
+#endif//__LTNSINDEX_H__
@@ -0,0 +1,39 @@
+#ifndef __LTNSJOURNAL_H__
+#define __LTNSJOURNAL_H__
+
+#include "LTNSCommon.h"
+#include "LTNSBuffer.h"
+
+struct _LTNSJournal;
+typedef struct _LTNSJournal LTNSJournal;
+
+typedef enum
+{
+	LTNS_JOURNAL_SET = 0,
+	LTNS_JOURNAL_REMOVE
+} LTNSJournalOperation;
+
+/* Each recorded operation is one tnetstring list of the form
+ * [operation, [key, ...], value], so a journal is a plain concatenation of
+ * tnetstrings. With fd >= 0 operations are written through to fd instead
+ * of being kept in memory.
+ *
+ * The journal is write-behind: operations are recorded once they have been
+ * applied. If writing to fd fails the change stays in the document, is
+ * missing from the journal and the change returns IO_ERROR. */
+LTNSError LTNSJournalCreate(LTNSJournal** journal, int fd);
+LTNSError LTNSJournalDestroy(LTNSJournal* journal);
+
+LTNSError LTNSJournalRecord(LTNSJournal* journal, LTNSJournalOperation operation,
+		const char** keys, const size_t* key_lengths, size_t depth,
+		const char* term, size_t term_length);
+
+LTNSError LTNSJournalGetOperations(LTNSJournal* journal, const char** operations, size_t* length);
+LTNSError LTNSJournalClear(LTNSJournal* journal);
+
+/* Decodes the operation at position. keys points to the payload of the
+ * path list, *next to the following operation. */
+LTNSError LTNSJournalNext(const char* position, const char* end, LTNSJournalOperation* operation,
+		char** keys, size_t* keys_length, char** term, size_t* term_length, const char** next);
+
+#endif//__LTNSJOURNAL_H__
@@ -0,0 +1,30 @@
+#ifndef __LTNSJSON_H__
+#define __LTNSJSON_H__
+
+#include "LTNSCommon.h"
+#include "LTNSTerm.h"
+#include "LTNSDataAccess.h"
+#include "LTNSBuffer.h"
+
+typedef enum
+{
+	LTNS_JSON_ALL = 0,
+	LTNS_JSON_ONLY,
+	LTNS_JSON_EXCEPT
+} LTNSJsonFilter;
+
+/* Transcodes a term straight into JSON, appending to out. Numbers outside
+ * the JSON grammar and strings that aren't valid UTF-8 fail with
+ * INVALID_TNETSTRING. */
+LTNSError LTNSTermToJSON(LTNSTerm* term, LTNSBuffer* out);
+
+/* Same as LTNSTermToJSON for a dictionary term, keeping only (or dropping)
+ * the given top level keys. Only reads the term's bytes. */
+LTNSError LTNSTermToJSONFiltered(LTNSTerm* term, LTNSJsonFilter filter, const char** keys, size_t key_count, LTNSBuffer* out);
+/* LTNSTermToJSONFiltered for the scoped dictionary */
+LTNSError LTNSDataAccessToJSON(LTNSDataAccess* data_access, LTNSJsonFilter filter, const char** keys, size_t key_count, LTNSBuffer* out);
+
+/* Parses JSON and writes the equivalent tnetstring to out in one pass */
+LTNSError LTNSJsonToTNetstring(const char* json, size_t length, LTNSBuffer* out);
+
+#endif//__LTNSJSON_H__
@@ -0,0 +1,37 @@
+#ifndef __LTNSLOG_H__
+#define __LTNSLOG_H__
+
+#include "LTNSCommon.h"
+
+struct _LTNSLog;
+typedef struct _LTNSLog LTNSLog;
+
+/* An append-only file of tnetstring records with an index for random
+ * access. Each entry of the log file is a list [checksum, record], the
+ * checksum being the hex XXH64 of the record, so the file is a stream of
+ * tnetstrings itself, see LTNSStream.h. The index file next to it (path
+ * with ".idx" appended) holds the offset of each entry as 8 little endian
+ * bytes.
+ *
+ * Opening a log checks the index against the log file and indexes entries
+ * missing from it. When writable, an incomplete entry at the end of the log
+ * file (from a crash while appending) is cut off. */
+LTNSError LTNSLogOpen(LTNSLog** log, const char* path, int writable);
+LTNSError LTNSLogClose(LTNSLog* log);
+
+/* Appends a single tnetstring, *index is set to its record number if not
+ * NULL. Returns IO_ERROR with errno set if writing fails. */
+LTNSError LTNSLogAppend(LTNSLog* log, const char* tnetstring, size_t length, size_t* index);
+/* Flushes appended records to disk */
+LTNSError LTNSLogSync(LTNSLog* log);
+
+LTNSError LTNSLogCount(LTNSLog* log, size_t* count);
+/* Points *record into the memory mapped log file, it stays valid until the
+ * next Append or Close. Returns CHECKSUM_MISMATCH if the record changed
+ * since it was appended. */
+LTNSError LTNSLogGet(LTNSLog* log, size_t index, const char** record, size_t* length);
+/* Asks the kernel to read the entries of count records from first on ahead,
+ * for sequential reads */
+LTNSError LTNSLogPrefetch(LTNSLog* log, size_t first, size_t count);
+
+#endif//__LTNSLOG_H__
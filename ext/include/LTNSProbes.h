@@ -0,0 +1,32 @@
+#ifndef __LTNSPROBES_H__
+#define __LTNSPROBES_H__
+
+/* Static tracepoints of provider "lazy_tnetstring" for perf, bpftrace or
+ * systemtap, e.g.
+ *
+ *   bpftrace -e 'usdt:lazy_tnetstring.so:lazy_tnetstring:set__return
+ *       { printf("%s %d\n", str(arg0), arg2); }'
+ *
+ * Without <sys/sdt.h> (HAVE_SYS_SDT_H) they compile to nothing.
+ *
+ *   get__entry(key, length)                    get__return(key, error)
+ *   set__entry(key, length, value length)      set__return(key, error, length)
+ *   remove__entry(key, length)                 remove__return(key, error, length)
+ *   expand__entry(document length, delta)      expand__return(bytes moved)
+ *   shrink__entry(document length, delta)      shrink__return(bytes moved)
+ *   parse__entry(tnetstring, length)           parse__return(success)
+ *
+ * length is the length of the (nested) data access operated on. */
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define LTNS_PROBE1(name, a) DTRACE_PROBE1(lazy_tnetstring, name, a)
+#define LTNS_PROBE2(name, a, b) DTRACE_PROBE2(lazy_tnetstring, name, a, b)
+#define LTNS_PROBE3(name, a, b, c) DTRACE_PROBE3(lazy_tnetstring, name, a, b, c)
+#else
+#define LTNS_PROBE1(name, a) ((void)0)
+#define LTNS_PROBE2(name, a, b) ((void)0)
+#define LTNS_PROBE3(name, a, b, c) ((void)0)
+#endif
+
+#endif//__LTNSPROBES_H__
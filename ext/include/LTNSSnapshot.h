@@ -0,0 +1,42 @@
+#ifndef __LTNSSNAPSHOT_H__
+#define __LTNSSNAPSHOT_H__
+
+#include "LTNSCommon.h"
+#include "LTNSDataAccess.h"
+
+struct _LTNSSnapshots;
+typedef struct _LTNSSnapshots LTNSSnapshots;
+struct _LTNSSnapshotReader;
+typedef struct _LTNSSnapshotReader LTNSSnapshotReader;
+
+/* Versions of a document for one writer and any number of reader threads.
+ * The writer changes its own LTNSDataAccess and publishes a frozen copy of
+ * it, see LTNSDataAccessSnapshot. Readers never wait: they acquire the
+ * current version, read it (and create children of it) without locks and
+ * release it again. Replaced versions are freed once no reader can still
+ * hold them, using epoch based reclamation: readers announce the epoch they
+ * started in and the epoch only advances when all active readers are in it,
+ * so versions replaced two epochs back are unreachable.
+ *
+ * Publishing copies the whole document, writers should batch their changes.
+ * Publish and Reclaim must not run concurrently with each other. */
+LTNSError LTNSSnapshotsCreate(LTNSSnapshots** snapshots, LTNSDataAccess* data_access);
+/* No reader may be active anymore */
+LTNSError LTNSSnapshotsDestroy(LTNSSnapshots* snapshots);
+
+LTNSError LTNSSnapshotsPublish(LTNSSnapshots* snapshots, LTNSDataAccess* data_access);
+/* Frees the replaced versions no reader can hold anymore, Publish does this,
+ * too. *pending is set to the number still waiting if not NULL */
+LTNSError LTNSSnapshotsReclaim(LTNSSnapshots* snapshots, size_t* pending);
+
+/* Every reader thread joins once and uses its own reader, left readers are
+ * reused by the next thread joining */
+LTNSError LTNSSnapshotsJoin(LTNSSnapshots* snapshots, LTNSSnapshotReader** reader);
+LTNSError LTNSSnapshotsLeave(LTNSSnapshotReader* reader);
+
+/* *snapshot is the current version until LTNSSnapshotRelease, children
+ * created from it have to be destroyed before. Acquires don't nest. */
+LTNSError LTNSSnapshotAcquire(LTNSSnapshotReader* reader, LTNSDataAccess** snapshot);
+LTNSError LTNSSnapshotRelease(LTNSSnapshotReader* reader);
+
+#endif//__LTNSSNAPSHOT_H__
@@ -0,0 +1,38 @@
+#ifndef __LTNSSTATS_H__
+#define __LTNSSTATS_H__
+
+#include <stdint.h>
+
+#include "LTNSCommon.h"
+
+/* Counters of the work done by the core library. They are kept per thread
+ * and cost one increment each, except live_children which is process wide.
+ * Define LTNS_DISABLE_STATS to compile them out entirely. */
+typedef struct
+{
+	uint64_t terms_parsed;         // term headers read by LTNSTermScan
+	uint64_t bytes_scanned;        // payload bytes walked looking up keys
+	uint64_t bytes_moved;          // bytes memmoved to grow or shrink documents
+	uint64_t reallocs;             // reallocations of root tnetstrings
+	uint64_t prefix_width_changes; // length prefixes that gained or lost a digit
+	uint64_t nodes_visited;        // child tree nodes visited updating offsets
+	int64_t live_children;         // nested data accesses currently allocated
+} LTNSStats;
+
+#ifdef LTNS_DISABLE_STATS
+#define LTNS_STATS_ADD(counter, n) ((void)0)
+#define LTNS_STATS_LIVE_CHILDREN(n) ((void)0)
+#else
+extern __thread LTNSStats LTNSThreadStats;
+extern int64_t LTNSLiveChildren;
+#define LTNS_STATS_ADD(counter, n) (LTNSThreadStats.counter += (n))
+#define LTNS_STATS_LIVE_CHILDREN(n) __atomic_add_fetch(&LTNSLiveChildren, (n), __ATOMIC_RELAXED)
+#endif
+
+/* Copies the counters of the calling thread */
+LTNSError LTNSStatsGet(LTNSStats* stats);
+/* Zeroes the counters of the calling thread, live_children keeps counting
+ * what is still allocated */
+void LTNSStatsReset(void);
+
+#endif//__LTNSSTATS_H__
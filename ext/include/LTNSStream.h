@@ -0,0 +1,19 @@
+#ifndef __LTNSSTREAM_H__
+#define __LTNSSTREAM_H__
+
+#include "LTNSCommon.h"
+
+/* Finds the records of a stream of concatenated tnetstrings, such as a log
+ * file read or mapped into memory. *offsets is set to a table of *count + 1
+ * offsets to free() afterwards: record i spans offsets[i] up to
+ * offsets[i + 1]. The table ends after the last complete record, bytes from
+ * offsets[*count] on don't start a valid one. Only the length prefixes and
+ * types of the records are checked, not their payloads.
+ *
+ * With more than one thread each thread resynchronizes at a guessed record
+ * start in its part of the stream and follows the records from there. The
+ * parts are then chained from the start of the stream, taking over the
+ * records of a part where the chains meet. */
+LTNSError LTNSStreamSplit(const char* stream, size_t length, size_t thread_count, size_t** offsets, size_t* count);
+
+#endif//__LTNSSTREAM_H__
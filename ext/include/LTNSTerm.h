@@ -8,6 +8,13 @@
 struct _LTNSTerm;
 typedef struct _LTNSTerm LTNSTerm;
 
+/* A sequence of dictionary keys leading to a nested value */
+typedef struct
+{
+	const char** keys;
+	size_t length;
+} LTNSPath;
+
 LTNSError LTNSTermCreate( LTNSTerm **term, const char *payload, size_t payload_length, LTNSType type );
 
 LTNSError LTNSTermCreateNested( LTNSTerm **term, char *tnetstring, char *tnet_end  );
@@ -25,4 +32,17 @@ LTNSError LTNSTermGetTNetstring( LTNSTerm *term, char** tnetstring, size_t* leng
 
 LTNSError LTNSTermParse(LTNSTerm* term, char *tnet_end );
 
+/* Parses the term header at tnetstring without allocating a term. The term
+ * ends at *payload + *payload_length + 1. */
+LTNSError LTNSTermScan(const char* tnetstring, const char* tnet_end, char** payload, size_t* payload_length, LTNSType* type);
+
+/* Looks up key in a dictionary payload without allocating. Returns
+ * KEY_NOT_FOUND if the key isn't there. */
+LTNSError LTNSTermFindKey(const char* payload, const char* payload_end, const char* key, size_t key_length, char** key_position, char** value_position);
+
+/* Follows path down from the dictionary term at tnetstring. *value points
+ * to the term found. Returns KEY_NOT_FOUND if a key is missing or a value on
+ * the way isn't a dictionary. */
+LTNSError LTNSTermGetPath(const char* tnetstring, const char* tnet_end, const LTNSPath* path, char** value);
+
 #endif//__LTNSTERM_H___
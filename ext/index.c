@@ -0,0 +1,259 @@
+#include <ruby.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "index.h"
+#include "dump.h"
+
+extern VALUE cModule;
+
+typedef struct _IndexWrapper
+{
+	LTNSIndex* index;
+	/* The indexed DataAccess objects, by their number in index */
+	VALUE documents;
+	/* Identity hash of the documents to their numbers */
+	VALUE numbers;
+} IndexWrapper;
+
+static IndexWrapper* ltns_index_get(VALUE self);
+static void ltns_index_read(LTNSIndex* index, size_t number, VALUE document);
+static VALUE ltns_index_lookup(VALUE self, VALUE low, VALUE high, int exclusive);
+
+static const rb_data_type_t ltns_index_type =
+{
+	"LazyTNetstring::Index",
+	{
+		ltns_index_mark,
+		ltns_index_free,
+		NULL,
+#ifdef HAVE_RB_GC_LOCATION
+		ltns_index_compact,
+#endif
+	},
+	0, 0,
+	/* documents and numbers are only ever written through RB_OBJ_WRITE */
+	RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED
+};
+
+VALUE ltns_index_alloc(VALUE class)
+{
+	IndexWrapper *wrapper = calloc(1, sizeof(IndexWrapper));
+	if (!wrapper)
+		ltns_da_raise_on_error(OUT_OF_MEMORY);
+
+	wrapper->documents = Qnil;
+	wrapper->numbers = Qnil;
+	return TypedData_Wrap_Struct(class, &ltns_index_type, wrapper);
+}
+
+void ltns_index_mark(void* ptr)
+{
+	IndexWrapper *wrapper = (IndexWrapper*)ptr;
+#ifdef HAVE_RB_GC_LOCATION
+	rb_gc_mark_movable(wrapper->documents);
+	rb_gc_mark_movable(wrapper->numbers);
+#else
+	rb_gc_mark(wrapper->documents);
+	rb_gc_mark(wrapper->numbers);
+#endif
+}
+
+#ifdef HAVE_RB_GC_LOCATION
+void ltns_index_compact(void* ptr)
+{
+	IndexWrapper *wrapper = (IndexWrapper*)ptr;
+	wrapper->documents = rb_gc_location(wrapper->documents);
+	wrapper->numbers = rb_gc_location(wrapper->numbers);
+}
+#endif
+
+void ltns_index_free(void* ptr)
+{
+	IndexWrapper *wrapper = (IndexWrapper*)ptr;
+	if (wrapper->index)
+		LTNSIndexDestroy(wrapper->index);
+	free(wrapper);
+}
+
+/* Index.new(path, documents = []) indexes the value at path, a key or an
+ * array of keys, of each document */
+VALUE ltns_index_init(int argc, VALUE* argv, VALUE self)
+{
+	VALUE path, documents = Qnil;
+	rb_scan_args(argc, argv, "11", &path, &documents);
+
+	IndexWrapper *wrapper;
+	TypedData_Get_Struct(self, IndexWrapper, &ltns_index_type, wrapper);
+	if (wrapper->index)
+		rb_raise(rb_eTypeError, "already initialized index");
+
+	long key_count = 0;
+	VALUE paths = ltns_da_convert_paths(1, &path, &key_count);
+	volatile VALUE keys_tmp;
+	LTNSPath c_path;
+	const char** c_keys = ALLOCV_N(const char*, keys_tmp, key_count);
+	ltns_da_fill_paths(paths, &c_path, c_keys);
+	LTNSError error = LTNSIndexCreate(&wrapper->index, &c_path);
+	ALLOCV_END(keys_tmp);
+	ltns_da_raise_on_error(error);
+
+	RB_OBJ_WRITE(self, &wrapper->documents, rb_ary_new());
+	VALUE numbers = rb_hash_new();
+	rb_funcall(numbers, rb_intern("compare_by_identity"), 0);
+	RB_OBJ_WRITE(self, &wrapper->numbers, numbers);
+	rb_iv_set(self, "@path", rb_obj_freeze(rb_ary_entry(paths, 0)));
+
+	if (documents != Qnil)
+	{
+		documents = rb_convert_type(documents, T_ARRAY, "Array", "to_ary");
+		long i;
+		for (i = 0; i < RARRAY_LEN(documents); i++)
+			ltns_index_add(self, rb_ary_entry(documents, i));
+	}
+
+	return self;
+}
+
+/* Indexes document with one lookup of the path. Setting or deleting keys of
+ * document, or of objects reached from it, keeps it up to date. */
+VALUE ltns_index_add(VALUE self, VALUE document)
+{
+	IndexWrapper *wrapper = ltns_index_get(self);
+	if (!IS_DATA_ACCESS(document))
+		rb_raise(rb_eTypeError, "expected a LazyTNetstring::DataAccess");
+	if (rb_hash_lookup2(wrapper->numbers, document, Qundef) != Qundef)
+		return self;
+
+	size_t number = RARRAY_LEN(wrapper->documents);
+	ltns_index_read(wrapper->index, number, document);
+	rb_ary_push(wrapper->documents, document);
+	rb_hash_aset(wrapper->numbers, document, SIZET2NUM(number));
+	ltns_da_add_index(document, self);
+
+	return self;
+}
+
+/* Returns document, or nil if it wasn't indexed. The last document takes
+ * its number so the numbers stay dense. */
+VALUE ltns_index_delete(VALUE self, VALUE document)
+{
+	IndexWrapper *wrapper = ltns_index_get(self);
+	VALUE number = rb_hash_lookup2(wrapper->numbers, document, Qundef);
+	if (number == Qundef)
+		return Qnil;
+
+	size_t removed = NUM2SIZET(number), last = RARRAY_LEN(wrapper->documents) - 1;
+	ltns_da_raise_on_error(LTNSIndexRemove(wrapper->index, removed));
+	rb_hash_delete(wrapper->numbers, document);
+	ltns_da_remove_index(document, self);
+
+	VALUE moved = rb_ary_pop(wrapper->documents);
+	if (removed != last)
+	{
+		ltns_da_raise_on_error(LTNSIndexRemove(wrapper->index, last));
+		rb_ary_store(wrapper->documents, removed, moved);
+		rb_hash_aset(wrapper->numbers, moved, number);
+		ltns_index_read(wrapper->index, removed, moved);
+	}
+
+	return document;
+}
+
+/* The documents whose value equals value, without reading the documents */
+VALUE ltns_index_find(VALUE self, VALUE value)
+{
+	value = ltns_dump(cModule, value);
+	return ltns_index_lookup(self, value, value, FALSE);
+}
+
+/* The documents whose value lies in range, in the order of their values.
+ * Ranges may be open on either end. */
+VALUE ltns_index_range(VALUE self, VALUE range)
+{
+	VALUE low, high;
+	int exclusive;
+	if (!rb_range_values(range, &low, &high, &exclusive))
+		rb_raise(rb_eTypeError, "expected a Range");
+
+	if (low != Qnil)
+		low = ltns_dump(cModule, low);
+	if (high != Qnil)
+		high = ltns_dump(cModule, high);
+	return ltns_index_lookup(self, low, high, exclusive);
+}
+
+VALUE ltns_index_size(VALUE self)
+{
+	return LONG2NUM(RARRAY_LEN(ltns_index_get(self)->documents));
+}
+
+VALUE ltns_index_documents(VALUE self)
+{
+	return rb_ary_dup(ltns_index_get(self)->documents);
+}
+
+void ltns_index_update(VALUE self, VALUE document)
+{
+	IndexWrapper *wrapper = ltns_index_get(self);
+	VALUE number = rb_hash_lookup2(wrapper->numbers, document, Qundef);
+	if (number != Qundef)
+		ltns_index_read(wrapper->index, NUM2SIZET(number), document);
+}
+
+static IndexWrapper* ltns_index_get(VALUE self)
+{
+	IndexWrapper *wrapper;
+	TypedData_Get_Struct(self, IndexWrapper, &ltns_index_type, wrapper);
+	if (!wrapper->index)
+		rb_raise(rb_eArgError, "uninitialized index");
+	return wrapper;
+}
+
+/* Reads document's value in place, the index copies it */
+static void ltns_index_read(LTNSIndex* index, size_t number, VALUE document)
+{
+	LTNSTerm* term = NULL;
+	char* tnetstring;
+	size_t length;
+	LTNSError error = LTNSDataAccessAsTerm(ltns_da_get_data_access(document), &term);
+	ltns_da_raise_on_error(error);
+	LTNSTermGetTNetstring(term, &tnetstring, &length);
+	LTNSTermDestroy(term);
+
+	ltns_da_raise_on_error(LTNSIndexUpdate(index, number, tnetstring, length));
+}
+
+/* low and high are dumped values or nil for open ends */
+static VALUE ltns_index_lookup(VALUE self, VALUE low, VALUE high, int exclusive)
+{
+	IndexWrapper *wrapper = ltns_index_get(self);
+	LTNSIndexBound low_bound = { NULL, 0, FALSE }, high_bound = { NULL, 0, exclusive };
+	size_t first, last, position, number;
+
+	if (low != Qnil)
+	{
+		low_bound.tnetstring = RSTRING_PTR(low);
+		low_bound.length = RSTRING_LEN(low);
+	}
+	if (high != Qnil)
+	{
+		high_bound.tnetstring = RSTRING_PTR(high);
+		high_bound.length = RSTRING_LEN(high);
+	}
+	LTNSError error = LTNSIndexFind(wrapper->index, low == Qnil ? NULL : &low_bound,
+			high == Qnil ? NULL : &high_bound, &first, &last);
+	ltns_da_raise_on_error(error);
+
+	VALUE found = rb_ary_new2(last - first);
+	for (position = first; position < last; position++)
+	{
+		LTNSIndexDocument(wrapper->index, position, &number);
+		rb_ary_push(found, rb_ary_entry(wrapper->documents, number));
+	}
+
+	RB_GC_GUARD(low);
+	RB_GC_GUARD(high);
+	return found;
+}
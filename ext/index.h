@@ -0,0 +1,23 @@
+#ifndef __INDEX_H__
+#define __INDEX_H__
+
+#include <ruby.h>
+
+VALUE ltns_index_alloc(VALUE class);
+void ltns_index_mark(void* ptr);
+void ltns_index_free(void* ptr);
+#ifdef HAVE_RB_GC_LOCATION
+void ltns_index_compact(void* ptr);
+#endif
+VALUE ltns_index_init(int argc, VALUE* argv, VALUE self);
+VALUE ltns_index_add(VALUE self, VALUE document);
+VALUE ltns_index_delete(VALUE self, VALUE document);
+VALUE ltns_index_find(VALUE self, VALUE value);
+VALUE ltns_index_range(VALUE self, VALUE range);
+VALUE ltns_index_size(VALUE self);
+VALUE ltns_index_documents(VALUE self);
+
+/* Reindexes document after it changed */
+void ltns_index_update(VALUE self, VALUE document);
+
+#endif
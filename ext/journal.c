@@ -0,0 +1,83 @@
+#include <ruby.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "journal.h"
+
+/* Takes nil (keep operations in memory), a file descriptor or an IO.
+ * Changes are written after they're made, if writing fails they raise a
+ * SystemCallError but stay in the document. */
+VALUE ltns_da_enable_journal(int argc, VALUE* argv, VALUE self)
+{
+	VALUE io = Qnil;
+	rb_scan_args(argc, argv, "01", &io);
+	ltns_da_check_frozen(self);
+
+	int fd = -1;
+	if (FIXNUM_P(io))
+		fd = FIX2INT(io);
+	else if (io != Qnil)
+		fd = NUM2INT(rb_funcall(io, rb_intern("fileno"), 0));
+
+	LTNSError error = LTNSDataAccessEnableJournal(ltns_da_get_data_access(self), fd);
+	ltns_da_raise_on_error(error);
+
+	/* Keep the IO from being collected (and closed) while we write to it */
+	rb_ivar_set(ltns_da_root(self), rb_intern("@journal_io"), io);
+	return self;
+}
+
+VALUE ltns_da_disable_journal(VALUE self)
+{
+	ltns_da_check_frozen(self);
+	LTNSError error = LTNSDataAccessDisableJournal(ltns_da_get_data_access(self));
+	ltns_da_raise_on_error(error);
+	rb_ivar_set(ltns_da_root(self), rb_intern("@journal_io"), Qnil);
+	return self;
+}
+
+VALUE ltns_da_journal(VALUE self)
+{
+	LTNSJournal* journal = NULL;
+	LTNSError error = LTNSDataAccessGetJournal(ltns_da_get_data_access(self), &journal);
+	ltns_da_raise_on_error(error);
+	if (!journal)
+		return Qnil;
+
+	const char* operations;
+	size_t length;
+	LTNSJournalGetOperations(journal, &operations, &length);
+	return rb_str_new(operations, length);
+}
+
+VALUE ltns_da_clear_journal(VALUE self)
+{
+	ltns_da_check_frozen(self);
+	LTNSJournal* journal = NULL;
+	LTNSError error = LTNSDataAccessGetJournal(ltns_da_get_data_access(self), &journal);
+	ltns_da_raise_on_error(error);
+	if (journal)
+		LTNSJournalClear(journal);
+	return self;
+}
+
+VALUE ltns_apply_journal(VALUE module __attribute__ ((unused)), VALUE doc, VALUE operations)
+{
+	if (!IS_DATA_ACCESS(doc))
+		rb_raise(rb_eTypeError, "expected a LazyTNetstring::DataAccess");
+	ltns_da_check_frozen(doc);
+	StringValue(operations);
+	/* Other threads may run while the change waits for readers */
+	operations = rb_str_new_frozen(operations);
+
+	ltns_da_begin_write(doc);
+	LTNSError error = LTNSDataAccessApplyJournal(ltns_da_get_data_access(doc),
+			RSTRING_PTR(operations), RSTRING_LEN(operations));
+	ltns_da_end_write(doc);
+	RB_GC_GUARD(operations);
+	/* Operations applied before an error stay applied */
+	ltns_da_changed(doc);
+	ltns_da_raise_on_error(error);
+	return doc;
+}
@@ -0,0 +1,12 @@
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <ruby.h>
+
+VALUE ltns_da_enable_journal(int argc, VALUE* argv, VALUE self);
+VALUE ltns_da_disable_journal(VALUE self);
+VALUE ltns_da_journal(VALUE self);
+VALUE ltns_da_clear_journal(VALUE self);
+VALUE ltns_apply_journal(VALUE module, VALUE doc, VALUE operations);
+
+#endif
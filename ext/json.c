@@ -0,0 +1,210 @@
+#include <ruby.h>
+#include <ruby/encoding.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "json.h"
+#include "gvl.h"
+#include "parse.h"
+
+typedef struct _ToJSONArgs
+{
+	LTNSTerm* term;
+	LTNSJsonFilter filter;
+	const char** keys;
+	size_t key_count;
+	LTNSBuffer* out;
+	LTNSError error;
+} ToJSONArgs;
+
+typedef struct _FromJSONArgs
+{
+	const char* json;
+	size_t length;
+	LTNSBuffer* out;
+	LTNSError error;
+} FromJSONArgs;
+
+static VALUE ltns_json_filter_keys(VALUE options, LTNSJsonFilter* filter);
+static void* ltns_to_json_without_gvl(void* ptr);
+static void* ltns_from_json_without_gvl(void* ptr);
+
+VALUE ltns_da_as_json(int argc, VALUE* argv, VALUE self)
+{
+	VALUE options = Qnil;
+	rb_scan_args(argc, argv, "01", &options);
+
+	VALUE hash = ltns_da_to_hash(self);
+	if (TYPE(options) != T_HASH)
+		return hash;
+
+	LTNSJsonFilter filter = LTNS_JSON_ALL;
+	VALUE filter_keys = ltns_json_filter_keys(options, &filter);
+	if (filter == LTNS_JSON_ALL)
+		return hash;
+
+	VALUE filtered = rb_hash_new();
+	VALUE keys = rb_funcall(hash, rb_intern("keys"), 0);
+	long i;
+	for (i = 0; i < RARRAY_LEN(keys); i++)
+	{
+		VALUE key = rb_ary_entry(keys, i);
+		int found = rb_ary_includes(filter_keys, key) == Qtrue;
+		if (found == (filter == LTNS_JSON_ONLY))
+			rb_hash_aset(filtered, key, rb_hash_aref(hash, key));
+	}
+
+	return filtered;
+}
+
+VALUE ltns_da_to_json(int argc, VALUE* argv, VALUE self)
+{
+	VALUE options = Qnil;
+	rb_scan_args(argc, argv, "01", &options);
+
+	/* The JSON generator passes its state object, only hashes carry filters */
+	LTNSJsonFilter filter = LTNS_JSON_ALL;
+	VALUE filter_keys = Qnil;
+	if (TYPE(options) == T_HASH)
+		filter_keys = ltns_json_filter_keys(options, &filter);
+
+	/* Copies of the keys, the GVL may be released while they are read */
+	long key_count = filter_keys == Qnil ? 0 : RARRAY_LEN(filter_keys);
+	VALUE keys_tmp;
+	const char** keys = ALLOCV_N(const char*, keys_tmp, key_count > 0 ? key_count : 1);
+	size_t key_bytes = 1;
+	long i;
+	for (i = 0; i < key_count; i++)
+	{
+		VALUE key = rb_ary_entry(filter_keys, i);
+		key_bytes += strlen(StringValueCStr(key)) + 1;
+	}
+	VALUE key_copies_tmp;
+	char* key_copy = ALLOCV(key_copies_tmp, key_bytes);
+	for (i = 0; i < key_count; i++)
+	{
+		VALUE key = rb_ary_entry(filter_keys, i);
+		size_t key_length = RSTRING_LEN(key) + 1;
+		keys[i] = memcpy(key_copy, RSTRING_PTR(key), key_length);
+		key_copy += key_length;
+	}
+
+	LTNSBuffer buffer;
+	LTNSError error = LTNSBufferInit(&buffer, 0);
+	ltns_da_raise_on_error(error);
+
+	/* Without the GVL only the document's bytes are read, children are
+	 * looked up before */
+	LTNSTerm* term = NULL;
+	char* tnetstring;
+	size_t length;
+	error = LTNSDataAccessAsTerm(ltns_da_get_data_access(self), &term);
+	if (error)
+	{
+		LTNSBufferDestroy(&buffer);
+		ltns_da_raise_on_error(error);
+	}
+	LTNSTermGetTNetstring(term, &tnetstring, &length);
+	ToJSONArgs args = { term, filter, keys, key_count, &buffer, 0 };
+	ltns_da_without_gvl(self, length, ltns_to_json_without_gvl, &args);
+	LTNSTermDestroy(term);
+	ALLOCV_END(key_copies_tmp);
+	ALLOCV_END(keys_tmp);
+	if (args.error)
+	{
+		LTNSBufferDestroy(&buffer);
+		ltns_da_raise_on_error(args.error);
+	}
+
+	VALUE json = rb_str_new(buffer.data, buffer.length);
+	LTNSBufferDestroy(&buffer);
+	rb_enc_associate(json, rb_utf8_encoding());
+
+	return json;
+}
+
+static void* ltns_to_json_without_gvl(void* ptr)
+{
+	ToJSONArgs* args = (ToJSONArgs*)ptr;
+	args->error = LTNSTermToJSONFiltered(args->term, args->filter, args->keys, args->key_count, args->out);
+	return NULL;
+}
+
+VALUE ltns_from_json(VALUE module __attribute__ ((unused)), VALUE json)
+{
+	StringValue(json);
+	json = ltns_stable_string(json);
+
+	LTNSBuffer buffer;
+	LTNSError error = LTNSBufferInit(&buffer, RSTRING_LEN(json) + MAX_PREFIX_LENGTH + 1);
+	ltns_da_raise_on_error(error);
+	FromJSONArgs args = { RSTRING_PTR(json), RSTRING_LEN(json), &buffer, 0 };
+	ltns_without_gvl(args.length, ltns_from_json_without_gvl, &args);
+	RB_GC_GUARD(json);
+	error = args.error;
+	if (error)
+	{
+		LTNSBufferDestroy(&buffer);
+		ltns_da_raise_on_error(error);
+	}
+
+	/* Objects become a DataAccess owning the buffer, without another copy */
+	if (buffer.data[buffer.length - 1] == LTNS_DICTIONARY)
+	{
+		LTNSDataAccess *data_access = NULL;
+		error = LTNSDataAccessCreateFromBuffer(&data_access, &buffer);
+		if (error)
+		{
+			LTNSBufferDestroy(&buffer);
+			ltns_da_raise_on_error(error);
+		}
+		return ltns_da_wrap(data_access, Qnil);
+	}
+
+	VALUE ret = Qnil;
+	int ok = ltns_parse(buffer.data, buffer.data + buffer.length, &ret);
+	LTNSBufferDestroy(&buffer);
+	if (!ok)
+		ltns_da_raise_on_error(INVALID_TNETSTRING);
+
+	return ret;
+}
+
+static void* ltns_from_json_without_gvl(void* ptr)
+{
+	FromJSONArgs* args = (FromJSONArgs*)ptr;
+	args->error = LTNSJsonToTNetstring(args->json, args->length, args->out);
+	return NULL;
+}
+
+/* Reads ActiveSupport style :only / :except options into an array of key strings */
+static VALUE ltns_json_filter_keys(VALUE options, LTNSJsonFilter* filter)
+{
+	VALUE keys = rb_hash_aref(options, ID2SYM(rb_intern("only")));
+	if (keys != Qnil)
+	{
+		*filter = LTNS_JSON_ONLY;
+	}
+	else
+	{
+		keys = rb_hash_aref(options, ID2SYM(rb_intern("except")));
+		if (keys == Qnil)
+			return Qnil;
+		*filter = LTNS_JSON_EXCEPT;
+	}
+
+	VALUE ary = rb_ary_new();
+	if (TYPE(keys) == T_ARRAY)
+	{
+		long i;
+		for (i = 0; i < RARRAY_LEN(keys); i++)
+			rb_ary_push(ary, ltns_da_key2str(rb_ary_entry(keys, i)));
+	}
+	else
+	{
+		rb_ary_push(ary, ltns_da_key2str(keys));
+	}
+
+	return ary;
+}
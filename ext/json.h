@@ -0,0 +1,10 @@
+#ifndef __JSON_H__
+#define __JSON_H__
+
+#include <ruby.h>
+
+VALUE ltns_da_as_json(int argc, VALUE* argv, VALUE self);
+VALUE ltns_da_to_json(int argc, VALUE* argv, VALUE self);
+VALUE ltns_from_json(VALUE module, VALUE json);
+
+#endif
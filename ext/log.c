@@ -0,0 +1,184 @@
+#include <ruby.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "log.h"
+#include "parse.h"
+
+/* Records read ahead by each */
+#define PREFETCH_RECORDS 256
+
+extern VALUE eInvalidTNetString;
+
+static LTNSLog* ltns_log_get_log(VALUE self);
+static VALUE ltns_log_record(LTNSLog* log, size_t index);
+
+static const rb_data_type_t ltns_log_type =
+{
+	"LazyTNetstring::Log",
+	{ NULL, ltns_log_free, NULL, },
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED
+};
+
+VALUE ltns_log_alloc(VALUE class)
+{
+	return TypedData_Wrap_Struct(class, &ltns_log_type, NULL);
+}
+
+void ltns_log_free(void* ptr)
+{
+	if (ptr)
+		LTNSLogClose((LTNSLog*)ptr);
+}
+
+/* Opens the log at path, creating it unless :readonly => true */
+VALUE ltns_log_init(int argc, VALUE* argv, VALUE self)
+{
+	VALUE path, options = Qnil;
+	rb_scan_args(argc, argv, "1:", &path, &options);
+	FilePathValue(path);
+	if (RTYPEDDATA_DATA(self))
+		rb_raise(rb_eTypeError, "already initialized log");
+
+	int writable = options == Qnil || !RTEST(rb_hash_aref(options, ID2SYM(rb_intern("readonly"))));
+	LTNSLog* log = NULL;
+	LTNSError error = LTNSLogOpen(&log, StringValueCStr(path), writable);
+	if (error == IO_ERROR)
+		rb_sys_fail_str(path);
+	ltns_da_raise_on_error(error);
+
+	RTYPEDDATA_DATA(self) = log;
+	rb_iv_set(self, "@path", rb_str_new_frozen(path));
+	rb_iv_set(self, "@readonly", writable ? Qfalse : Qtrue);
+
+	return self;
+}
+
+/* record is a tnetstring or a DataAccess, returns its record number */
+VALUE ltns_log_append(VALUE self, VALUE record)
+{
+	LTNSLog* log = ltns_log_get_log(self);
+	char* tnetstring;
+	size_t length, index;
+	if (RTEST(rb_iv_get(self, "@readonly")))
+		rb_raise(rb_eIOError, "not opened for writing");
+
+	if (IS_DATA_ACCESS(record))
+	{
+		LTNSTerm* term = NULL;
+		LTNSError error = LTNSDataAccessAsTerm(ltns_da_get_data_access(record), &term);
+		ltns_da_raise_on_error(error);
+		LTNSTermGetTNetstring(term, &tnetstring, &length);
+		LTNSTermDestroy(term);
+	}
+	else
+	{
+		StringValue(record);
+		tnetstring = RSTRING_PTR(record);
+		length = RSTRING_LEN(record);
+	}
+
+	LTNSError error = LTNSLogAppend(log, tnetstring, length, &index);
+	RB_GC_GUARD(record);
+	if (error == IO_ERROR)
+		rb_sys_fail_str(rb_iv_get(self, "@path"));
+	ltns_da_raise_on_error(error);
+
+	return SIZET2NUM(index);
+}
+
+/* The record as a DataAccess, or a plain value for records that aren't
+ * dictionaries. Negative indexes count from the end, like for arrays. */
+VALUE ltns_log_get(VALUE self, VALUE index)
+{
+	LTNSLog* log = ltns_log_get_log(self);
+	size_t count;
+	LTNSLogCount(log, &count);
+
+	long i = NUM2LONG(index);
+	if (i < 0)
+		i += (long)count;
+	if (i < 0 || (size_t)i >= count)
+		return Qnil;
+
+	return ltns_log_record(log, i);
+}
+
+/* Yields the records in order, reading ahead of them */
+VALUE ltns_log_each(VALUE self)
+{
+	RETURN_SIZED_ENUMERATOR(self, 0, 0, ltns_log_size);
+	LTNSLog* log = ltns_log_get_log(self);
+	size_t count, i;
+	LTNSLogCount(log, &count);
+
+	for (i = 0; i < count; i++)
+	{
+		/* Always keep a window of records ahead on the way */
+		if (i % PREFETCH_RECORDS == 0)
+			LTNSLogPrefetch(log, i, 2 * PREFETCH_RECORDS);
+		rb_yield(ltns_log_record(log, i));
+		/* The block may have closed the log */
+		log = ltns_log_get_log(self);
+	}
+
+	return self;
+}
+
+VALUE ltns_log_size(VALUE self)
+{
+	size_t count;
+	LTNSLogCount(ltns_log_get_log(self), &count);
+	return SIZET2NUM(count);
+}
+
+VALUE ltns_log_sync(VALUE self)
+{
+	LTNSError error = LTNSLogSync(ltns_log_get_log(self));
+	if (error == IO_ERROR)
+		rb_sys_fail_str(rb_iv_get(self, "@path"));
+	ltns_da_raise_on_error(error);
+	return self;
+}
+
+VALUE ltns_log_close(VALUE self)
+{
+	LTNSLog* log = ltns_log_get_log(self);
+	RTYPEDDATA_DATA(self) = NULL;
+	LTNSLogClose(log);
+	return Qnil;
+}
+
+VALUE ltns_log_is_closed(VALUE self)
+{
+	LTNSLog* log;
+	TypedData_Get_Struct(self, LTNSLog, &ltns_log_type, log);
+	return log ? Qfalse : Qtrue;
+}
+
+static LTNSLog* ltns_log_get_log(VALUE self)
+{
+	LTNSLog* log;
+	TypedData_Get_Struct(self, LTNSLog, &ltns_log_type, log);
+	if (!log)
+		rb_raise(rb_eIOError, "closed log");
+	return log;
+}
+
+/* Records are copied out of the mapped log file, it gets remapped when
+ * records are appended */
+static VALUE ltns_log_record(LTNSLog* log, size_t index)
+{
+	const char* record;
+	size_t length;
+	VALUE value = Qnil;
+
+	LTNSError error = LTNSLogGet(log, index, &record, &length);
+	ltns_da_raise_on_error(error);
+	if (!ltns_parse(record, record + length, &value))
+		rb_raise(eInvalidTNetString, "Invalid TNetstring");
+
+	return value;
+}
@@ -0,0 +1,17 @@
+#ifndef __LOG_H__
+#define __LOG_H__
+
+#include <ruby.h>
+
+VALUE ltns_log_alloc(VALUE class);
+void ltns_log_free(void* ptr);
+VALUE ltns_log_init(int argc, VALUE* argv, VALUE self);
+VALUE ltns_log_append(VALUE self, VALUE record);
+VALUE ltns_log_get(VALUE self, VALUE index);
+VALUE ltns_log_each(VALUE self);
+VALUE ltns_log_size(VALUE self);
+VALUE ltns_log_sync(VALUE self);
+VALUE ltns_log_close(VALUE self);
+VALUE ltns_log_is_closed(VALUE self);
+
+#endif
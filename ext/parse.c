@@ -1,9 +1,11 @@
 #include <ruby.h>
 
 #include "LTNS.h"
+#include "LTNSProbes.h"
 
 #include "data_access.h"
 #include "parse.h"
+#include "slow_operation.h"
 
 extern VALUE eInvalidTNetString;
 extern VALUE cDataAccess;
@@ -20,7 +22,10 @@ VALUE ltns_parse_ruby(VALUE module __attribute__ ((unused)), VALUE string)
 
 	char* tnetstring = StringValueCStr(string);
 	char* tnet_end = tnetstring + RSTRING_LEN(string);
-	if (!ltns_parse(tnetstring, tnet_end, &ret))
+	double start = ltns_slow_operation_start();
+	int success = ltns_parse(tnetstring, tnet_end, &ret);
+	ltns_slow_operation_finish("parse", Qnil, NULL, RSTRING_LEN(string), start);
+	if (!success)
 	{
 		rb_raise(eInvalidTNetString, "Invalid TNetstring");
 	}
@@ -31,12 +36,14 @@ int ltns_parse(const char* tnetstring, const char* end, VALUE* out)
 {
 	if (!tnetstring)
 		return FALSE;
+	LTNS_PROBE2(parse__entry, tnetstring, end - tnetstring);
 
 	LTNSTerm *term = NULL;
 	LTNSError error = LTNSTermCreateNested(&term, (char*)tnetstring, (char*)end);
 	if (error)
 	{
 		LTNSTermDestroy(term);
+		LTNS_PROBE1(parse__return, FALSE);
 		return FALSE;
 	}
 	size_t tnetstring_length;
@@ -78,7 +85,8 @@ int ltns_parse(const char* tnetstring, const char* end, VALUE* out)
 	default:
 		ret = FALSE;
 	}
-	
+
+	LTNS_PROBE1(parse__return, ret);
 	return ret;
 }
 
@@ -0,0 +1,177 @@
+#include <ruby.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "recorder.h"
+
+/* A trace starts with TRACE_MAGIC and holds records of the form
+ *
+ *   'D' id length tnetstring        snapshot of a document, before its first operation
+ *   'G' id depth (length key)...    get
+ *   'S' id depth (length key)... type payload_length
+ *   'R' id depth (length key)...    delete
+ *
+ * Numbers are BER compressed integers (pack('w') in ruby), the path runs
+ * from the root of document id to the key operated on. Values aren't
+ * recorded, only their type and length. */
+#define TRACE_MAGIC "LTNSTRC1"
+#define FLUSH_SIZE 65536
+
+static int trace_fd = -1;
+static LTNSBuffer trace;
+/* Documents get ids across recordings, ids below first_id were seen by an
+ * earlier recording and need a new snapshot */
+static long first_id = 1;
+static long next_id = 1;
+/* ObjectSpace::WeakMap of root DataAccess objects to their ids, also in
+ * @trace_ids on the module. Frozen roots can't carry their id themselves */
+static VALUE trace_ids = Qnil;
+
+static void ltns_recorder_flush(void)
+{
+	const char* data = trace.data;
+	size_t length = trace.length;
+	while (length > 0)
+	{
+		ssize_t written = write(trace_fd, data, length);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			trace.length = 0;
+			rb_sys_fail("writing trace");
+		}
+		data += written;
+		length -= written;
+	}
+	trace.length = 0;
+}
+
+static void ltns_recorder_append(const char* data, size_t length)
+{
+	ltns_da_raise_on_error(LTNSBufferAppend(&trace, data, length));
+}
+
+static void ltns_recorder_append_number(unsigned long long number)
+{
+	char bytes[10];
+	int i = sizeof(bytes) - 1;
+
+	bytes[i] = number & 0x7f;
+	while (number >>= 7)
+		bytes[--i] = 0x80 | (number & 0x7f);
+	ltns_recorder_append(bytes + i, sizeof(bytes) - i);
+}
+
+/* Takes an IO or file descriptor, the IO is kept until stop_recording */
+VALUE ltns_start_recording(VALUE module, VALUE io)
+{
+	ltns_check_main_ractor();
+	if (trace_fd >= 0)
+		ltns_stop_recording(module);
+	if (trace_ids == Qnil)
+	{
+		trace_ids = rb_class_new_instance(0, NULL, rb_path2class("ObjectSpace::WeakMap"));
+		rb_ivar_set(module, rb_intern("@trace_ids"), trace_ids);
+	}
+
+	int fd = FIXNUM_P(io) ? FIX2INT(io) : NUM2INT(rb_funcall(io, rb_intern("fileno"), 0));
+	ltns_da_raise_on_error(LTNSBufferInit(&trace, FLUSH_SIZE));
+	rb_ivar_set(module, rb_intern("@recording_io"), io);
+	trace_fd = fd;
+	first_id = next_id;
+
+	ltns_recorder_append(TRACE_MAGIC, strlen(TRACE_MAGIC));
+	return Qnil;
+}
+
+VALUE ltns_stop_recording(VALUE module)
+{
+	ltns_check_main_ractor();
+	if (trace_fd < 0)
+		return Qnil;
+
+	ltns_recorder_flush();
+	LTNSBufferDestroy(&trace);
+	trace_fd = -1;
+	rb_ivar_set(module, rb_intern("@recording_io"), Qnil);
+	return Qnil;
+}
+
+VALUE ltns_is_recording(VALUE module __attribute__ ((unused)))
+{
+	return trace_fd >= 0 ? Qtrue : Qfalse;
+}
+
+/* The document id of self's root, snapshots the document when it is new to
+ * this recording */
+static long ltns_recorder_document(VALUE self, LTNSDataAccess* data_access)
+{
+	VALUE root = ltns_da_root(self);
+	VALUE id = rb_funcall(trace_ids, rb_intern("[]"), 1, root);
+	if (id != Qnil && NUM2LONG(id) >= first_id)
+		return NUM2LONG(id);
+
+	long new_id = next_id++;
+	rb_funcall(trace_ids, rb_intern("[]="), 2, root, LONG2NUM(new_id));
+
+	LTNSTerm* term = NULL;
+	char* tnetstring;
+	size_t length;
+	ltns_da_raise_on_error(LTNSDataAccessAsTerm(LTNSDataAccessGetRoot(data_access), &term));
+	LTNSTermGetTNetstring(term, &tnetstring, &length);
+	ltns_recorder_append("D", 1);
+	ltns_recorder_append_number(new_id);
+	ltns_recorder_append_number(length);
+	ltns_recorder_append(tnetstring, length);
+	LTNSTermDestroy(term);
+
+	return new_id;
+}
+
+void ltns_record_snapshot(VALUE self, LTNSDataAccess* data_access)
+{
+	if (trace_fd < 0 || !ltns_is_main_ractor())
+		return;
+
+	ltns_recorder_document(self, data_access);
+}
+
+void ltns_record(char operation, VALUE self, LTNSDataAccess* data_access, const char* key, LTNSType type, size_t length)
+{
+	size_t depth, i;
+
+	/* Other Ractors' operations aren't recorded, the trace isn't theirs */
+	if (trace_fd < 0 || !ltns_is_main_ractor())
+		return;
+
+	long id = ltns_recorder_document(self, data_access);
+	ltns_da_raise_on_error(LTNSDataAccessPath(data_access, NULL, NULL, &depth));
+	const char* keys[depth + 1];
+	size_t key_lengths[depth + 1];
+	ltns_da_raise_on_error(LTNSDataAccessPath(data_access, keys, key_lengths, &depth));
+	keys[depth] = key;
+	key_lengths[depth] = strlen(key);
+
+	ltns_recorder_append(&operation, 1);
+	ltns_recorder_append_number(id);
+	ltns_recorder_append_number(depth + 1);
+	for (i = 0; i <= depth; i++)
+	{
+		ltns_recorder_append_number(key_lengths[i]);
+		ltns_recorder_append(keys[i], key_lengths[i]);
+	}
+	if (operation == RECORD_SET)
+	{
+		char type_char = (char)type;
+		ltns_recorder_append(&type_char, 1);
+		ltns_recorder_append_number(length);
+	}
+
+	if (trace.length >= FLUSH_SIZE)
+		ltns_recorder_flush();
+}
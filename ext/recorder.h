@@ -0,0 +1,23 @@
+#ifndef __RECORDER_H__
+#define __RECORDER_H__
+
+#include <ruby.h>
+
+#include "LTNS.h"
+
+#define RECORD_GET 'G'
+#define RECORD_SET 'S'
+#define RECORD_DELETE 'R'
+
+VALUE ltns_start_recording(VALUE module, VALUE io);
+VALUE ltns_stop_recording(VALUE module);
+VALUE ltns_is_recording(VALUE module);
+
+/* Snapshots the document of self if recording and it's new to the
+ * recording. Changes call it before they're made and record after. */
+void ltns_record_snapshot(VALUE self, LTNSDataAccess* data_access);
+/* Records an operation on key of self if recording, type and length of the
+ * value's payload only matter for RECORD_SET */
+void ltns_record(char operation, VALUE self, LTNSDataAccess* data_access, const char* key, LTNSType type, size_t length);
+
+#endif
@@ -0,0 +1,67 @@
+#include <ruby.h>
+#include <time.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "slow_operation.h"
+
+extern VALUE cModule;
+
+/* The hook is also kept in @slow_operation_hook on the module, so it is
+ * not collected */
+static VALUE hook = Qnil;
+static double threshold = 0;
+
+static double ltns_now(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* on_slow_operation(seconds) { |operation, key, seconds, bytes| ... } calls
+ * the block for every get, set, delete or parse that takes at least seconds.
+ * on_slow_operation(nil) removes the hook. */
+VALUE ltns_on_slow_operation(int argc, VALUE* argv, VALUE module)
+{
+	VALUE seconds, block;
+	rb_scan_args(argc, argv, "1&", &seconds, &block);
+	ltns_check_main_ractor();
+
+	if (seconds == Qnil)
+		block = Qnil;
+	else if (block == Qnil)
+		rb_raise(rb_eArgError, "No block given!");
+	else
+		threshold = NUM2DBL(seconds);
+
+	rb_ivar_set(module, rb_intern("@slow_operation_hook"), block);
+	hook = block;
+	return Qnil;
+}
+
+double ltns_slow_operation_start(void)
+{
+	/* The block can't be called from other Ractors */
+	return hook == Qnil || !ltns_is_main_ractor() ? 0 : ltns_now();
+}
+
+void ltns_slow_operation_finish(const char* operation, VALUE key, LTNSDataAccess* data_access, size_t length, double start)
+{
+	if (start == 0 || hook == Qnil)
+		return;
+
+	double seconds = ltns_now() - start;
+	if (seconds < threshold)
+		return;
+
+	LTNSTerm* term = NULL;
+	if (data_access && !LTNSDataAccessAsTerm(LTNSDataAccessGetRoot(data_access), &term))
+	{
+		LTNSTermGetTNetstring(term, NULL, &length);
+		LTNSTermDestroy(term);
+	}
+
+	rb_funcall(hook, rb_intern("call"), 4, ID2SYM(rb_intern(operation)), key, DBL2NUM(seconds), SIZET2NUM(length));
+}
@@ -0,0 +1,16 @@
+#ifndef __SLOW_OPERATION_H__
+#define __SLOW_OPERATION_H__
+
+#include <ruby.h>
+
+#include "LTNS.h"
+
+VALUE ltns_on_slow_operation(int argc, VALUE* argv, VALUE module);
+
+/* Returns 0 unless a hook is set. Pass the result to
+ * ltns_slow_operation_finish after the operation, which reports the size of
+ * data_access's document or length if data_access is NULL. */
+double ltns_slow_operation_start(void);
+void ltns_slow_operation_finish(const char* operation, VALUE key, LTNSDataAccess* data_access, size_t length, double start);
+
+#endif
@@ -0,0 +1,58 @@
+#include <ruby.h>
+
+#include "LTNS.h"
+
+#include "data_access.h"
+#include "stats.h"
+
+#define SET_STAT(hash, name, value) rb_hash_aset(hash, ID2SYM(rb_intern(name)), ULL2NUM(value))
+
+/* Counters of the calling thread, see LTNSStats.h */
+VALUE ltns_stats(VALUE module __attribute__ ((unused)))
+{
+	LTNSStats stats;
+	LTNSStatsGet(&stats);
+
+	VALUE hash = rb_hash_new();
+	SET_STAT(hash, "terms_parsed", stats.terms_parsed);
+	SET_STAT(hash, "bytes_scanned", stats.bytes_scanned);
+	SET_STAT(hash, "bytes_moved", stats.bytes_moved);
+	SET_STAT(hash, "reallocs", stats.reallocs);
+	SET_STAT(hash, "prefix_width_changes", stats.prefix_width_changes);
+	SET_STAT(hash, "nodes_visited", stats.nodes_visited);
+	rb_hash_aset(hash, ID2SYM(rb_intern("live_children")), LL2NUM(stats.live_children));
+	return hash;
+}
+
+VALUE ltns_reset_stats(VALUE module __attribute__ ((unused)))
+{
+	LTNSStatsReset();
+	return Qnil;
+}
+
+/* Size of this data access and its document and the children cached below it */
+VALUE ltns_da_stats(VALUE self)
+{
+	LTNSDataAccess* data_access = ltns_da_get_data_access(self);
+	LTNSTerm* term = NULL;
+	size_t bytes, document_bytes, children;
+
+	LTNSError error = LTNSDataAccessAsTerm(data_access, &term);
+	ltns_da_raise_on_error(error);
+	LTNSTermGetTNetstring(term, NULL, &bytes);
+	LTNSTermDestroy(term);
+
+	error = LTNSDataAccessAsTerm(LTNSDataAccessGetRoot(data_access), &term);
+	ltns_da_raise_on_error(error);
+	LTNSTermGetTNetstring(term, NULL, &document_bytes);
+	LTNSTermDestroy(term);
+
+	error = LTNSDataAccessCountChildren(data_access, &children);
+	ltns_da_raise_on_error(error);
+
+	VALUE hash = rb_hash_new();
+	SET_STAT(hash, "bytes", bytes);
+	SET_STAT(hash, "document_bytes", document_bytes);
+	SET_STAT(hash, "children", children);
+	return hash;
+}
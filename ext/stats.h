@@ -0,0 +1,10 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <ruby.h>
+
+VALUE ltns_stats(VALUE module);
+VALUE ltns_reset_stats(VALUE module);
+VALUE ltns_da_stats(VALUE self);
+
+#endif
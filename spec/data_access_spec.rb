@@ -1,5 +1,6 @@
 require 'spec_helper'
 require 'tnetstring'
+require 'json'
 
 module LazyTNetstring
   describe DataAccess do
@@ -88,6 +89,28 @@ module LazyTNetstring
         end
       end
 
+      context 'for nested hash accessed repeatedly' do
+        let(:data)        { TNetstring.dump({'before' => 'x', 'outer' => { 'inner' => 'value'} }) }
+        let(:data_access) { LazyTNetstring::DataAccess.new(data) }
+
+        it 'should return the same object' do
+          data_access['outer'].should equal(data_access['outer'])
+        end
+
+        it 'should return the same object after the child moved' do
+          outer = data_access['outer']
+          data_access['before'] = 'a longer value'
+          data_access['outer'].should equal(outer)
+        end
+
+        it 'should return a new object once the child was replaced' do
+          outer = data_access['outer']
+          data_access['outer'] = { 'inner' => 'other' }
+          data_access['outer'].should_not equal(outer)
+          data_access['outer']['inner'].should == 'other'
+        end
+      end
+
       context 'for nested hash with non-existing key' do
         let(:data)              { TNetstring.dump({'outer' => { 'inner' => 'value'}, 'user' => {} }) }
         let(:key)               { 'outer' }
@@ -745,6 +768,46 @@ module LazyTNetstring
       end
     end
 
+    describe "#to_json" do
+      subject           { data_access }
+      let(:data_access) { LazyTNetstring::DataAccess.new(data) }
+      let(:data)        { TNetstring.dump(hash) }
+      let(:hash)        { { 'key' => "va\"lue\n", 'outer' => { 'list' => [1, 2.5, nil, true] } } }
+
+      it "should transcode the tnetstring into JSON" do
+        JSON.parse(subject.to_json).should == hash
+      end
+
+      it "should transcode nested data accesses" do
+        subject['outer'].to_json.should == '{"list":[1,2.5,null,true]}'
+      end
+
+      it "should only include keys given with :only" do
+        subject.to_json(:only => [:key]).should == '{"key":"va\\"lue\\n"}'
+      end
+
+      it "should leave out keys given with :except" do
+        subject.to_json(:except => 'key').should == '{"outer":{"list":[1,2.5,null,true]}}'
+      end
+
+      it "should reject floats JSON can't represent" do
+        infinite = LazyTNetstring::DataAccess.new('15:1:f,8:Infinity^}')
+        expect { infinite.to_json }.to raise_error(LazyTNetstring::InvalidTNetString)
+      end
+
+      it "should reject numbers outside the JSON grammar" do
+        ['9:1:n,2:+5#}', '12:1:n,5:1.2.3^}', '9:1:n,2:--#}', '8:1:n,1:e^}'].each do |data|
+          expect { LazyTNetstring::DataAccess.new(data).to_json }.to raise_error(LazyTNetstring::InvalidTNetString)
+        end
+      end
+
+      it "should keep valid UTF-8 and reject invalid strings" do
+        LazyTNetstring::DataAccess.new(TNetstring.dump({ 's' => "caf\u00e9" })).to_json.should == "{\"s\":\"caf\u00e9\"}"
+        binary = LazyTNetstring::DataAccess.new(TNetstring.dump({ 's' => "\xff".force_encoding('BINARY') }))
+        expect { binary.to_json }.to raise_error(LazyTNetstring::InvalidTNetString)
+      end
+    end
+
     describe "#dup" do
       subject           { data_access }
       let(:data_access) { LazyTNetstring::DataAccess.new(data) }
@@ -826,6 +889,158 @@ module LazyTNetstring
       end
     end
 
+    describe '#hash' do
+      let(:lhs) { LazyTNetstring::DataAccess.new(data) }
+      let(:rhs) { LazyTNetstring::DataAccess.new(data) }
+      let(:data) { LazyTNetstring.dump({:outer => { :inner => 5 }}) }
+
+      it "should be equal for equal data" do
+        lhs.hash.should == rhs.hash
+        lhs.fingerprint.should == rhs.fingerprint
+      end
+
+      it "should allow using data accesses as hash keys" do
+        { lhs => true }[rhs].should == true
+      end
+
+      it "should change when nested data changes" do
+        fingerprint = lhs.fingerprint
+        lhs['outer']['inner'] = 6
+        lhs.fingerprint.should_not == fingerprint
+        lhs.fingerprint.should == LazyTNetstring::DataAccess.new(lhs.data).fingerprint
+      end
+    end
+
+    describe '#equivalent?' do
+      let(:lhs) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'a' => 1, 'b' => { 'c' => [1, 2], 'd' => nil }})) }
+      let(:rhs) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump(other)) }
+
+      context 'for differently ordered keys' do
+        let(:other) { {'b' => { 'd' => nil, 'c' => [1, 2] }, 'a' => 1} }
+
+        it { lhs.equivalent?(rhs).should == true }
+        it { (lhs == rhs).should == false }
+      end
+
+      context 'for differing values' do
+        let(:other) { {'b' => { 'd' => nil, 'c' => [2, 1] }, 'a' => 1} }
+
+        it { lhs.equivalent?(rhs).should == false }
+      end
+    end
+
+    describe '#deep_merge!' do
+      let(:data_access) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'a' => 1, 'inner' => {'x' => 1, 'y' => 2}})) }
+      let(:other) { LazyTNetstring.dump({'inner' => {'y' => 'two', 'z' => 3}, 'b' => nil}) }
+
+      it 'merges nested hashes by default' do
+        data_access.deep_merge!(other).keys.should == ['a', 'inner', 'b']
+        data_access['inner'].to_hash.should == {'x' => 1, 'y' => 'two', 'z' => 3}
+      end
+
+      it 'replaces values with :replace' do
+        data_access.deep_merge!(other, :replace)
+        data_access['inner'].to_hash.should == {'y' => 'two', 'z' => 3}
+      end
+
+      it 'keeps existing values with :keep' do
+        data_access.deep_merge!(other, :keep)
+        data_access['inner'].to_hash.should == {'x' => 1, 'y' => 2}
+        data_access['b'].should be_nil
+        data_access.keys.should == ['a', 'inner', 'b']
+      end
+
+      it 'accepts another data access' do
+        data_access['inner'].deep_merge!(LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'x' => 'one'})))
+        data_access['inner']['x'].should == 'one'
+      end
+
+      it 'invalidates scoped data accesses of the merged hash' do
+        inner = data_access['inner']
+        data_access.deep_merge!(other)
+        expect { inner['x'] }.to raise_error(LazyTNetstring::InvalidScope)
+      end
+    end
+
+    describe '#slice' do
+      let(:data_access) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'id' => 42, 'user' => {'name' => 'bob', 'age' => 7}, 'big' => 'x' * 100})) }
+
+      it 'copies top level keys' do
+        data_access.slice('id', :big).keys.should == ['id', 'big']
+      end
+
+      it 'copies nested paths' do
+        slice = data_access.slice('id', ['user', 'name'])
+        slice.data.should == LazyTNetstring.dump({'id' => 42, 'user' => {'name' => 'bob'}})
+      end
+
+      it 'leaves out missing paths' do
+        data_access.slice('missing', ['user', 'missing'], ['id', 'missing']).should be_empty
+      end
+
+      it 'returns an independent copy' do
+        slice = data_access.slice('user')
+        slice['user']['name'] = 'alice'
+        data_access['user']['name'].should == 'bob'
+      end
+    end
+
+    describe '#journal' do
+      let(:data) { LazyTNetstring.dump({'outer' => {'counter' => 1, 'name' => 'foo'}, 'other' => 'bar'}) }
+      let(:data_access) { LazyTNetstring::DataAccess.new(data) }
+
+      it { data_access.journal.should be_nil }
+
+      context 'with journaling enabled' do
+        before do
+          data_access.enable_journal
+          data_access['outer']['name'] = 'a longer name'
+          data_access['outer'].increment_value('counter')
+          data_access.delete('other')
+        end
+
+        it 'records changes compactly' do
+          data_access.journal.should == '42:3:set,15:5:outer,4:name,]13:a longer name,]' +
+            '32:3:set,18:5:outer,7:counter,]1:2#]' +
+            '23:6:remove,8:5:other,]0:~]'
+        end
+
+        it 'can be replayed on another copy' do
+          replica = LazyTNetstring::DataAccess.new(data)
+          LazyTNetstring.apply_journal(replica, data_access.journal)
+          replica.should == data_access
+        end
+
+        it 'can be replayed twice' do
+          replica = LazyTNetstring::DataAccess.new(data)
+          2.times { LazyTNetstring.apply_journal(replica, data_access.journal) }
+          replica.should == data_access
+        end
+
+        it 'can be cleared' do
+          data_access.clear_journal
+          data_access.journal.should == ''
+        end
+      end
+
+      context 'writing to an IO' do
+        let(:pipe) { IO.pipe }
+
+        it 'writes operations instead of keeping them' do
+          data_access.enable_journal(pipe.last)
+          data_access['other'] = 'baz'
+          data_access.journal.should == ''
+          pipe.first.read_nonblock(100).should == '23:3:set,8:5:other,]3:baz,]'
+        end
+
+        it 'raises when writing fails, keeping the change' do
+          data_access.enable_journal(pipe.first)
+          expect { data_access['other'] = 'baz' }.to raise_error(SystemCallError)
+          data_access['other'].should == 'baz'
+        end
+      end
+    end
+
     describe '#keys' do
       subject { LazyTNetstring::DataAccess.new(data).keys }
 
@@ -863,5 +1078,379 @@ module LazyTNetstring
       end
     end
 
+    describe '#stats' do
+      let(:data_access) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'outer' => {'inner' => 'foo'}})) }
+      subject { data_access.stats }
+
+      its([:bytes]) { should == data_access.data.length }
+      its([:document_bytes]) { should == data_access.data.length }
+      its([:children]) { should == 0 }
+
+      context 'for a nested data access' do
+        subject { data_access['outer'].stats }
+
+        its([:bytes]) { should == data_access['outer'].scoped_data.length }
+        its([:document_bytes]) { should == data_access.data.length }
+      end
+
+      it 'counts cached children' do
+        outer = data_access['outer']
+        data_access.stats[:children].should == 1
+      end
+    end
+
+    describe 'memoize option' do
+      let(:data) { LazyTNetstring.dump({'key' => 'value', 'other' => 1, 'outer' => {'inner' => 'foo'}}) }
+      let(:data_access) { LazyTNetstring::DataAccess.new(data, :memoize => true) }
+
+      it 'returns the same frozen scalar for repeated reads' do
+        value = data_access['key']
+        value.should be_frozen
+        data_access['key'].should equal(value)
+      end
+
+      it 'memoizes in children, too' do
+        data_access['outer']['inner'].should equal(data_access['outer']['inner'])
+      end
+
+      it 'forgets values that are set or deleted' do
+        other = data_access['other']
+        data_access['key']
+        data_access['key'] = 'new value'
+        data_access['key'].should == 'new value'
+        data_access['other'].should equal(other)
+        data_access.delete('key')
+        data_access['key'].should be_nil
+      end
+
+      it 'forgets values changed by a merge' do
+        data_access['key']
+        data_access.deep_merge!(LazyTNetstring.dump({'key' => 'merged'}))
+        data_access['key'].should == 'merged'
+      end
+
+      it 'raises for orphaned children' do
+        outer = data_access['outer']
+        outer['inner']
+        data_access['outer'] = {'inner' => 'bar'}
+        expect { outer['inner'] }.to raise_error(LazyTNetstring::InvalidScope)
+      end
+
+      it 'is off by default' do
+        LazyTNetstring::DataAccess.new(data)['key'].should_not be_frozen
+      end
+    end
+
+    describe 'frozen documents' do
+      let(:blob) { 'b' * 100_000 }
+      let(:data) { LazyTNetstring.dump({'blob' => blob, 'outer' => {'inner' => 'foo'}}) }
+      let(:data_access) { LazyTNetstring::DataAccess.new(data).freeze }
+
+      it 'returns its data without copying' do
+        require 'objspace'
+        data_access.data.should == data
+        ObjectSpace.memsize_of(data_access.data).should < 1000
+        data_access['blob'].should == blob
+      end
+
+      it 'keeps the document alive for its strings' do
+        datas = 3.times.map { LazyTNetstring::DataAccess.new(data).freeze.data }
+        GC.start
+        datas.each { |shared| shared.should == data }
+      end
+
+      it 'reads memoized values like other strings' do
+        nested = LazyTNetstring.dump({'key' => blob})
+        memoized = LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'outer' => {'nested' => nested}}), :memoize => true)
+        outer = memoized['outer']
+        memoized.freeze
+        value = outer['nested']
+        value.should be_frozen
+        { value => 1 }[nested].should == 1
+        LazyTNetstring.parse(value)['key'].should == blob
+        memoized.data.should_not be_empty
+      end
+
+      it 'copies before changing a string' do
+        value = data_access['blob']
+        value << 'x'
+        data_access['blob'].should == blob
+      end
+
+      it 'rejects changes' do
+        expect { data_access['blob'] = 'x' }.to raise_error(RuntimeError)
+        expect { data_access['outer']['inner'] = 'x' }.to raise_error(RuntimeError)
+        expect { data_access.delete('blob') }.to raise_error(RuntimeError)
+        expect { data_access.deep_merge!('0:}') }.to raise_error(RuntimeError)
+      end
+
+      it 'can be changed after dup' do
+        copy = data_access.dup
+        copy['blob'] = 'x'
+        copy['blob'].should == 'x'
+      end
+
+      it 'stays frozen when cloned' do
+        copy = data_access.clone
+        expect { copy['outer']['inner'] = 'x' }.to raise_error(RuntimeError)
+        data_access.clone(:freeze => false)['blob'] = 'x'
+      end
+
+      it 'creates new children instead of caching them' do
+        data_access['outer'].should_not equal(data_access['outer'])
+        data_access['outer'].should == data_access['outer']
+      end
+
+      it 'can be shared between Ractors' do
+        pending 'needs Ractor' unless defined?(Ractor)
+        shared = Ractor.make_shareable(LazyTNetstring::DataAccess.new(data))
+        Ractor.shareable?(shared).should == true
+        readers = 2.times.map { Ractor.new(shared) { |doc| doc['outer']['inner'] } }
+        readers.map(&:take).should == ['foo', 'foo']
+      end
+    end
+
+    describe 'garbage collection' do
+      let(:data) { LazyTNetstring.dump({'outer' => {'inner' => 'x' * 1000}}) }
+      let(:data_access) { LazyTNetstring::DataAccess.new(data) }
+
+      it 'reports the document in ObjectSpace.memsize_of' do
+        require 'objspace'
+        ObjectSpace.memsize_of(data_access).should > data.length
+        ObjectSpace.memsize_of(data_access['outer']).should < data.length
+      end
+
+      it 'keeps children usable after compaction' do
+        outer = data_access['outer']
+        GC.compact if GC.respond_to?(:compact)
+        outer['inner'].should == 'x' * 1000
+        outer['inner'] = 'y'
+        data_access['outer']['inner'].should == 'y'
+      end
+    end
+
+    describe 'LazyTNetstring.stats' do
+      let(:data_access) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'key' => 'value', 'other' => 1})) }
+      before { LazyTNetstring.reset_stats }
+
+      it 'counts scanned bytes' do
+        data_access['other']
+        LazyTNetstring.stats[:bytes_scanned].should > 0
+      end
+
+      it 'counts moved bytes and reallocs' do
+        data_access['key'] = 'a longer value'
+        LazyTNetstring.stats[:bytes_moved].should > 0
+        LazyTNetstring.stats[:reallocs].should > 0
+      end
+
+      it 'can be reset' do
+        data_access['key'] = 'a longer value'
+        LazyTNetstring.reset_stats
+        LazyTNetstring.stats[:bytes_moved].should == 0
+      end
+    end
+
+    describe 'LazyTNetstring.on_slow_operation' do
+      let(:data_access) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'key' => 'value'})) }
+      let(:events) { [] }
+      after { LazyTNetstring.on_slow_operation(nil) }
+
+      it 'reports operations slower than the threshold' do
+        LazyTNetstring.on_slow_operation(0) { |*event| events << event }
+        data_access['key'] = 'other'
+        operation, key, seconds, bytes = events.last
+        operation.should == :set
+        key.should == 'key'
+        seconds.should >= 0
+        bytes.should == data_access.data.length
+      end
+
+      it 'ignores faster operations' do
+        LazyTNetstring.on_slow_operation(60) { |*event| events << event }
+        data_access['key']
+        events.should be_empty
+      end
+
+      it 'can be removed' do
+        LazyTNetstring.on_slow_operation(0) { |*event| events << event }
+        LazyTNetstring.on_slow_operation(nil)
+        data_access['key']
+        events.should be_empty
+      end
+
+      it 'requires a block' do
+        expect { LazyTNetstring.on_slow_operation(0) }.to raise_error(ArgumentError)
+      end
+
+      it 'lets the block raise after the change is done' do
+        index = LazyTNetstring::Index.new('key', [data_access])
+        LazyTNetstring.on_slow_operation(0) { raise 'slow' }
+        expect { data_access['key'] = 'other' }.to raise_error(RuntimeError)
+        LazyTNetstring.on_slow_operation(nil)
+        data_access['key'].should == 'other'
+        index.find('other').should == [data_access]
+      end
+    end
+
+    describe 'LazyTNetstring.start_recording' do
+      let(:data) { LazyTNetstring.dump({'outer' => {'key' => 'value'}}) }
+      let(:data_access) { LazyTNetstring::DataAccess.new(data) }
+      let(:pipe) { IO.pipe }
+      after { LazyTNetstring.stop_recording }
+
+      def trace
+        LazyTNetstring.stop_recording
+        pipe[1].close
+        pipe[0].read
+      end
+
+      it 'records a snapshot and the path of every operation' do
+        LazyTNetstring.start_recording(pipe[1])
+        LazyTNetstring.should be_recording
+        data_access['outer']['key'] = 'other'
+        recorded = trace
+        # document ids keep counting across recordings
+        id = recorded.unpack('a8aw')[2]
+        recorded.should == 'LTNSTRC1' +
+          ['D', id, data.length].pack('aww') + data +
+          ['G', id, 1, 5, 'outer'].pack('awwwa*') +
+          ['S', id, 2, 5, 'outer', 3, 'key', ',', 5].pack('awwwa*wa*aw')
+        LazyTNetstring.should_not be_recording
+      end
+
+      it 'records deletes without reading the old value' do
+        LazyTNetstring.start_recording(pipe[1])
+        data_access.delete('outer')
+        recorded = trace
+        id = recorded.unpack('a8aw')[2]
+        recorded.should == 'LTNSTRC1' +
+          ['D', id, data.length].pack('aww') + data +
+          ['R', id, 1, 5, 'outer'].pack('awwwa*')
+      end
+
+      it 'snapshots documents before changing them' do
+        LazyTNetstring.start_recording(pipe[1])
+        data_access['outer'] = 1
+        recorded = trace
+        id = recorded.unpack('a8aw')[2]
+        recorded.should == 'LTNSTRC1' +
+          ['D', id, data.length].pack('aww') + data +
+          ['S', id, 1, 5, 'outer', '#', 1].pack('awwwa*aw')
+      end
+
+      it 'snapshots documents once per recording' do
+        LazyTNetstring.start_recording(pipe[1])
+        data_access['outer']
+        data_access['outer']
+        trace.count('D').should == 1
+      end
+    end
+
+
+    describe 'LazyTNetstring.gvl_release_threshold' do
+      let(:data) { LazyTNetstring.dump({'key' => 'value', 'inner' => {'key' => 'value'}}) }
+      let(:data_access) { LazyTNetstring::DataAccess.new(data) }
+      after { LazyTNetstring.gvl_release_threshold = 1024 * 1024 }
+
+      it { LazyTNetstring.gvl_release_threshold.should == 1024 * 1024 }
+      it { expect { LazyTNetstring.gvl_release_threshold = -1 }.to raise_error(ArgumentError) }
+
+      it 'can keep the GVL for any size' do
+        LazyTNetstring.gvl_release_threshold = nil
+        LazyTNetstring.gvl_release_threshold.should be_nil
+        LazyTNetstring::DataAccess.new(data).should == data_access
+      end
+
+      it 'gives the same results without the GVL' do
+        LazyTNetstring.gvl_release_threshold = 0
+        LazyTNetstring::DataAccess.new(data).data.should == data
+        data_access.dup.should == data_access
+        data_access['inner'].to_json.should == '{"key":"value"}'
+        data_access.to_json(:only => ['key']).should == '{"key":"value"}'
+        LazyTNetstring.from_json(data_access.to_json).should == data_access
+        LazyTNetstring::Filter.new('inner.key == "value"').match?(data_access['inner'].data).should == true
+      end
+
+      it 'keeps documents from changing while other threads read them' do
+        LazyTNetstring.gvl_release_threshold = 0
+        large = LazyTNetstring.dump((1..10000).map { |i| ["key#{i}", 'value' * 10] }.to_h)
+        large_access = LazyTNetstring::DataAccess.new(large)
+        reader = Thread.new { (1..20).map { large_access.to_json } }
+        writes = 0
+        while reader.alive?
+          large_access['key1'] = "other#{writes += 1}"
+          Thread.pass
+        end
+        reader.value.each { |json| json.should =~ /"key1":"(value|other\d+)"/ }
+        large_access['key1'].should == "other#{writes}"
+      end
+
+      it 'reads children while other threads change the document' do
+        LazyTNetstring.gvl_release_threshold = 0
+        inner = (1..2000).map { |i| ["key#{i}", 'value' * 4] }.to_h
+        large_access = LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'a' => inner, 'b' => inner}))
+        child = large_access['a']
+        reader = Thread.new { (1..20).map { child.to_json } }
+        writes = 0
+        while reader.alive?
+          large_access['b']["key#{writes += 1}"] = 'other' * (writes % 3)
+          large_access['a']['key1'] = { 'nested' => writes }
+          Thread.pass
+        end
+        reader.value.each { |json| json.should =~ /\A\{"key1":/ }
+        child['key1']['nested'].should == writes
+      end
+    end
+
+    describe 'LazyTNetstring.extract_many' do
+      let(:documents) { [LazyTNetstring.dump({'id' => 1, 'user' => {'name' => 'a'}}), LazyTNetstring.dump({'id' => 2})] }
+
+      it 'returns the values at each path for each document' do
+        LazyTNetstring.extract_many(documents, ['id', ['user', 'name']]).should == [[1, 'a'], [2, nil]]
+      end
+
+      it 'returns nested hashes as data accesses' do
+        LazyTNetstring.extract_many(documents, [:user])[0][0].should == LazyTNetstring::DataAccess.new(documents[0])['user']
+      end
+
+      it 'gives the same results on several threads without the GVL' do
+        LazyTNetstring.gvl_release_threshold = 0
+        many = documents * 1000
+        LazyTNetstring.extract_many(many, ['id'], :threads => 4).should == LazyTNetstring.extract_many(many, ['id'], :threads => 1)
+        LazyTNetstring.gvl_release_threshold = 1024 * 1024
+      end
+
+      it 'leaves out values of invalid documents' do
+        LazyTNetstring.extract_many(['garbage'], ['id']).should == [[nil]]
+      end
+
+      it { expect { LazyTNetstring.extract_many(documents, ['id'], :threads => 0) }.to raise_error(ArgumentError) }
+      it { expect { LazyTNetstring.extract_many([1], ['id']) }.to raise_error(TypeError) }
+    end
+
+    describe 'LazyTNetstring.split_offsets' do
+      let(:records) { [LazyTNetstring.dump({'id' => 1}), LazyTNetstring.dump('text'), LazyTNetstring.dump({'id' => 2, 'inner' => {'id' => 3}})] }
+      let(:stream) { records.join }
+
+      it 'returns where each record starts and the last one ends' do
+        LazyTNetstring.split_offsets(stream).should == [0, records[0].size, records[0].size + records[1].size, stream.size]
+      end
+
+      it 'stops before incomplete records' do
+        LazyTNetstring.split_offsets(stream[0..-2]).should == [0, records[0].size, records[0].size + records[1].size]
+      end
+
+      it 'finds the same records on several threads' do
+        large = (records * 20000).join
+        LazyTNetstring.split_offsets(large, :threads => 4).should == LazyTNetstring.split_offsets(large, :threads => 1)
+      end
+
+      it 'gives offsets DataAccess can read' do
+        offsets = LazyTNetstring.split_offsets(stream)
+        LazyTNetstring::DataAccess.new(stream.byteslice(offsets[2], offsets[3] - offsets[2]))['inner']['id'].should == 3
+      end
+    end
+
   end
 end
@@ -0,0 +1,70 @@
+require 'spec_helper'
+
+describe LazyTNetstring::Filter do
+  let(:active) { LazyTNetstring.dump({'status' => 'active', 'level' => 12, 'user' => {'name' => 'bob'}}) }
+  let(:low) { LazyTNetstring.dump({'status' => 'active', 'level' => 3, 'user' => {'name' => 'alice'}}) }
+  let(:inactive) { LazyTNetstring.dump({'status' => 'inactive', 'level' => 50}) }
+
+  describe '.new' do
+    it { LazyTNetstring::Filter.new('status == "active"').expression.should == 'status == "active"' }
+
+    it 'rejects invalid expressions' do
+      expect { LazyTNetstring::Filter.new('status ==') }.to raise_error(LazyTNetstring::InvalidFilter)
+      expect { LazyTNetstring::Filter.new('(level > 1') }.to raise_error(LazyTNetstring::InvalidFilter)
+    end
+
+    it 'is not reinitialized' do
+      filter = LazyTNetstring::Filter.new('level > 1')
+      expect { filter.send(:initialize, 'level > 2') }.to raise_error(TypeError)
+    end
+
+    it 'can be shared between Ractors when frozen' do
+      pending 'needs Ractor' unless defined?(Ractor)
+      filter = Ractor.make_shareable(LazyTNetstring::Filter.new('level > 1'))
+      Ractor.new(filter, active) { |shared, document| shared.match?(document) }.take.should == true
+    end
+  end
+
+  describe '#match?' do
+    subject { LazyTNetstring::Filter.new(expression) }
+
+    context 'with comparisons' do
+      let(:expression) { 'status == "active" && level > 10' }
+
+      it { subject.match?(active).should == true }
+      it { subject.match?(low).should == false }
+      it { subject.match?(inactive).should == false }
+      it { subject.match?(LazyTNetstring::DataAccess.new(active)).should == true }
+    end
+
+    context 'with nested paths' do
+      let(:expression) { "user.name == 'bob' || !user" }
+
+      it { subject.match?(active).should == true }
+      it { subject.match?(low).should == false }
+      it { subject.match?(inactive).should == true }
+    end
+
+    context 'with long flat chains' do
+      let(:expression) { (['level == 0'] * 200_000).join(' || ') + ' || status == "inactive"' }
+
+      it { subject.match?(active).should == false }
+      it { subject.match?(inactive).should == true }
+      it { LazyTNetstring::Filter.new((['level > 1'] * 200_000).join(' && ')).match?(active).should == true }
+    end
+
+    context 'with invalid documents' do
+      let(:expression) { 'level > 1' }
+
+      it { expect { subject.match?('3:abc') }.to raise_error(LazyTNetstring::InvalidTNetString) }
+      it { expect { subject.match?('1:1#') }.to raise_error(LazyTNetstring::UnsupportedTopLevelDataStructure) }
+    end
+  end
+
+  describe '#select' do
+    subject { LazyTNetstring::Filter.new('level >= 12') }
+
+    it { subject.select([active, low, inactive]).should == [active, inactive] }
+    it { subject.select([]).should == [] }
+  end
+end
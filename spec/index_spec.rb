@@ -0,0 +1,86 @@
+require 'spec_helper'
+
+describe LazyTNetstring::Index do
+  let(:bob) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'user' => {'id' => 7, 'name' => 'bob'}})) }
+  let(:alice) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'user' => {'id' => 12, 'name' => 'alice'}})) }
+  let(:carol) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'user' => {'id' => 7, 'name' => 'carol'}})) }
+  let(:nobody) { LazyTNetstring::DataAccess.new(LazyTNetstring.dump({'user' => 'nobody'})) }
+  let(:documents) { [bob, alice, carol, nobody] }
+
+  subject { LazyTNetstring::Index.new(['user', 'id'], documents) }
+
+  describe '.new' do
+    it { subject.path.should == ['user', 'id'] }
+    it { subject.size.should == 4 }
+    it { LazyTNetstring::Index.new('id').path.should == ['id'] }
+
+    it 'takes documents only' do
+      expect { LazyTNetstring::Index.new('id', [{'id' => 1}]) }.to raise_error(TypeError)
+    end
+  end
+
+  describe '#find' do
+    it { subject.find(7).should == [bob, carol] }
+    it { subject.find(7.0).should == [bob, carol] }
+    it { subject.find('7').should == [] }
+    it { subject.find(12).should == [alice] }
+    it { subject.find(1).should == [] }
+  end
+
+  describe '#range' do
+    it { subject.range(1..10).should == [bob, carol] }
+    it { subject.range(7..12).should == [bob, carol, alice] }
+    it { subject.range(7...12).should == [bob, carol] }
+    it { subject.range(8..nil).should == [alice] }
+    it { subject.range(nil..7).should == [bob, carol] }
+    it { expect { subject.range(7) }.to raise_error(TypeError) }
+  end
+
+  describe 'changing documents' do
+    it 'follows values set on the documents' do
+      subject
+      alice['user'] = {'id' => 7}
+      subject.find(7).should == [bob, alice, carol]
+      subject.find(12).should == []
+    end
+
+    it 'follows values set on nested objects' do
+      subject
+      carol['user']['id'] = 13
+      subject.range(10..20).should == [alice, carol]
+    end
+
+    it 'follows deleted values' do
+      subject
+      bob['user'].delete('id')
+      subject.find(7).should == [carol]
+    end
+
+    it 'follows merges' do
+      subject
+      nobody.deep_merge!(LazyTNetstring.dump({'user' => {'id' => 12}}))
+      subject.find(12).should == [alice, nobody]
+    end
+  end
+
+  describe '#delete' do
+    it 'stops indexing the document' do
+      subject.delete(bob).should == bob
+      subject.size.should == 3
+      subject.find(7).should == [carol]
+      bob['user'] = {'id' => 12}
+      subject.find(12).should == [alice]
+    end
+
+    it { subject.delete(LazyTNetstring::DataAccess.new).should be_nil }
+  end
+
+  describe '#add' do
+    it 'adds documents once' do
+      index = LazyTNetstring::Index.new(['user', 'id'])
+      index << bob << bob
+      index.documents.should == [bob]
+      index.find(7).should == [bob]
+    end
+  end
+end
@@ -0,0 +1,102 @@
+require 'spec_helper'
+require 'tmpdir'
+require 'fileutils'
+
+describe LazyTNetstring::Log do
+  let(:dir) { Dir.mktmpdir }
+  let(:path) { File.join(dir, 'records.log') }
+  let(:first) { LazyTNetstring.dump({'id' => 1, 'user' => {'name' => 'bob'}}) }
+  let(:second) { LazyTNetstring.dump({'id' => 2}) }
+  let(:log) { LazyTNetstring::Log.new(path) }
+  after { FileUtils.rm_rf(dir) }
+
+  describe '#append' do
+    it 'returns the record number' do
+      log.append(first).should == 0
+      log.append(LazyTNetstring::DataAccess.new(second)).should == 1
+      log.size.should == 2
+    end
+
+    it 'takes single tnetstrings only' do
+      expect { log.append('3:abc') }.to raise_error(LazyTNetstring::InvalidTNetString)
+      expect { log.append(first + second) }.to raise_error(LazyTNetstring::InvalidTNetString)
+    end
+
+    it 'needs a writable log' do
+      log.close
+      expect { LazyTNetstring::Log.new(path, :readonly => true).append(first) }.to raise_error(IOError)
+    end
+  end
+
+  describe '#[]' do
+    before do
+      log.append(first)
+      log.append(second)
+      log.append('3:abc,')
+    end
+
+    it 'reads records as data accesses' do
+      log[0]['user']['name'].should == 'bob'
+      log[1].should == LazyTNetstring::DataAccess.new(second)
+    end
+
+    it 'reads other records as values' do
+      log[2].should == 'abc'
+    end
+
+    it 'counts negative indexes from the end' do
+      log[-1].should == 'abc'
+      log[3].should be_nil
+      log[-4].should be_nil
+    end
+
+    it 'raises on changed records' do
+      log.close
+      File.open(path, 'r+') { |f| f.seek(first.index('bob') + 23); f.write('B') }
+      expect { LazyTNetstring::Log.new(path)[0] }.to raise_error(LazyTNetstring::ChecksumMismatch)
+    end
+  end
+
+  describe '#each' do
+    it 'yields the records in order' do
+      100.times { |i| log.append(LazyTNetstring.dump({'id' => i})) }
+      log.map { |record| record['id'] }.should == (0...100).to_a
+      log.each.size.should == 100
+    end
+  end
+
+  describe 'reopening' do
+    before do
+      log.append(first)
+      log.append(second)
+      log.close
+    end
+
+    it 'keeps the records' do
+      reopened = LazyTNetstring::Log.new(path, :readonly => true)
+      reopened.size.should == 2
+      reopened[1]['id'].should == 2
+    end
+
+    it 'rebuilds a lost index' do
+      File.unlink(path + '.idx')
+      LazyTNetstring::Log.new(path)[1]['id'].should == 2
+      File.size(path + '.idx').should == 16
+    end
+
+    it 'drops an incomplete last record' do
+      File.truncate(path, File.size(path) - 1)
+      reopened = LazyTNetstring::Log.new(path)
+      reopened.size.should == 1
+      reopened.append(second).should == 1
+    end
+  end
+
+  it { expect { LazyTNetstring::Log.new(File.join(dir, 'missing', 'records.log')) }.to raise_error(Errno::ENOENT) }
+
+  it 'raises once closed' do
+    log.close
+    log.should be_closed
+    expect { log.size }.to raise_error(IOError)
+  end
+end
@@ -189,4 +189,28 @@ describe LazyTNetstring do
       expect { LazyTNetstring.dump(Object.new) }.to raise_error(ArgumentError)
     end
   end
+
+  context "converting from JSON" do
+    it "converts an object into a data access" do
+      data_access = LazyTNetstring.from_json('{"hello": [12345678901, "this"]}')
+      data_access.should be_a(LazyTNetstring::DataAccess)
+      data_access.data.should == '34:5:hello,22:11:12345678901#4:this,]}'
+    end
+
+    it "converts nested objects" do
+      LazyTNetstring.from_json('{"hello": {"world": 42}}').data.should == '25:5:hello,13:5:world,2:42#}}'
+    end
+
+    it "converts floats, booleans and null" do
+      LazyTNetstring.from_json('[3.5, true, false, null]').should == [3.5, true, false, nil]
+    end
+
+    it "decodes escaped strings" do
+      LazyTNetstring.from_json('"a\\"b\\u0041"').should == 'a"bA'
+    end
+
+    it "rejects invalid JSON" do
+      expect { LazyTNetstring.from_json('{"hello": }') }.to raise_error(LazyTNetstring::InvalidJSON)
+    end
+  end
 end
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "LTNSDataAccess.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_counters();
+int test_get();
+int test_cached_child();
+int test_same_length_set();
+int test_growing_set();
+int test_iteration();
+int test_memsize();
+
+test_case tests[] =
+{
+	{test_counters, "count allocations, frees and peak bytes"},
+	{test_get, "get allocates only the returned term"},
+	{test_cached_child, "cached children are not allocated again"},
+	{test_same_length_set, "same length sets don't realloc"},
+	{test_growing_set, "growing sets realloc once"},
+	{test_iteration, "scanning a payload doesn't allocate"},
+	{test_memsize, "memsize matches the allocated bytes"}
+};
+
+/* {"a": 1, "b": "hello", "c": {"d": {"e": null}}} */
+static const char* DOCUMENT = "42:1:a,1:1#1:b,5:hello,1:c,14:1:d,7:1:e,0:~}}}";
+static LTNSDataAccess* data_access = NULL;
+
+void setup_test()
+{
+	LTNSError error;
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	reset_allocations();
+}
+
+void cleanup_test()
+{
+	LTNSDataAccessDestroy(data_access);
+}
+
+/* Bytes held by a term returned from get */
+static long long term_bytes()
+{
+	LTNSTerm* term = NULL;
+	reset_allocations();
+	LTNSError error = LTNSDataAccessGet(data_access, "a", &term);
+	assert(!error);
+	long long bytes = allocations.bytes;
+	LTNSTermDestroy(term);
+	reset_allocations();
+	return bytes;
+}
+
+int test_counters()
+{
+	char* block = malloc(10);
+	block = realloc(block, 100);
+	free(calloc(2, 50));
+	assert(allocations.allocations == 2);
+	assert(allocations.reallocs == 1);
+	assert(allocations.frees == 1);
+	assert(allocations.bytes == 100);
+	assert(allocations.peak_bytes == 200);
+
+	free(block);
+	assert(allocations.bytes == 0);
+
+	reset_allocations();
+	assert(allocations.allocations == 0);
+	assert(allocations.peak_bytes == 0);
+	return 1;
+}
+
+int test_get()
+{
+	LTNSError error;
+	LTNSTerm* term = NULL;
+	long long bytes = term_bytes();
+	assert(bytes > 0);
+
+	/* Looking a key up again costs the same */
+	error = LTNSDataAccessGet(data_access, "b", &term);
+	assert(!error);
+	assert(allocations.allocations == 1);
+	assert(allocations.reallocs == 0);
+	assert(allocations.peak_bytes == bytes);
+	LTNSTermDestroy(term);
+	assert(allocations.bytes == 0);
+
+	reset_allocations();
+	error = LTNSDataAccessGet(data_access, "b", &term);
+	assert(!error);
+	assert(allocations.allocations == 1);
+	LTNSTermDestroy(term);
+
+	/* Misses don't allocate at all */
+	reset_allocations();
+	error = LTNSDataAccessGet(data_access, "x", &term);
+	assert(error == KEY_NOT_FOUND);
+	assert(allocations.allocations == 0);
+	return 1;
+}
+
+int test_cached_child()
+{
+	LTNSError error;
+	LTNSDataAccess *child = NULL, *cached = NULL;
+	LTNSTerm* term = NULL;
+	error = LTNSDataAccessGet(data_access, "c", &term);
+	assert(!error);
+	error = LTNSDataAccessCreateNested(&child, data_access, term);
+	assert(!error);
+
+	reset_allocations();
+	error = LTNSDataAccessCreateNested(&cached, data_access, term);
+	assert(!error);
+	assert(cached == child);
+	assert(allocations.allocations == 0);
+	assert(allocations.peak_bytes == 0);
+	LTNSDataAccessDestroy(cached);
+
+	LTNSTermDestroy(term);
+	LTNSDataAccessDestroy(child);
+	return 1;
+}
+
+int test_same_length_set()
+{
+	LTNSError error;
+	LTNSTerm* term = NULL;
+	long long bytes = term_bytes();
+	error = LTNSTermCreate(&term, "world", 5, LTNS_STRING);
+	assert(!error);
+
+	/* Only the lookup of the old value allocates, the document stays put */
+	reset_allocations();
+	error = LTNSDataAccessSet(data_access, "b", term);
+	assert(!error);
+	assert(allocations.allocations == 1);
+	assert(allocations.reallocs == 0);
+	assert(allocations.frees == 1);
+	assert(allocations.peak_bytes == bytes);
+	assert(allocations.bytes == 0);
+
+	LTNSTermDestroy(term);
+	return 1;
+}
+
+int test_growing_set()
+{
+	LTNSError error;
+	LTNSTerm* term = NULL;
+	error = LTNSTermCreate(&term, "worlds", 6, LTNS_STRING);
+	assert(!error);
+
+	reset_allocations();
+	error = LTNSDataAccessSet(data_access, "b", term);
+	assert(!error);
+	/* The lookup of the old value and a term of the document for its new
+	 * length prefix, which grew by one byte */
+	assert(allocations.allocations == 2);
+	assert(allocations.frees == 2);
+	assert(allocations.reallocs == 1);
+	assert(allocations.bytes == 1);
+
+	LTNSTermDestroy(term);
+	return 1;
+}
+
+int test_iteration()
+{
+	LTNSError error;
+	LTNSTerm* term = NULL;
+	char *payload, *position, *value;
+	size_t payload_length, length;
+	LTNSType type;
+	int count = 0;
+	error = LTNSDataAccessAsTerm(data_access, &term);
+	assert(!error);
+	error = LTNSTermGetPayload(term, &payload, &payload_length, NULL);
+	assert(!error);
+
+	reset_allocations();
+	for (position = payload; position < payload + payload_length; count++)
+	{
+		error = LTNSTermScan(position, payload + payload_length, &value, &length, &type);
+		assert(!error);
+		position = value + length + 1;
+	}
+	assert(count == 6);
+	assert(allocations.allocations == 0);
+
+	LTNSTermDestroy(term);
+	return 1;
+}
+
+int test_memsize()
+{
+	LTNSError error;
+	LTNSDataAccess *root = NULL, *child = NULL;
+	LTNSTerm* term = NULL;
+	size_t bytes, root_bytes, child_bytes;
+
+	reset_allocations();
+	error = LTNSDataAccessCreate(&root, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	error = LTNSDataAccessMemsize(root, &root_bytes);
+	assert(!error);
+	assert(root_bytes == (size_t)allocations.bytes);
+
+	/* The child holds its struct, the root one more list node */
+	error = LTNSDataAccessGet(root, "c", &term);
+	assert(!error);
+	reset_allocations();
+	error = LTNSDataAccessCreateNested(&child, root, term);
+	assert(!error);
+	error = LTNSDataAccessMemsize(child, &child_bytes);
+	assert(!error);
+	error = LTNSDataAccessMemsize(root, &bytes);
+	assert(!error);
+	assert(child_bytes < root_bytes);
+	assert(bytes - root_bytes + child_bytes == (size_t)allocations.bytes);
+	error = LTNSDataAccessMemsize(root, NULL);
+	assert(error == INVALID_ARGUMENT);
+
+	LTNSTermDestroy(term);
+	LTNSDataAccessDestroy(child);
+	LTNSDataAccessDestroy(root);
+	return 1;
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "LTNSBatch.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_invalid_arguments();
+int test_extract();
+int test_missing_values();
+int test_threads();
+
+test_case tests[] =
+{
+	{test_invalid_arguments, "reject invalid arguments"},
+	{test_extract, "extract values of every path"},
+	{test_missing_values, "leave out missing values and invalid documents"},
+	{test_threads, "threads extract the same values"}
+};
+
+void setup_test()
+{
+}
+
+void cleanup_test()
+{
+}
+
+/* {"a": "1", "inner": {"b": 2}} */
+static const char* DOCUMENT = "27:1:a,1:1,5:inner,8:1:b,1:2#}}";
+/* {"a": "other"} */
+static const char* OTHER = "12:1:a,5:other,}";
+
+static const char* A[] = { "a" };
+static const char* INNER_B[] = { "inner", "b" };
+static const char* INNER[] = { "inner" };
+
+static int extracted(LTNSExtract* result, const char* value)
+{
+	if (!value)
+		return result->tnetstring == NULL;
+	return result->length == strlen(value) && !strncmp(result->tnetstring, value, result->length);
+}
+
+int test_invalid_arguments()
+{
+	LTNSError error;
+	const char* documents[] = { DOCUMENT };
+	size_t lengths[] = { strlen(DOCUMENT) };
+	LTNSPath paths[] = { { A, 1 } };
+	LTNSExtract results[1];
+
+	error = LTNSBatchExtract(NULL, lengths, 1, paths, 1, results, 1);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSBatchExtract(documents, NULL, 1, paths, 1, results, 1);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSBatchExtract(documents, lengths, 1, NULL, 1, results, 1);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSBatchExtract(documents, lengths, 1, paths, 1, NULL, 1);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSBatchExtract(documents, lengths, 1, paths, 1, results, 0);
+	assert(error == INVALID_ARGUMENT);
+	/* Nothing to do */
+	error = LTNSBatchExtract(NULL, NULL, 0, paths, 1, NULL, 1);
+	assert(!error);
+	error = LTNSBatchExtract(documents, lengths, 1, NULL, 0, NULL, 1);
+	assert(!error);
+	return 1;
+}
+
+int test_extract()
+{
+	LTNSError error;
+	const char* documents[] = { DOCUMENT, OTHER };
+	size_t lengths[] = { strlen(DOCUMENT), strlen(OTHER) };
+	LTNSPath paths[] = { { A, 1 }, { INNER_B, 2 }, { INNER, 1 } };
+	LTNSExtract results[6];
+
+	error = LTNSBatchExtract(documents, lengths, 2, paths, 3, results, 1);
+	assert(!error);
+	assert(extracted(&results[0], "1:1,"));
+	assert(extracted(&results[1], "1:2#"));
+	assert(extracted(&results[2], "8:1:b,1:2#}"));
+	assert(extracted(&results[3], "5:other,"));
+	assert(extracted(&results[4], NULL));
+	assert(extracted(&results[5], NULL));
+
+	/* Values point into the documents */
+	assert(results[0].tnetstring > DOCUMENT && results[0].tnetstring < DOCUMENT + lengths[0]);
+	/* No allocations for a single thread */
+	assert(allocations.allocations == 0);
+	return 1;
+}
+
+int test_missing_values()
+{
+	LTNSError error;
+	/* A list, a document with a corrupt inner dictionary and no document */
+	const char* documents[] = { "4:1:a,]", "27:1:a,1:1,5:inner,8:xxxxxxxx}}", NULL };
+	size_t lengths[] = { 7, 31, 0 };
+	LTNSPath paths[] = { { A, 1 }, { INNER_B, 2 } };
+	LTNSExtract results[6];
+
+	error = LTNSBatchExtract(documents, lengths, 3, paths, 2, results, 1);
+	assert(!error);
+	assert(extracted(&results[0], NULL));
+	assert(extracted(&results[1], NULL));
+	/* Only what's on the way to a value is checked */
+	assert(extracted(&results[2], "1:1,"));
+	assert(extracted(&results[3], NULL));
+	assert(extracted(&results[4], NULL));
+	assert(extracted(&results[5], NULL));
+	return 1;
+}
+
+#define DOCUMENTS 10000
+
+int test_threads()
+{
+	LTNSError error;
+	const char** documents = (const char**)malloc(sizeof(char*) * DOCUMENTS);
+	size_t* lengths = (size_t*)malloc(sizeof(size_t) * DOCUMENTS);
+	LTNSExtract* single = (LTNSExtract*)malloc(sizeof(LTNSExtract) * DOCUMENTS * 2);
+	LTNSExtract* parallel = (LTNSExtract*)malloc(sizeof(LTNSExtract) * DOCUMENTS * 2);
+	LTNSPath paths[] = { { A, 1 }, { INNER_B, 2 } };
+	for (int i = 0; i < DOCUMENTS; i++)
+	{
+		documents[i] = i % 3 ? DOCUMENT : OTHER;
+		lengths[i] = strlen(documents[i]);
+	}
+
+	error = LTNSBatchExtract(documents, lengths, DOCUMENTS, paths, 2, single, 1);
+	assert(!error);
+	error = LTNSBatchExtract(documents, lengths, DOCUMENTS, paths, 2, parallel, 4);
+	assert(!error);
+	assert(!memcmp(single, parallel, sizeof(LTNSExtract) * DOCUMENTS * 2));
+	assert(extracted(&parallel[2 * (DOCUMENTS - 2)], "1:1,"));
+	assert(extracted(&parallel[2 * (DOCUMENTS - 2) + 1], "1:2#"));
+
+	/* More threads than documents */
+	error = LTNSBatchExtract(documents, lengths, 2, paths, 2, parallel, 64);
+	assert(!error);
+	assert(!memcmp(single, parallel, sizeof(LTNSExtract) * 4));
+
+	free(documents);
+	free(lengths);
+	free(single);
+	free(parallel);
+	return 1;
+}
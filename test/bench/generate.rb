@@ -0,0 +1,161 @@
+#!/usr/bin/ruby
+#
+# Generates synthetic tnetstring documents along controlled axes, together
+# with a matching .keys file like obfruscate.rb writes.
+#
+#   width:       keys per dictionary
+#   depth:       levels of nested dictionaries
+#   value_size:  bytes per string value (integers get up to 18 digits)
+#   list_length: values in the list every dictionary carries (0 for none)
+#   branch:      nested dictionaries per dictionary
+#   size:        if given, repeat the document under fresh top level keys
+#                until the file is at least this large (e.g. 512K, 100M)
+#
+# usage: ruby generate.rb [--width N] [--depth N] [--value-size N]
+#                         [--list-length N] [--branch N] [--size N]
+#                         [--seed N] [--out NAME]
+
+require './helper.rb'
+
+DEFAULT_AXES = { 'width' => 10, 'depth' => 3, 'value_size' => 16, 'list_length' => 0, 'branch' => 1, 'size' => nil }
+
+def parse_size(string)
+	return nil if string.nil?
+	factor = { 'K' => 1024, 'M' => 1024 ** 2, 'G' => 1024 ** 3 }[string[-1].upcase] || 1
+	return string.to_i * factor
+end
+
+def dump_tnetstring(value)
+	if value.kind_of? Hash
+		payload = ''
+		value.each { |key, element| payload << dump_tnetstring(key.to_s) << dump_tnetstring(element) }
+		return "#{payload.bytesize}:#{payload}}"
+	elsif value.kind_of? Array
+		payload = ''
+		value.each { |element| payload << dump_tnetstring(element) }
+		return "#{payload.bytesize}:#{payload}]"
+	elsif value.kind_of? Integer
+		return "#{value.to_s.bytesize}:#{value}#"
+	else
+		return "#{value.to_s.bytesize}:#{value},"
+	end
+end
+
+class CorpusGenerator
+	attr_reader :keys
+
+	def initialize(axes)
+		@axes = DEFAULT_AXES.merge(axes)
+		@keys = []
+
+		# every dictionary of one level shares its keys, like records of one schema
+		@schema = (0...@axes['depth']).map { |level| (0...@axes['width']).map { new_key } }
+		@list_key = new_key if @axes['list_length'] > 0
+
+		# values are slices of a random pool, generating every byte is too slow
+		# for documents of hundreds of MB
+		@pool = random_string(65536)
+	end
+
+	# Returns the whole document as a tnetstring
+	def document
+		return dump_tnetstring(dictionary(0)) unless @axes['size']
+
+		entries = []
+		bytes = 0
+		index = 0
+		while bytes < @axes['size']
+			# some plain values at the top level, too, so there is something to set
+			value = index % 8 == 0 ? string_value : dictionary(0)
+			entry = dump_tnetstring(new_top_level_key(index)) + dump_tnetstring(value)
+			entries << entry
+			bytes += entry.bytesize
+			index += 1
+		end
+		return "#{bytes}:" + entries.join + '}'
+	end
+
+	private
+
+	def new_key
+		begin
+			key = random_string(rand(4..12))
+		end while @keys.include?(key)
+		@keys << key
+		return key
+	end
+
+	def new_top_level_key(index)
+		key = random_string(4) + index.to_s
+		@keys << key
+		return key
+	end
+
+	def string_value
+		size = @axes['value_size']
+		value = ''
+		while value.bytesize < size
+			length = [size - value.bytesize, @pool.bytesize].min
+			value << @pool[rand(@pool.bytesize - length + 1), length]
+		end
+		return value
+	end
+
+	def integer_value
+		return random_integer([[@axes['value_size'], 18].min, 1].max).to_i
+	end
+
+	def dictionary(level)
+		keys = @schema[level]
+		nested = level + 1 < @axes['depth'] ? [@axes['branch'], keys.length].min : 0
+
+		dict = {}
+		dict[@list_key] = Array.new(@axes['list_length']) { string_value } if @list_key
+		keys.each_with_index do |key, i|
+			if i >= keys.length - nested
+				dict[key] = dictionary(level + 1)
+			elsif i % 4 == 3
+				dict[key] = integer_value
+			else
+				dict[key] = string_value
+			end
+		end
+		return dict
+	end
+end
+
+# Writes NAME.tnet and NAME.keys and returns the name of the .tnet file
+def generate(axes, name = nil)
+	axes = DEFAULT_AXES.merge(axes)
+	unless name
+		name = "w#{axes['width']}_d#{axes['depth']}_v#{axes['value_size']}_l#{axes['list_length']}_b#{axes['branch']}"
+		name += "_s#{axes['size']}" if axes['size']
+	end
+
+	generator = CorpusGenerator.new(axes)
+	File.open(name + '.tnet', 'w') { |file| file.write(generator.document) }
+	File.open(name + '.keys', 'w') { |file| generator.keys.each { |key| file.write(key + "\n") } }
+	return name + '.tnet'
+end
+
+def main
+	axes = {}
+	name = nil
+	while ARGV[0] && ARGV[0].start_with?('--')
+		option = ARGV.shift
+		case option
+		when '--size' then axes['size'] = parse_size(ARGV.shift)
+		when '--seed' then srand(ARGV.shift.to_i)
+		when '--out' then name = ARGV.shift
+		else
+			axis = option[2..-1].tr('-', '_')
+			raise "Unknown option #{option}" unless DEFAULT_AXES.has_key?(axis)
+			axes[axis] = ARGV.shift.to_i
+		end
+	end
+
+	file = generate(axes, name)
+	puts "done generating \"./#{file}\" (#{File.size(file)} bytes)"
+end
+
+main if __FILE__ == $0
@@ -2,13 +2,12 @@
 # Parses a given json file and obfruscates all information
 require 'digest/md5'
 require 'json'
-require 'tnetstring'
 
 def random_integer( length )
 	s = (rand(9)+1).to_s # allway start with a !0
 
 	(1..length-1).each do |i|
-		s += rand(10).to_s 
+		s << rand(10).to_s
 	end
 	return s;
 end
@@ -23,7 +22,7 @@ def random_string( length )
 			char = char.capitalize
 		end
 
-		s += char	
+		s << char
 	end
 	return s;
 end
@@ -51,7 +50,7 @@ def obfruscate( element, pad_map )
 		new_element = obfruscate_hash( element, pad_map)
 	elsif element.kind_of? Array
 		new_element = obfruscate_list( element, pad_map)
-	elsif element.kind_of? Fixnum
+	elsif element.kind_of? Integer
 		new_element = randomize_length(element, false);
 	else # string or sth 
 		new_element = randomize_length(element, true);
@@ -2,6 +2,7 @@
 #
 # Parses a given json file and obfruscates all information
 
+require 'tnetstring'
 require './helper.rb'
 
 # check file given
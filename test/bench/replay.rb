@@ -0,0 +1,163 @@
+#!/usr/bin/ruby
+#
+# Replays a trace written by LazyTNetstring.start_recording against the
+# recorded document snapshots and reports per operation latencies. Walking
+# down to the nested DataAccess an operation works on isn't timed, set
+# values are synthesized with the recorded type and length.
+#
+# usage: ruby replay.rb [--loops N] [--json FILE] TRACE
+
+require 'lazy_tnetstring'
+require 'json'
+
+TRACE_MAGIC = 'LTNSTRC1'
+OPERATIONS = { 'G' => 'get', 'S' => 'set', 'R' => 'delete' }
+
+class TraceReader
+	def initialize(data)
+		raise 'Not a lazy_tnetstring trace' unless data.start_with?(TRACE_MAGIC)
+		@data = data
+		@position = TRACE_MAGIC.bytesize
+	end
+
+	# Yields [:document, id, tnetstring] and [operation, id, path, type, length]
+	def each
+		while @position < @data.bytesize
+			record = read(1)
+			if record == 'D'
+				id = number
+				yield [:document, id, read(number)]
+			elsif OPERATIONS.has_key?(record)
+				id = number
+				path = Array.new(number) { read(number) }
+				type, length = record == 'S' ? [read(1), number] : [nil, nil]
+				yield [OPERATIONS[record], id, path, type, length]
+			else
+				raise "Corrupt trace at byte #{@position - 1}"
+			end
+		end
+	end
+
+	private
+
+	def read(length)
+		raise 'Truncated trace' if @position + length > @data.bytesize
+		bytes = @data.byteslice(@position, length)
+		@position += length
+		return bytes
+	end
+
+	# BER compressed integer, like unpack('w')
+	def number
+		value = 0
+		begin
+			byte = read(1).ord
+			value = (value << 7) | (byte & 0x7f)
+		end while byte & 0x80 != 0
+		return value
+	end
+end
+
+def synthesize(type, length)
+	case type
+	when '#' then length > 0 ? ('1' * length).to_i : 0
+	when '^' then 1.5
+	when '!' then length == 4
+	when '~' then nil
+	when ']' then ['x' * [length - 4, 0].max]
+	when '}' then { 'k' => 'x' * [length - 8, 0].max }
+	else 'x' * length
+	end
+end
+
+def load_trace(file)
+	documents = {}
+	operations = []
+	TraceReader.new(File.binread(file)).each do |record|
+		if record[0] == :document
+			documents[record[1]] = record[2]
+		else
+			# a delete looks its value up first, that get belongs to the delete
+			previous = operations.last
+			if record[0] == 'delete' && previous && previous[0] == 'get' && previous[1, 2] == record[1, 2]
+				operations.pop
+			end
+			operations << record
+		end
+	end
+	return documents, operations
+end
+
+def percentile(sorted, fraction)
+	return 0.0 if sorted.empty?
+	return sorted[[(sorted.length * fraction).ceil - 1, 0].max]
+end
+
+def replay(documents, operations, latencies)
+	trees = {}
+	documents.each { |id, data| trees[id] = LazyTNetstring::DataAccess.new(data.dup) }
+	skipped = 0
+	operations.each do |operation, id, path, type, length|
+		target = trees[id]
+		path[0..-2].each { |key| target = target && target[key] }
+		unless target.kind_of?(LazyTNetstring::DataAccess)
+			skipped += 1
+			next
+		end
+		key = path[-1]
+		value = synthesize(type, length) if operation == 'set'
+
+		before = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+		case operation
+		when 'get' then target[key]
+		when 'set' then target[key] = value
+		when 'delete' then target.delete(key)
+		end
+		latencies[operation] << Process.clock_gettime(Process::CLOCK_MONOTONIC) - before
+	end
+	return skipped
+end
+
+def main
+	loops = 1
+	json_file = nil
+	while ARGV[0] && ARGV[0].start_with?('--')
+		option = ARGV.shift
+		case option
+		when '--loops' then loops = ARGV.shift.to_i
+		when '--json' then json_file = ARGV.shift
+		else raise "Unknown option #{option}"
+		end
+	end
+	raise "No trace given!" unless ARGV[0]
+
+	documents, operations = load_trace(ARGV[0])
+	puts "#{documents.length} documents, #{operations.length} operations"
+
+	latencies = Hash.new { |hash, operation| hash[operation] = [] }
+	skipped = 0
+	loops.times { skipped += replay(documents, operations, latencies) }
+	puts "#{skipped} operations skipped, their path no longer leads to a DataAccess" if skipped > 0
+
+	results = []
+	puts format('%-8s %10s %12s %10s %10s %10s', 'op', 'count', 'ops/sec', 'p50 us', 'p99 us', 'p999 us')
+	latencies.each do |operation, times|
+		total = times.inject(0.0, :+)
+		times.sort!
+		result = {
+			'operation' => operation,
+			'count' => times.length,
+			'ops_per_sec' => total > 0 ? times.length / total : 0.0,
+			'p50_us' => percentile(times, 0.5) * 1e6,
+			'p99_us' => percentile(times, 0.99) * 1e6,
+			'p999_us' => percentile(times, 0.999) * 1e6
+		}
+		puts format('%-8s %10d %12.0f %10.2f %10.2f %10.2f', operation, result['count'],
+			result['ops_per_sec'], result['p50_us'], result['p99_us'], result['p999_us'])
+		results << result
+	end
+
+	File.open(json_file, 'w') { |f| f.write(JSON.pretty_generate('results' => results)) } if json_file
+end
+
+main
@@ -0,0 +1,163 @@
+#!/usr/bin/ruby
+#
+# Benchmarks parse, read, write, iteration, to_hash and dump separately for
+# lazy_tnetstring and, if available, the tnetstring gem, JSON and Marshal.
+# Every workload reports ops/sec, latency percentiles, GC runs and objects
+# allocated per operation.
+#
+# usage: ruby suite.rb [--time SECONDS] [--only lazy,json,...] [--json FILE] FILE.tnet...
+
+require 'lazy_tnetstring'
+require 'json'
+
+begin
+	require 'tnetstring'
+rescue LoadError
+end
+
+class Implementation
+	attr_reader :name
+
+	def initialize(name, decode, encode)
+		@name = name
+		@decode = decode
+		@encode = encode
+	end
+
+	def encode(hash)
+		@encode.call(hash)
+	end
+
+	def decode(data)
+		@decode.call(data)
+	end
+end
+
+def implementations
+	list = []
+	list << Implementation.new('lazy',
+		lambda { |data| LazyTNetstring::DataAccess.new(data) },
+		lambda { |hash| LazyTNetstring.dump(hash) })
+	if defined?(TNetstring)
+		list << Implementation.new('tnetstring',
+			lambda { |data| TNetstring.parse(data)[0] },
+			lambda { |hash| TNetstring.dump(hash) })
+	end
+	list << Implementation.new('json',
+		lambda { |data| JSON.parse(data) },
+		lambda { |hash| JSON.dump(hash) })
+	list << Implementation.new('marshal',
+		lambda { |data| Marshal.load(data) },
+		lambda { |hash| Marshal.dump(hash) })
+	return list
+end
+
+# Replaces a value with one of a different length, so lazy documents have to
+# move their tail
+def changed_value(value, i)
+	if value.kind_of?(Integer)
+		return value + (i.even? ? 1000 : -1000)
+	elsif value.kind_of?(String)
+		return i.even? ? value + 'xxxx' : value[0, value.length / 2]
+	end
+	return i
+end
+
+def workloads(implementation, hash)
+	data = implementation.encode(hash)
+	keys = hash.keys
+	writable = keys.select { |key| hash[key].kind_of?(String) || hash[key].kind_of?(Integer) }
+	document = implementation.decode(data)
+
+	list = {}
+	list['parse'] = lambda { |i| implementation.decode(data) }
+	list['read'] = lambda { |i| document[keys[i % keys.length]] }
+	unless writable.empty?
+		list['write'] = lambda do |i|
+			key = writable[i % writable.length]
+			document[key] = changed_value(document[key], i)
+		end
+	end
+	list['iterate'] = lambda { |i| document.each { |key, value| value } }
+	list['to_hash'] = lambda { |i| document.to_hash } if document.kind_of?(LazyTNetstring::DataAccess)
+	list['dump'] = lambda do |i|
+		document.kind_of?(LazyTNetstring::DataAccess) ? document.data : implementation.encode(document)
+	end
+	return list
+end
+
+def percentile(sorted, fraction)
+	return 0.0 if sorted.empty?
+	return sorted[[(sorted.length * fraction).ceil - 1, 0].max]
+end
+
+def measure(seconds, workload)
+	# warm up
+	workload.call(0)
+
+	latencies = []
+	gc_count = GC.count
+	allocated = GC.stat(:total_allocated_objects)
+	started = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+	deadline = started + seconds
+	i = 0
+	loop do
+		before = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+		workload.call(i)
+		after = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+		latencies << after - before
+		i += 1
+		break if after >= deadline
+	end
+	total = Process.clock_gettime(Process::CLOCK_MONOTONIC) - started
+
+	latencies.sort!
+	return {
+		'ops' => i,
+		'ops_per_sec' => i / total,
+		'p50_us' => percentile(latencies, 0.5) * 1e6,
+		'p99_us' => percentile(latencies, 0.99) * 1e6,
+		'p999_us' => percentile(latencies, 0.999) * 1e6,
+		'gc_runs' => GC.count - gc_count,
+		'allocated_per_op' => (GC.stat(:total_allocated_objects) - allocated).to_f / i
+	}
+end
+
+def main
+	seconds = 1.0
+	only = nil
+	json_file = nil
+	while ARGV[0] && ARGV[0].start_with?('--')
+		option = ARGV.shift
+		case option
+		when '--time' then seconds = ARGV.shift.to_f
+		when '--only' then only = ARGV.shift.split(',')
+		when '--json' then json_file = ARGV.shift
+		else raise "Unknown option #{option}"
+		end
+	end
+	raise "No file(s) given!" if ARGV.empty?
+
+	results = []
+	puts format('%-28s %-11s %-8s %12s %10s %10s %10s %8s %10s',
+		'file', 'library', 'workload', 'ops/sec', 'p50 us', 'p99 us', 'p999 us', 'gc runs', 'objs/op')
+	ARGV.each do |file|
+		hash = LazyTNetstring::DataAccess.new(File.read(file).chomp).to_hash
+		hash = JSON.parse(JSON.dump(hash)) # plain nested hashes for every library
+
+		implementations.each do |implementation|
+			next if only && !only.include?(implementation.name)
+			workloads(implementation, hash).each do |workload, block|
+				result = measure(seconds, block)
+				puts format('%-28s %-11s %-8s %12.0f %10.2f %10.2f %10.2f %8d %10.1f',
+					file, implementation.name, workload, result['ops_per_sec'], result['p50_us'],
+					result['p99_us'], result['p999_us'], result['gc_runs'], result['allocated_per_op'])
+				results << { 'file' => file, 'library' => implementation.name, 'workload' => workload }.merge(result)
+			end
+		end
+	end
+
+	File.open(json_file, 'w') { |f| f.write(JSON.pretty_generate('results' => results)) } if json_file
+end
+
+main
@@ -0,0 +1,116 @@
+#!/usr/bin/ruby
+#
+# Sweeps one axis of generate.rb, benchmarks every generated document and
+# plots time per operation against the axis. The slope of the log-log fit
+# estimates the complexity of each operation, ~0 is O(1) and ~1 is O(n).
+#
+# usage: ruby sweep.rb [--suite] [--min-time MS] [--dir DIR] [--csv FILE]
+#                      [--width N ...] AXIS VALUE,VALUE...
+#
+# e.g.   ruby sweep.rb --depth 2 size 1M,10M,100M
+
+require 'json'
+require './generate.rb'
+
+MICRO_BENCH = '../micro_bench'
+
+def micro_bench(file, min_time)
+	raise "#{MICRO_BENCH} not found, run 'make micro_bench' in test/" unless File.executable?(MICRO_BENCH)
+
+	json = "#{file}.micro.json"
+	raise 'micro_bench failed' unless system(MICRO_BENCH, '--min-time', min_time.to_s, '--json', json, file, :out => File::NULL)
+	results = JSON.parse(File.read(json))['results']
+	File.unlink(json)
+	return results.map { |result| ['c ' + result['benchmark'], result['ns_per_op']] }
+end
+
+def suite(file, min_time)
+	json = "#{file}.suite.json"
+	raise 'suite.rb failed' unless system('ruby', '-I../../ext', 'suite.rb', '--only', 'lazy',
+		'--time', (min_time / 1000.0).to_s, '--json', json, file, :out => File::NULL)
+	results = JSON.parse(File.read(json))['results']
+	File.unlink(json)
+	return results.map { |result| ['ruby ' + result['workload'], 1e9 / result['ops_per_sec']] }
+end
+
+# Least squares slope of log(y) over log(x)
+def log_log_slope(points)
+	points = points.select { |x, y| x > 0 && y > 0 }
+	return nil if points.length < 2
+	xs = points.map { |x, y| Math.log(x) }
+	ys = points.map { |x, y| Math.log(y) }
+	x_mean = xs.inject(:+) / xs.length
+	y_mean = ys.inject(:+) / ys.length
+	numerator = 0.0
+	denominator = 0.0
+	xs.each_with_index do |x, i|
+		numerator += (x - x_mean) * (ys[i] - y_mean)
+		denominator += (x - x_mean) ** 2
+	end
+	return denominator == 0 ? nil : numerator / denominator
+end
+
+def plot(benchmark, axis, points)
+	slope = log_log_slope(points)
+	puts
+	puts "#{benchmark}" + (slope ? format(' ~ O(n^%.2f) in %s', slope, axis) : '')
+	max = Math.log10(points.map { |x, y| y }.max + 1)
+	points.each do |x, y|
+		bar = max > 0 ? (Math.log10(y + 1) / max * 50).round : 0
+		puts format('  %12d %14.1f ns |%s', x, y, '#' * bar)
+	end
+end
+
+def main
+	axes = {}
+	min_time = 200
+	dir = 'data/generated'
+	csv_file = nil
+	run_suite = false
+	while ARGV[0] && ARGV[0].start_with?('--')
+		option = ARGV.shift
+		case option
+		when '--suite' then run_suite = true
+		when '--min-time' then min_time = ARGV.shift.to_i
+		when '--dir' then dir = ARGV.shift
+		when '--csv' then csv_file = ARGV.shift
+		when '--size' then axes['size'] = parse_size(ARGV.shift)
+		else
+			axis = option[2..-1].tr('-', '_')
+			raise "Unknown option #{option}" unless DEFAULT_AXES.has_key?(axis)
+			axes[axis] = ARGV.shift.to_i
+		end
+	end
+	axis = ARGV[0] && ARGV[0].tr('-', '_')
+	raise "usage: ruby sweep.rb [options] AXIS VALUE,VALUE..." unless DEFAULT_AXES.has_key?(axis) && ARGV[1]
+	values = ARGV[1].split(',').map { |value| axis == 'size' ? parse_size(value) : value.to_i }
+
+	Dir.mkdir(dir) unless File.directory?(dir)
+	rows = []
+	values.each do |value|
+		srand(value) # the same sweep always produces the same documents
+		file = generate(axes.merge(axis => value), File.join(dir, "sweep_#{axis}_#{value}"))
+		bytes = File.size(file)
+		puts "#{file}: #{bytes} bytes"
+
+		results = micro_bench(file, min_time)
+		results += suite(file, min_time) if run_suite
+		results.each do |benchmark, ns|
+			rows << { 'axis' => axis, 'value' => value, 'bytes' => bytes, 'benchmark' => benchmark, 'ns_per_op' => ns }
+		end
+	end
+
+	rows.map { |row| row['benchmark'] }.uniq.each do |benchmark|
+		points = rows.select { |row| row['benchmark'] == benchmark }.map { |row| [row['value'], row['ns_per_op']] }
+		plot(benchmark, axis, points)
+	end
+
+	if csv_file
+		File.open(csv_file, 'w') do |file|
+			file.write("axis,value,bytes,benchmark,ns_per_op\n")
+			rows.each { |row| file.write(row.values_at('axis', 'value', 'bytes', 'benchmark', 'ns_per_op').join(',') + "\n") }
+		end
+	end
+end
+
+main
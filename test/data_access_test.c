@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
 
 #include "LTNSTerm.h"
 #include "LTNSDataAccess.h"
@@ -40,6 +41,24 @@ int test_set_nested();
 int test_set_known_null();
 int test_set_unknown_null();
 int test_set_nested_null();
+/* compare */
+int test_equals();
+int test_equivalent();
+int test_hash_invalidated_on_set();
+int test_journal_record();
+int test_journal_apply();
+int test_journal_fd();
+int test_journal_fd_error();
+/* merge */
+int test_merge_policies();
+int test_merge_nested();
+int test_merge_journal();
+/* project */
+int test_project();
+int test_path();
+int test_version();
+int test_length();
+int test_freeze();
 
 test_case tests[] = 
 {
@@ -73,7 +92,26 @@ test_case tests[] =
 	/* remove */
 	{test_set_known_null, "set a known key's value to null"},
 	{test_set_unknown_null, "set a unknown key's value to null"},
-	{test_set_nested_null, "set a known nested key's value to null"}
+	{test_set_nested_null, "set a known nested key's value to null"},
+	/* compare */
+	{test_equals, "compare scoped tnetstrings byte-wise"},
+	{test_equivalent, "compare dictionaries ignoring key order"},
+	{test_hash_invalidated_on_set, "recalculate cached hashes after nested changes"},
+	/* journal */
+	{test_journal_record, "record sets and removes with their full path"},
+	{test_journal_apply, "replay a journal on a copy of the document"},
+	{test_journal_fd, "write journal operations through to a file descriptor"},
+	{test_journal_fd_error, "report failed journal writes after changing the document"},
+	/* merge */
+	{test_merge_policies, "merge with replace, keep and deep policies"},
+	{test_merge_nested, "merge into a nested hash changing its prefix width"},
+	{test_merge_journal, "journal a merge as sets of the changed keys"},
+	/* project */
+	{test_project, "project keys and nested paths into a new hash"},
+	{test_path, "list the keys from the root to a nested data access"},
+	{test_version, "versions change with the keys of their dictionary"},
+	{test_length, "report the length of root and nested data accesses"},
+	{test_freeze, "reject changes to frozen trees and create their children detached"}
 };
 
 void setup_test()
@@ -113,6 +151,22 @@ static LTNSTerm* get_term(LTNSDataAccess* data_access, const char* key)
 	return term;
 }
 
+static int check_tnetstring(LTNSDataAccess* data_access, const char* expected)
+{
+	LTNSError error;
+	LTNSTerm* term = NULL;
+	char* tnetstring;
+	size_t length;
+
+	error = LTNSDataAccessAsTerm(data_access, &term);
+	assert(!error);
+	error = LTNSTermGetTNetstring(term, &tnetstring, &length);
+	assert(!error);
+	int equal = length == strlen(expected) && !memcmp(tnetstring, expected, length);
+	LTNSTermDestroy(term);
+	return equal;
+}
+
 static int check_term(LTNSTerm* term, const char* expected_payload, size_t expected_payload_length, LTNSType expected_type)
 {
 	char* payload;
@@ -157,12 +211,12 @@ static int set_and_check(LTNSDataAccess* data_access, const char* key, char* pay
 	LTNSTerm *term = NULL, *after_set = NULL;
 
 	term = new_term(payload);
-	assert(set_key(data_access, key, term));
-	assert(!LTNSTermDestroy(term));
+	set_key(data_access, key, term);
+	LTNSTermDestroy(term);
 
 	after_set = get_term(data_access, key);
 	assert(check_term(after_set, payload, length, type));
-	assert(!LTNSTermDestroy(after_set));
+	LTNSTermDestroy(after_set);
 
 	return TRUE;
 }
@@ -626,3 +680,704 @@ int test_set_nested_null()
 	return 1;
 }
 
+
+int test_equals()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *other, *inner;
+	LTNSTerm *term = NULL;
+	int equal = FALSE;
+
+	data_access = new_data_access("24:5:outer,12:3:foo,3:bar,}}");
+	other = new_data_access("12:3:foo,3:bar,}");
+	term = get_term(data_access, "outer");
+	inner = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+
+	error = LTNSDataAccessEquals(data_access, other, &equal);
+	assert(!error);
+	assert(!equal);
+	error = LTNSDataAccessEquals(inner, other, &equal);
+	assert(!error);
+	assert(equal);
+
+	error = LTNSDataAccessDestroy(inner);
+	assert(!error);
+	error = LTNSDataAccessDestroy(other);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_equivalent()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *other;
+	int equivalent = FALSE;
+
+	data_access = new_data_access("38:1:a,1:1#1:b,22:1:c,1:3#1:d,7:1:1#0:}]}}");
+	other = new_data_access("38:1:b,22:1:d,7:1:1#0:}]1:c,1:3#}1:a,1:1#}");
+	error = LTNSDataAccessEquivalent(data_access, other, &equivalent);
+	assert(!error);
+	assert(equivalent);
+	error = LTNSDataAccessDestroy(other);
+	assert(!error);
+
+	/* Differing values */
+	other = new_data_access("38:1:b,22:1:d,7:1:1#0:}]1:c,1:4#}1:a,1:1#}");
+	error = LTNSDataAccessEquivalent(data_access, other, &equivalent);
+	assert(!error);
+	assert(!equivalent);
+	error = LTNSDataAccessDestroy(other);
+	assert(!error);
+
+	/* Extra keys */
+	other = new_data_access("45:1:a,1:1#1:b,22:1:c,1:3#1:d,7:1:1#0:}]}1:e,0:~}");
+	error = LTNSDataAccessEquivalent(data_access, other, &equivalent);
+	assert(!error);
+	assert(!equivalent);
+	error = LTNSDataAccessDestroy(other);
+	assert(!error);
+
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_hash_invalidated_on_set()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *inner, *expected;
+	LTNSTerm *term = NULL;
+	uint64_t hash = 0, inner_hash = 0, expected_hash = 0;
+
+	data_access = new_data_access("24:5:outer,12:3:foo,3:bar,}}");
+	term = get_term(data_access, "outer");
+	inner = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+
+	error = LTNSDataAccessHash(data_access, &hash);
+	assert(!error);
+	error = LTNSDataAccessHash(inner, &inner_hash);
+	assert(!error);
+	assert(hash != inner_hash);
+
+	/* Same length change in the nested dictionary */
+	set_and_check(inner, "foo", "baz", 3, LTNS_STRING);
+	expected = new_data_access("24:5:outer,12:3:foo,3:baz,}}");
+	error = LTNSDataAccessHash(expected, &expected_hash);
+	assert(!error);
+	error = LTNSDataAccessHash(data_access, &hash);
+	assert(!error);
+	assert(hash == expected_hash);
+	error = LTNSDataAccessDestroy(expected);
+	assert(!error);
+
+	expected = new_data_access("12:3:foo,3:baz,}");
+	error = LTNSDataAccessHash(expected, &expected_hash);
+	assert(!error);
+	error = LTNSDataAccessHash(inner, &inner_hash);
+	assert(!error);
+	assert(inner_hash == expected_hash);
+	error = LTNSDataAccessDestroy(expected);
+	assert(!error);
+
+	error = LTNSDataAccessDestroy(inner);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_journal_record()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *inner;
+	LTNSJournal *journal = NULL;
+	LTNSTerm *term = NULL;
+	const char *operations = NULL;
+	size_t length = 0;
+
+	data_access = new_data_access("24:5:outer,12:3:foo,3:bar,}}");
+	error = LTNSDataAccessGetJournal(data_access, &journal);
+	assert(!error);
+	assert(journal == NULL);
+
+	term = get_term(data_access, "outer");
+	inner = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+
+	/* Enabling on a child enables it for the whole document */
+	error = LTNSDataAccessEnableJournal(inner, -1);
+	assert(!error);
+	error = LTNSDataAccessGetJournal(data_access, &journal);
+	assert(!error);
+	assert(journal != NULL);
+
+	set_and_check(inner, "foo", "quux", 4, LTNS_STRING);
+	error = LTNSDataAccessRemove(data_access, "outer");
+	assert(!error);
+
+	error = LTNSJournalGetOperations(journal, &operations, &length);
+	assert(!error);
+	const char* expected = "31:3:set,14:5:outer,3:foo,]4:quux,]23:6:remove,8:5:outer,]0:~]";
+	assert(length == strlen(expected));
+	assert(!memcmp(operations, expected, length));
+
+	error = LTNSJournalClear(journal);
+	assert(!error);
+	error = LTNSJournalGetOperations(journal, &operations, &length);
+	assert(!error);
+	assert(length == 0);
+
+	error = LTNSDataAccessDestroy(inner);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_journal_apply()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *replica, *inner;
+	LTNSJournal *journal = NULL;
+	LTNSTerm *term = NULL;
+	const char *operations = NULL;
+	size_t length = 0;
+	int equal = FALSE;
+
+	const char* tnetstring = "38:5:outer,12:3:foo,3:bar,}3:baz,5:12345#}";
+	data_access = new_data_access(tnetstring);
+	replica = new_data_access(tnetstring);
+	error = LTNSDataAccessEnableJournal(data_access, -1);
+	assert(!error);
+	error = LTNSDataAccessGetJournal(data_access, &journal);
+	assert(!error);
+
+	term = get_term(data_access, "outer");
+	inner = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+
+	set_and_check(inner, "foo", "a longer value", 14, LTNS_STRING);
+	set_and_check(inner, "new", "1", 1, LTNS_STRING);
+	set_and_check(data_access, "added", "true", 4, LTNS_STRING);
+	error = LTNSDataAccessRemove(data_access, "baz");
+	assert(!error);
+
+	error = LTNSJournalGetOperations(journal, &operations, &length);
+	assert(!error);
+	error = LTNSDataAccessApplyJournal(replica, operations, length);
+	assert(!error);
+	error = LTNSDataAccessEquals(data_access, replica, &equal);
+	assert(!error);
+	assert(equal);
+
+	/* Applying the same operations again doesn't change anything */
+	error = LTNSDataAccessApplyJournal(replica, operations, length);
+	assert(!error);
+	error = LTNSDataAccessEquals(data_access, replica, &equal);
+	assert(!error);
+	assert(equal);
+
+	error = LTNSDataAccessApplyJournal(replica, "3:foo,", 6);
+	assert(error == INVALID_TNETSTRING);
+
+	error = LTNSDataAccessDestroy(inner);
+	assert(!error);
+	error = LTNSDataAccessDestroy(replica);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_journal_fd()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access;
+	LTNSJournal *journal = NULL;
+	const char *operations = NULL;
+	size_t length = 0;
+	char written[64];
+	int fds[2];
+
+	int failed = pipe(fds);
+	assert(!failed);
+	data_access = new_data_access("12:3:foo,3:bar,}");
+	error = LTNSDataAccessEnableJournal(data_access, fds[1]);
+	assert(!error);
+	set_and_check(data_access, "foo", "baz", 3, LTNS_STRING);
+
+	/* Nothing is kept in memory */
+	error = LTNSDataAccessGetJournal(data_access, &journal);
+	assert(!error);
+	error = LTNSJournalGetOperations(journal, &operations, &length);
+	assert(!error);
+	assert(length == 0);
+
+	const char* expected = "21:3:set,6:3:foo,]3:baz,]";
+	ssize_t bytes = read(fds[0], written, sizeof(written));
+	assert(bytes == (ssize_t)strlen(expected));
+	assert(!memcmp(written, expected, strlen(expected)));
+
+	error = LTNSDataAccessDisableJournal(data_access);
+	assert(!error);
+	error = LTNSDataAccessGetJournal(data_access, &journal);
+	assert(!error);
+	assert(journal == NULL);
+
+	close(fds[0]);
+	close(fds[1]);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_journal_fd_error()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access;
+	LTNSTerm *term = new_term("baz");
+	int fds[2];
+
+	/* Writing to the read end fails */
+	int failed = pipe(fds);
+	assert(!failed);
+	data_access = new_data_access("12:3:foo,3:bar,}");
+	error = LTNSDataAccessEnableJournal(data_access, fds[0]);
+	assert(!error);
+	error = LTNSDataAccessSet(data_access, "foo", term);
+	assert(error == IO_ERROR);
+	assert(check_tnetstring(data_access, "12:3:foo,3:baz,}"));
+
+	close(fds[0]);
+	close(fds[1]);
+	LTNSTermDestroy(term);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_merge_policies()
+{
+	LTNSError error;
+	const char* tnetstring = "47:1:a,1:1,5:inner,16:1:x,1:1,1:y,1:2,}1:b,4:keep,}";
+	const char* other = "51:5:inner,17:1:y,2:22,1:z,1:3,}1:c,3:new,1:b,5:other,}";
+	LTNSMergePolicy policies[] = { LTNS_MERGE_REPLACE, LTNS_MERGE_KEEP, LTNS_MERGE_DEEP };
+	const char* expected[] = {
+		"59:1:a,1:1,5:inner,17:1:y,2:22,1:z,1:3,}1:b,5:other,1:c,3:new,}",
+		"57:1:a,1:1,5:inner,16:1:x,1:1,1:y,1:2,}1:b,4:keep,1:c,3:new,}",
+		"67:1:a,1:1,5:inner,25:1:x,1:1,1:y,2:22,1:z,1:3,}1:b,5:other,1:c,3:new,}"
+	};
+	LTNSDataAccess *data_access, *source, *inner;
+	LTNSTerm *term = NULL;
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		data_access = new_data_access(tnetstring);
+		source = new_data_access(other);
+		term = get_term(data_access, "inner");
+		inner = new_nested_data_access(data_access, term);
+		error = LTNSTermDestroy(term);
+		assert(!error);
+
+		error = LTNSDataAccessMerge(data_access, source, policies[i]);
+		assert(!error);
+		assert(check_tnetstring(data_access, expected[i]));
+
+		/* Children can't follow the rewrite */
+		error = LTNSDataAccessGet(inner, "x", &term);
+		assert(error == INVALID_CHILD);
+
+		error = LTNSDataAccessDestroy(inner);
+		assert(!error);
+		error = LTNSDataAccessDestroy(source);
+		assert(!error);
+		error = LTNSDataAccessDestroy(data_access);
+		assert(!error);
+	}
+
+	data_access = new_data_access(tnetstring);
+	error = LTNSDataAccessMergeTNetstring(data_access, "1:1#", 4, LTNS_MERGE_DEEP);
+	assert(error == UNSUPPORTED_TOP_LEVEL_DATA_STRUCTURE);
+	error = LTNSDataAccessMergeTNetstring(data_access, "9:1:a,}", 7, LTNS_MERGE_DEEP);
+	assert(error == INVALID_TNETSTRING);
+	assert(check_tnetstring(data_access, tnetstring));
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_merge_nested()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *inner;
+	LTNSTerm *term = NULL;
+
+	data_access = new_data_access("11:5:inner,0:}}");
+	term = get_term(data_access, "inner");
+	inner = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+
+	error = LTNSDataAccessMergeTNetstring(inner, "14:3:key,5:value,}", 18, LTNS_MERGE_DEEP);
+	assert(!error);
+	assert(check_tnetstring(data_access, "26:5:inner,14:3:key,5:value,}}"));
+	assert(check_tnetstring(inner, "14:3:key,5:value,}"));
+
+	/* And back to an unchanged, shorter payload */
+	error = LTNSDataAccessRemove(inner, "key");
+	assert(!error);
+	assert(check_tnetstring(data_access, "11:5:inner,0:}}"));
+
+	error = LTNSDataAccessDestroy(inner);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_merge_journal()
+{
+	LTNSError error;
+	const char* tnetstring = "47:1:a,1:1,5:inner,16:1:x,1:1,1:y,1:2,}1:b,4:keep,}";
+	const char* other = "51:5:inner,17:1:y,2:22,1:z,1:3,}1:c,3:new,1:b,5:other,}";
+	LTNSDataAccess *data_access, *replica;
+	LTNSJournal *journal = NULL;
+	const char *operations = NULL;
+	size_t length = 0;
+	int equal = FALSE;
+
+	data_access = new_data_access(tnetstring);
+	replica = new_data_access(tnetstring);
+	error = LTNSDataAccessEnableJournal(data_access, -1);
+	assert(!error);
+	error = LTNSDataAccessGetJournal(data_access, &journal);
+	assert(!error);
+
+	error = LTNSDataAccessMergeTNetstring(data_access, other, strlen(other), LTNS_MERGE_KEEP);
+	assert(!error);
+	error = LTNSJournalGetOperations(journal, &operations, &length);
+	assert(!error);
+	const char* expected = "19:3:set,4:1:c,]3:new,]";
+	assert(length == strlen(expected));
+	assert(!memcmp(operations, expected, length));
+
+	error = LTNSJournalClear(journal);
+	assert(!error);
+	error = LTNSDataAccessApplyJournal(replica, expected, strlen(expected));
+	assert(!error);
+	error = LTNSDataAccessMergeTNetstring(data_access, other, strlen(other), LTNS_MERGE_DEEP);
+	assert(!error);
+	error = LTNSJournalGetOperations(journal, &operations, &length);
+	assert(!error);
+	error = LTNSDataAccessApplyJournal(replica, operations, length);
+	assert(!error);
+	error = LTNSDataAccessEquals(data_access, replica, &equal);
+	assert(!error);
+	assert(equal);
+
+	error = LTNSDataAccessDestroy(replica);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_project()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *user;
+	LTNSTerm *term = NULL;
+	LTNSBuffer out;
+	char *value = NULL;
+
+	data_access = new_data_access("88:2:id,2:42#4:user,37:4:name,3:bob,3:age,1:7#4:tags,4:1:a,]}3:big,20:xxxxxxxxxxxxxxxxxxxx,}");
+	const char* id[] = { "id" };
+	const char* user_name[] = { "user", "name" };
+	const char* user_tags[] = { "user", "tags" };
+	const char* user_all[] = { "user" };
+	const char* missing[] = { "user", "missing" };
+	const char* not_a_hash[] = { "id", "value" };
+	LTNSPath paths[] = {
+		{ id, 1 },
+		{ user_name, 2 },
+		{ missing, 2 },
+		{ not_a_hash, 2 },
+		{ user_tags, 2 }
+	};
+
+	error = LTNSBufferInit(&out, 0);
+	assert(!error);
+	error = LTNSDataAccessProject(data_access, paths, 5, &out);
+	assert(!error);
+	const char* expected = "48:2:id,2:42#4:user,27:4:name,3:bob,4:tags,4:1:a,]}}";
+	assert(out.length == strlen(expected));
+	assert(!memcmp(out.data, expected, out.length));
+
+	/* A shorter path includes everything below it */
+	LTNSPath whole_user[] = { { user_name, 2 }, { user_all, 1 } };
+	out.length = 0;
+	error = LTNSDataAccessProject(data_access, whole_user, 2, &out);
+	assert(!error);
+	expected = "48:4:user,37:4:name,3:bob,3:age,1:7#4:tags,4:1:a,]}}";
+	assert(out.length == strlen(expected));
+	assert(!memcmp(out.data, expected, out.length));
+
+	/* Nothing found */
+	out.length = 0;
+	error = LTNSDataAccessProject(data_access, &paths[2], 2, &out);
+	assert(!error);
+	assert(out.length == 3);
+	assert(!memcmp(out.data, "0:}", 3));
+
+	/* Relative to a nested data access */
+	term = get_term(data_access, "user");
+	user = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	LTNSPath age[] = { { (const char*[]){ "age" }, 1 } };
+	out.length = 0;
+	error = LTNSDataAccessProject(user, age, 1, &out);
+	assert(!error);
+	assert(out.length == 14);
+	assert(!memcmp(out.data, "10:3:age,1:7#}", 14));
+
+	error = LTNSTermGetPath(out.data, out.data + out.length, age, &value);
+	assert(!error);
+	assert(!memcmp(value, "1:7#", 4));
+	error = LTNSTermGetPath(out.data, out.data + out.length, &paths[3], &value);
+	assert(error == KEY_NOT_FOUND);
+
+	error = LTNSBufferDestroy(&out);
+	assert(!error);
+	error = LTNSDataAccessDestroy(user);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_path()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *outer, *inner;
+	LTNSTerm *term = NULL;
+	const char* keys[2];
+	size_t key_lengths[2], depth = 0;
+
+	data_access = new_data_access("30:5:outer,18:5:inner,7:1:a,0:~}}}");
+	error = LTNSDataAccessPath(data_access, NULL, NULL, &depth);
+	assert(!error);
+	assert(depth == 0);
+
+	term = get_term(data_access, "outer");
+	outer = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	term = get_term(outer, "inner");
+	inner = new_nested_data_access(outer, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+
+	error = LTNSDataAccessPath(inner, NULL, NULL, &depth);
+	assert(!error);
+	assert(depth == 2);
+	error = LTNSDataAccessPath(inner, keys, key_lengths, &depth);
+	assert(!error);
+	assert(key_lengths[0] == 5 && !memcmp(keys[0], "outer", 5));
+	assert(key_lengths[1] == 5 && !memcmp(keys[1], "inner", 5));
+	error = LTNSDataAccessPath(inner, keys, NULL, &depth);
+	assert(error == INVALID_ARGUMENT);
+
+	/* Orphans have no path */
+	error = LTNSDataAccessDestroy(outer);
+	assert(!error);
+	error = LTNSDataAccessPath(inner, NULL, NULL, &depth);
+	assert(error == INVALID_CHILD);
+
+	error = LTNSDataAccessDestroy(inner);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_version()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *outer;
+	LTNSTerm *term = NULL;
+	uint64_t version, outer_version, before;
+
+	data_access = new_data_access("30:5:outer,18:5:inner,7:1:a,0:~}}}");
+	term = get_term(data_access, "outer");
+	outer = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	error = LTNSDataAccessVersion(data_access, &version);
+	assert(!error);
+	error = LTNSDataAccessVersion(outer, &outer_version);
+	assert(!error);
+
+	/* Nested changes leave the parent's version alone */
+	error = LTNSTermCreate(&term, "value", 5, LTNS_STRING);
+	assert(!error);
+	error = LTNSDataAccessSet(outer, "key", term);
+	assert(!error);
+	error = LTNSDataAccessVersion(data_access, &before);
+	assert(!error);
+	assert(before == version);
+	error = LTNSDataAccessVersion(outer, &before);
+	assert(!error);
+	assert(before != outer_version);
+	outer_version = before;
+
+	error = LTNSDataAccessRemove(outer, "key");
+	assert(!error);
+	error = LTNSDataAccessVersion(outer, &before);
+	assert(!error);
+	assert(before != outer_version);
+
+	/* Replacing the child's value orphans it */
+	error = LTNSDataAccessSet(data_access, "outer", term);
+	assert(!error);
+	error = LTNSDataAccessVersion(data_access, &before);
+	assert(!error);
+	assert(before != version);
+	error = LTNSDataAccessVersion(outer, &before);
+	assert(error == INVALID_CHILD);
+	error = LTNSDataAccessVersion(data_access, NULL);
+	assert(error == INVALID_ARGUMENT);
+
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	error = LTNSDataAccessDestroy(outer);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_length()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *outer;
+	LTNSTerm *term = NULL;
+	size_t length;
+
+	data_access = new_data_access("30:5:outer,18:5:inner,7:1:a,0:~}}}");
+	term = get_term(data_access, "outer");
+	outer = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+
+	error = LTNSDataAccessLength(data_access, &length);
+	assert(!error);
+	assert(length == 34);
+	error = LTNSDataAccessLength(outer, &length);
+	assert(!error);
+	assert(length == 22);
+
+	/* Replacing the child's value orphans it */
+	error = LTNSTermCreate(&term, "value", 5, LTNS_STRING);
+	assert(!error);
+	error = LTNSDataAccessSet(data_access, "outer", term);
+	assert(!error);
+	error = LTNSDataAccessLength(outer, &length);
+	assert(error == INVALID_CHILD);
+	error = LTNSDataAccessLength(data_access, NULL);
+	assert(error == INVALID_ARGUMENT);
+
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	error = LTNSDataAccessDestroy(outer);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
+
+int test_freeze()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access, *cached, *outer, *again, *inner;
+	LTNSTerm *term = NULL;
+	uint64_t hash, frozen_hash;
+	size_t count;
+	int frozen;
+
+	data_access = new_data_access("30:5:outer,18:5:inner,7:1:a,0:~}}}");
+	term = get_term(data_access, "outer");
+	cached = new_nested_data_access(data_access, term);
+	error = LTNSDataAccessHash(data_access, &hash);
+	assert(!error);
+	error = LTNSDataAccessIsFrozen(cached, &frozen);
+	assert(!error);
+	assert(!frozen);
+
+	error = LTNSDataAccessFreeze(cached);
+	assert(!error);
+	error = LTNSDataAccessIsFrozen(data_access, &frozen);
+	assert(!error);
+	assert(frozen);
+	error = LTNSDataAccessHash(data_access, &frozen_hash);
+	assert(!error);
+	assert(frozen_hash == hash);
+
+	/* Children aren't cached anymore, each access gets its own */
+	outer = new_nested_data_access(data_access, term);
+	again = new_nested_data_access(data_access, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	assert(outer != cached && outer != again);
+	error = LTNSDataAccessCountChildren(data_access, &count);
+	assert(!error);
+	assert(count == 1);
+	term = get_term(outer, "inner");
+	inner = new_nested_data_access(outer, term);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	assert(check_tnetstring(inner, "7:1:a,0:~}"));
+	assert(check_tnetstring(cached, "18:5:inner,7:1:a,0:~}}"));
+
+	error = LTNSTermCreate(&term, "value", 5, LTNS_STRING);
+	assert(!error);
+	error = LTNSDataAccessSet(data_access, "key", term);
+	assert(error == FROZEN_DATA_ACCESS);
+	error = LTNSDataAccessSet(inner, "key", term);
+	assert(error == FROZEN_DATA_ACCESS);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	error = LTNSDataAccessRemove(cached, "inner");
+	assert(error == FROZEN_DATA_ACCESS);
+	error = LTNSDataAccessMergeTNetstring(outer, "0:}", 3, LTNS_MERGE_DEEP);
+	assert(error == FROZEN_DATA_ACCESS);
+	error = LTNSDataAccessApplyJournal(data_access, "", 0);
+	assert(error == FROZEN_DATA_ACCESS);
+	error = LTNSDataAccessEnableJournal(data_access, -1);
+	assert(error == FROZEN_DATA_ACCESS);
+	assert(check_tnetstring(data_access, "30:5:outer,18:5:inner,7:1:a,0:~}}}"));
+
+	error = LTNSDataAccessDestroy(inner);
+	assert(!error);
+	error = LTNSDataAccessDestroy(again);
+	assert(!error);
+	error = LTNSDataAccessDestroy(outer);
+	assert(!error);
+	error = LTNSDataAccessDestroy(cached);
+	assert(!error);
+	error = LTNSDataAccessCountChildren(data_access, &count);
+	assert(!error);
+	assert(count == 0);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "LTNSFilter.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_create_invalid();
+int test_compare_strings();
+int test_compare_numbers();
+int test_compare_literals();
+int test_missing_paths();
+int test_combinators();
+int test_nested_paths();
+int test_long_chains();
+int test_match_invalid();
+
+test_case tests[] =
+{
+	{test_create_invalid, "reject malformed expressions"},
+	{test_compare_strings, "compare strings"},
+	{test_compare_numbers, "compare integers and floats"},
+	{test_compare_literals, "compare booleans and null"},
+	{test_missing_paths, "treat comparisons with missing paths as false"},
+	{test_combinators, "combine with &&, || and !"},
+	{test_nested_paths, "follow dotted and quoted paths"},
+	{test_long_chains, "evaluate long chains of || and &&"},
+	{test_match_invalid, "reject invalid documents"}
+};
+
+void setup_test()
+{
+}
+
+void cleanup_test()
+{
+}
+
+/* {"status": "active", "level": 12, "score": 2.5, "admin": false,
+ *  "note": null, "user": {"name": "bob", "first name": "Bob"}, "tags": ["a"]} */
+static const char* document = "129:6:status,6:active,5:level,2:12#5:score,3:2.5^5:admin,5:false!4:note,0:~4:user,33:4:name,3:bob,10:first name,3:Bob,}4:tags,4:1:a,]}";
+
+static int matches(const char* expression)
+{
+	LTNSError error;
+	LTNSFilter* filter = NULL;
+	int match = FALSE;
+
+	error = LTNSFilterCreate(&filter, expression, strlen(expression));
+	assert(!error);
+	error = LTNSFilterMatch(filter, document, strlen(document), &match);
+	assert(!error);
+	error = LTNSFilterDestroy(filter);
+	assert(!error);
+
+	return match;
+}
+
+static int is_invalid(const char* expression)
+{
+	LTNSFilter* filter = NULL;
+	LTNSError error = LTNSFilterCreate(&filter, expression, strlen(expression));
+	assert(filter == NULL);
+	return error == INVALID_FILTER;
+}
+
+int test_create_invalid()
+{
+	assert(is_invalid(""));
+	assert(is_invalid("status =="));
+	assert(is_invalid("status = 1"));
+	assert(is_invalid("(status == 1"));
+	assert(is_invalid("status == 1)"));
+	assert(is_invalid("status == \"open"));
+	assert(is_invalid("1"));
+	assert(is_invalid("a &&"));
+	assert(is_invalid("user."));
+	assert(is_invalid("level > 1.e"));
+	assert(is_invalid("((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((((a))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))))"));
+	return 1;
+}
+
+int test_compare_strings()
+{
+	assert(matches("status == \"active\""));
+	assert(matches("status == 'active'"));
+	assert(!matches("status != \"active\""));
+	assert(matches("status > \"activ\""));
+	assert(matches("status < \"b\""));
+	assert(!matches("status == \"Active\""));
+	/* Different types are never equal */
+	assert(!matches("status == 1"));
+	assert(matches("status != 1"));
+	return 1;
+}
+
+int test_compare_numbers()
+{
+	assert(matches("level == 12"));
+	assert(matches("level > 10"));
+	assert(!matches("level < 10"));
+	assert(matches("level >= 12"));
+	assert(matches("level <= 12.5"));
+	assert(matches("score > 2"));
+	assert(matches("score == 2.5"));
+	assert(matches("-1 < score"));
+	assert(!matches("level == \"12\""));
+	return 1;
+}
+
+int test_compare_literals()
+{
+	assert(matches("admin == false"));
+	assert(!matches("admin == true"));
+	assert(!matches("admin < true"));
+	assert(matches("note == null"));
+	assert(!matches("note != null"));
+	/* Bare paths are true unless missing, null or false */
+	assert(matches("status"));
+	assert(!matches("admin"));
+	assert(!matches("note"));
+	assert(matches("tags"));
+	return 1;
+}
+
+int test_missing_paths()
+{
+	assert(!matches("missing"));
+	assert(!matches("missing == 1"));
+	assert(!matches("missing != 1"));
+	assert(!matches("status.name == 1"));
+	assert(matches("!missing"));
+	return 1;
+}
+
+int test_combinators()
+{
+	assert(matches("status == \"active\" && level > 10"));
+	assert(!matches("status == \"active\" && level > 20"));
+	assert(matches("level > 20 || score > 2"));
+	assert(matches("!(level > 20) && !admin"));
+	/* && binds tighter than || */
+	assert(matches("level > 20 && admin || status"));
+	assert(!matches("level > 20 && (admin || status)"));
+	assert(matches("!!status"));
+	return 1;
+}
+
+int test_nested_paths()
+{
+	assert(matches("user.name == \"bob\""));
+	assert(matches("user.'first name' == \"Bob\""));
+	assert(matches("user . \"first name\" == 'Bob'"));
+	assert(!matches("user.missing"));
+	assert(matches("user"));
+	return 1;
+}
+
+static char* repeat(const char* term, const char* separator, size_t count, const char* last)
+{
+	size_t term_length = strlen(term), separator_length = strlen(separator);
+	char* expression = malloc((term_length + separator_length) * count + strlen(last) + 1);
+	char* position = expression;
+	size_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		memcpy(position, term, term_length);
+		memcpy(position + term_length, separator, separator_length);
+		position += term_length + separator_length;
+	}
+	strcpy(position, last);
+
+	return expression;
+}
+
+int test_long_chains()
+{
+	char* expression = repeat("level == 0", " || ", 200000, "status");
+	assert(matches(expression));
+	free(expression);
+	expression = repeat("level == 0", " || ", 200000, "admin");
+	assert(!matches(expression));
+	free(expression);
+	expression = repeat("level > 1", " && ", 200000, "!admin");
+	assert(matches(expression));
+	free(expression);
+	expression = repeat("level > 1 && admin", " || ", 1000, "level > 1 && !admin");
+	assert(matches(expression));
+	free(expression);
+	return 1;
+}
+
+int test_match_invalid()
+{
+	LTNSError error;
+	LTNSFilter* filter = NULL;
+	int match = FALSE;
+
+	error = LTNSFilterCreate(&filter, "a == 1", 6);
+	assert(!error);
+	error = LTNSFilterMatch(filter, "3:1:a", 5, &match);
+	assert(error == INVALID_TNETSTRING);
+	error = LTNSFilterMatch(filter, "1:1#", 4, &match);
+	assert(error == UNSUPPORTED_TOP_LEVEL_DATA_STRUCTURE);
+	error = LTNSFilterMatch(filter, "8:1:a,1:1#}extra", 16, &match);
+	assert(error == INVALID_TNETSTRING);
+	error = LTNSFilterMatch(filter, "8:1:a,1:1#}", 11, &match);
+	assert(!error);
+	assert(match);
+	error = LTNSFilterDestroy(filter);
+	assert(!error);
+	return 1;
+}
@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "LTNSIndex.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_invalid_arguments();
+int test_equality();
+int test_ranges();
+int test_types();
+int test_large_integers();
+int test_updates();
+int test_many_documents();
+
+test_case tests[] =
+{
+	{test_invalid_arguments, "reject invalid arguments"},
+	{test_equality, "find documents by equal values"},
+	{test_ranges, "find documents by ranges of values"},
+	{test_types, "order values by type, then value"},
+	{test_large_integers, "compare integers beyond doubles with floats exactly"},
+	{test_updates, "move documents when their values change"},
+	{test_many_documents, "keep many documents in order"}
+};
+
+void setup_test()
+{
+}
+
+void cleanup_test()
+{
+}
+
+static const char* USER_ID[] = { "user", "id" };
+static const LTNSPath PATH = { USER_ID, 2 };
+
+/* {"user": {"id": 7}} */
+static const char* SEVEN = "19:4:user,9:2:id,1:7#}}";
+/* {"user": {"id": 12}} */
+static const char* TWELVE = "21:4:user,10:2:id,2:12#}}";
+/* {"user": {"id": 7.0}} */
+static const char* SEVEN_FLOAT = "22:4:user,11:2:id,3:7.0^}}";
+/* {"user": {"id": "7"}} */
+static const char* SEVEN_STRING = "19:4:user,9:2:id,1:7,}}";
+/* {"user": "nobody"} */
+static const char* NO_ID = "16:4:user,6:nobody,}";
+
+static void update(LTNSIndex* index, size_t document, const char* tnetstring)
+{
+	LTNSError error;
+	error = LTNSIndexUpdate(index, document, tnetstring, strlen(tnetstring));
+	assert(!error);
+}
+
+/* Documents with values in [low, high], NULL for open bounds */
+static size_t find(LTNSIndex* index, const char* low, const char* high, size_t* documents)
+{
+	LTNSError error;
+	LTNSIndexBound low_bound = { low, low ? strlen(low) : 0, FALSE };
+	LTNSIndexBound high_bound = { high, high ? strlen(high) : 0, FALSE };
+	size_t first, last, i;
+	error = LTNSIndexFind(index, low ? &low_bound : NULL, high ? &high_bound : NULL, &first, &last);
+	assert(!error);
+	for (i = first; i < last; i++)
+	{
+		error = LTNSIndexDocument(index, i, &documents[i - first]);
+		assert(!error);
+	}
+	return last - first;
+}
+
+int test_invalid_arguments()
+{
+	LTNSError error;
+	LTNSIndex* index = NULL;
+	size_t first, last, document;
+	error = LTNSIndexCreate(NULL, &PATH);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSIndexCreate(&index, NULL);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSIndexCreate(&index, &PATH);
+	assert(!error);
+
+	error = LTNSIndexUpdate(index, 0, NULL, 0);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSIndexUpdate(index, 0, "3:abc", 5);
+	assert(error == INVALID_TNETSTRING);
+	error = LTNSIndexFind(index, NULL, NULL, NULL, &last);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSIndexDocument(index, 0, &document);
+	assert(error == INVALID_ARGUMENT);
+
+	LTNSIndexBound broken = { "2:1#", 4, FALSE };
+	error = LTNSIndexFind(index, &broken, NULL, &first, &last);
+	assert(error == INVALID_TNETSTRING);
+
+	/* Removing documents that aren't there is fine */
+	error = LTNSIndexRemove(index, 3);
+	assert(!error);
+	error = LTNSIndexDestroy(index);
+	assert(!error);
+	return 1;
+}
+
+int test_equality()
+{
+	LTNSError error;
+	LTNSIndex* index = NULL;
+	size_t documents[4], count, found;
+	error = LTNSIndexCreate(&index, &PATH);
+	assert(!error);
+	update(index, 0, TWELVE);
+	update(index, 1, SEVEN);
+	update(index, 2, NO_ID);
+	update(index, 3, SEVEN);
+
+	error = LTNSIndexCount(index, &count);
+	assert(!error);
+	assert(count == 3);
+	found = find(index, "1:7#", "1:7#", documents);
+	assert(found == 2);
+	assert(documents[0] == 1);
+	assert(documents[1] == 3);
+	found = find(index, "2:12#", "2:12#", documents);
+	assert(found == 1);
+	assert(documents[0] == 0);
+	found = find(index, "1:8#", "1:8#", documents);
+	assert(found == 0);
+
+	error = LTNSIndexDestroy(index);
+	assert(!error);
+	return 1;
+}
+
+int test_ranges()
+{
+	LTNSError error;
+	LTNSIndex* index = NULL;
+	size_t documents[4], first, last, found;
+	error = LTNSIndexCreate(&index, &PATH);
+	assert(!error);
+	update(index, 0, TWELVE);
+	update(index, 1, SEVEN);
+	update(index, 2, SEVEN_STRING);
+
+	/* Only numbers lie between numbers */
+	found = find(index, "1:5#", "2:20#", documents);
+	assert(found == 2);
+	assert(documents[0] == 1);
+	assert(documents[1] == 0);
+	found = find(index, NULL, "2:10#", documents);
+	assert(found == 1);
+	assert(documents[0] == 1);
+	found = find(index, "1:8#", NULL, documents);
+	assert(found == 2);
+	assert(documents[0] == 0);
+	assert(documents[1] == 2);
+
+	LTNSIndexBound low = { "1:7#", 4, TRUE }, high = { "2:12#", 5, TRUE };
+	error = LTNSIndexFind(index, &low, &high, &first, &last);
+	assert(!error);
+	assert(first == last);
+	high.exclusive = FALSE;
+	error = LTNSIndexFind(index, &low, &high, &first, &last);
+	assert(!error);
+	assert(last - first == 1);
+
+	/* Empty ranges */
+	found = find(index, "2:20#", "1:5#", documents);
+	assert(found == 0);
+
+	error = LTNSIndexDestroy(index);
+	assert(!error);
+	return 1;
+}
+
+int test_types()
+{
+	LTNSError error;
+	LTNSIndex* index = NULL;
+	size_t documents[5], found;
+	static const char* ID[] = { "id" };
+	LTNSPath path = { ID, 1 };
+	error = LTNSIndexCreate(&index, &path);
+	assert(!error);
+	update(index, 0, "12:2:id,4:true!}");
+	update(index, 1, "9:2:id,1:b,}");
+	update(index, 2, "10:2:id,2:10#}");
+	update(index, 3, "8:2:id,0:~}");
+	update(index, 4, "11:2:id,3:2.5^}");
+
+	found = find(index, NULL, NULL, documents);
+	assert(found == 5);
+	assert(documents[0] == 3);
+	assert(documents[1] == 0);
+	assert(documents[2] == 4);
+	assert(documents[3] == 2);
+	assert(documents[4] == 1);
+	error = LTNSIndexDestroy(index);
+	assert(!error);
+
+	/* Integers and floats with the same number are equal */
+	error = LTNSIndexCreate(&index, &PATH);
+	assert(!error);
+	update(index, 0, SEVEN_FLOAT);
+	update(index, 1, SEVEN);
+	found = find(index, "1:7#", "1:7#", documents);
+	assert(found == 2);
+	assert(documents[0] == 0);
+	assert(documents[1] == 1);
+	found = find(index, "1:7,", "1:7,", documents);
+	assert(found == 0);
+	error = LTNSIndexDestroy(index);
+	assert(!error);
+	return 1;
+}
+
+int test_large_integers()
+{
+	LTNSError error;
+	LTNSIndex* index = NULL;
+	size_t documents[5], found;
+	static const char* ID[] = { "id" };
+	LTNSPath path = { ID, 1 };
+	error = LTNSIndexCreate(&index, &path);
+	assert(!error);
+	/* 2^53 + 1 rounds to the float 2^53 */
+	update(index, 0, "25:2:id,16:9007199254740993#}");
+	update(index, 1, "27:2:id,18:9007199254740992.0^}");
+	update(index, 2, "25:2:id,16:9007199254740992#}");
+	update(index, 3, "29:2:id,20:-9223372036854775808#}");
+	update(index, 4, "15:2:id,7:-9.3e18^}");
+
+	found = find(index, NULL, NULL, documents);
+	assert(found == 5);
+	assert(documents[0] == 4);
+	assert(documents[1] == 3);
+	assert(documents[2] == 1);
+	assert(documents[3] == 2);
+	assert(documents[4] == 0);
+	found = find(index, "16:9007199254740993#", "16:9007199254740993#", documents);
+	assert(found == 1);
+	assert(documents[0] == 0);
+	found = find(index, "18:9007199254740992.0^", "18:9007199254740992.0^", documents);
+	assert(found == 2);
+	error = LTNSIndexDestroy(index);
+	assert(!error);
+	return 1;
+}
+
+int test_updates()
+{
+	LTNSError error;
+	LTNSIndex* index = NULL;
+	size_t documents[2], count, found;
+	error = LTNSIndexCreate(&index, &PATH);
+	assert(!error);
+	update(index, 0, SEVEN);
+	update(index, 1, TWELVE);
+
+	update(index, 0, TWELVE);
+	found = find(index, "2:12#", "2:12#", documents);
+	assert(found == 2);
+	found = find(index, "1:7#", "1:7#", documents);
+	assert(found == 0);
+
+	/* Losing the path takes the document out */
+	update(index, 1, NO_ID);
+	error = LTNSIndexCount(index, &count);
+	assert(!error);
+	assert(count == 1);
+	found = find(index, "2:12#", "2:12#", documents);
+	assert(found == 1);
+	assert(documents[0] == 0);
+
+	error = LTNSIndexRemove(index, 0);
+	assert(!error);
+	error = LTNSIndexCount(index, &count);
+	assert(!error);
+	assert(count == 0);
+	error = LTNSIndexDestroy(index);
+	assert(!error);
+	return 1;
+}
+
+#define DOCUMENTS 1000
+
+int test_many_documents()
+{
+	LTNSError error;
+	LTNSIndex* index = NULL;
+	char document[64], value[16];
+	size_t documents[DOCUMENTS], i, count, previous, found;
+	static const char* ID[] = { "id" };
+	LTNSPath path = { ID, 1 };
+	error = LTNSIndexCreate(&index, &path);
+	assert(!error);
+
+	/* Insert in a shuffled order, then change every other value */
+	for (i = 0; i < DOCUMENTS; i++)
+	{
+		size_t number = (i * 7919) % DOCUMENTS;
+		sprintf(value, "%zu:%zu#", count_digits(number), number);
+		sprintf(document, "%zu:2:id,%s}", 5 + strlen(value), value);
+		update(index, i, document);
+	}
+	for (i = 0; i < DOCUMENTS; i += 2)
+	{
+		sprintf(document, "%zu:2:id,%s}", 5 + strlen("1:x,"), "1:x,");
+		update(index, i, document);
+	}
+
+	error = LTNSIndexCount(index, &count);
+	assert(!error);
+	assert(count == DOCUMENTS);
+	found = find(index, "1:x,", "1:x,", documents);
+	assert(found == DOCUMENTS / 2);
+	for (i = 0; i < DOCUMENTS / 2; i++)
+		assert(documents[i] == i * 2);
+
+	/* The odd documents hold numbers in order */
+	found = find(index, "1:0#", NULL, documents);
+	assert(found == DOCUMENTS);
+	for (i = 1; i < DOCUMENTS / 2; i++)
+	{
+		previous = (documents[i - 1] * 7919) % DOCUMENTS;
+		assert((documents[i] * 7919) % DOCUMENTS > previous);
+	}
+
+	error = LTNSIndexDestroy(index);
+	assert(!error);
+	return 1;
+}
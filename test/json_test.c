@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "LTNSTerm.h"
+#include "LTNSDataAccess.h"
+#include "LTNSJson.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_to_json_scalars();
+int test_to_json_nested();
+int test_to_json_escaping();
+int test_to_json_only();
+int test_to_json_except();
+int test_to_json_invalid_float();
+int test_to_json_invalid_numbers();
+int test_to_json_utf8();
+int test_to_json_term();
+int test_from_json_object();
+int test_from_json_escapes();
+int test_from_json_invalid();
+int test_from_json_create_from_buffer();
+
+test_case tests[] =
+{
+	{test_to_json_scalars, "transcode a dictionary of scalars"},
+	{test_to_json_nested, "transcode nested dictionaries and lists"},
+	{test_to_json_escaping, "escape quotes, backslashes and control characters"},
+	{test_to_json_only, "transcode only the given keys"},
+	{test_to_json_except, "transcode all but the given keys"},
+	{test_to_json_invalid_float, "reject floats JSON can't represent"},
+	{test_to_json_invalid_numbers, "reject numbers outside the JSON grammar"},
+	{test_to_json_utf8, "copy valid UTF-8 and reject invalid sequences"},
+	{test_to_json_term, "transcode a dictionary term with a filter"},
+	{test_from_json_object, "parse nested JSON into a tnetstring"},
+	{test_from_json_escapes, "decode JSON string escapes"},
+	{test_from_json_invalid, "reject invalid JSON"},
+	{test_from_json_create_from_buffer, "create a data access owning the parsed buffer"}
+};
+
+void setup_test()
+{
+}
+
+void cleanup_test()
+{
+}
+
+static int check_json(const char* tnetstring, LTNSJsonFilter filter, const char** keys, size_t key_count, const char* expected)
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSBuffer buffer;
+
+	error = LTNSDataAccessCreate(&data_access, tnetstring, strlen(tnetstring));
+	assert(!error);
+	error = LTNSBufferInit(&buffer, 0);
+	assert(!error);
+	error = LTNSDataAccessToJSON(data_access, filter, keys, key_count, &buffer);
+	assert(!error);
+	int ok = buffer.length == strlen(expected) && !memcmp(buffer.data, expected, buffer.length);
+
+	error = LTNSBufferDestroy(&buffer);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return ok;
+}
+
+int test_to_json_scalars()
+{
+	const char* tnetstring = "59:1:s,3:foo,1:i,2:-5#1:f,3:2.5^1:t,4:true!1:b,5:false!1:n,0:~}";
+	return check_json(tnetstring, LTNS_JSON_ALL, NULL, 0,
+		"{\"s\":\"foo\",\"i\":-5,\"f\":2.5,\"t\":true,\"b\":false,\"n\":null}");
+}
+
+int test_to_json_nested()
+{
+	const char* tnetstring = "41:5:outer,12:3:foo,3:bar,}4:list,7:1:1#0:]]}";
+	return check_json(tnetstring, LTNS_JSON_ALL, NULL, 0,
+		"{\"outer\":{\"foo\":\"bar\"},\"list\":[1,[]]}");
+}
+
+int test_to_json_escaping()
+{
+	const char* tnetstring = "29:3:key,19:a\"b\\c\nd\001efghijklmno,}";
+	return check_json(tnetstring, LTNS_JSON_ALL, NULL, 0,
+		"{\"key\":\"a\\\"b\\\\c\\nd\\u0001efghijklmno\"}");
+}
+
+int test_to_json_only()
+{
+	const char* keys[] = { "b" };
+	const char* tnetstring = "23:1:a,1:1#1:b,1:2#1:c,0:}}";
+	return check_json(tnetstring, LTNS_JSON_ONLY, keys, 1, "{\"b\":2}");
+}
+
+int test_to_json_except()
+{
+	const char* keys[] = { "a", "c" };
+	const char* tnetstring = "23:1:a,1:1#1:b,1:2#1:c,0:}}";
+	return check_json(tnetstring, LTNS_JSON_EXCEPT, keys, 2, "{\"b\":2}");
+}
+
+static LTNSError to_json_error(const char* tnetstring)
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSBuffer buffer;
+
+	error = LTNSDataAccessCreate(&data_access, tnetstring, strlen(tnetstring));
+	assert(!error);
+	error = LTNSBufferInit(&buffer, 0);
+	assert(!error);
+	LTNSError transcoded = LTNSDataAccessToJSON(data_access, LTNS_JSON_ALL, NULL, 0, &buffer);
+
+	error = LTNSBufferDestroy(&buffer);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return transcoded;
+}
+
+int test_to_json_invalid_float()
+{
+	return to_json_error("15:1:f,8:Infinity^}") == INVALID_TNETSTRING;
+}
+
+int test_to_json_invalid_numbers()
+{
+	assert(to_json_error("9:1:i,2:+5#}") == INVALID_TNETSTRING);
+	assert(to_json_error("12:1:f,5:1.2.3^}") == INVALID_TNETSTRING);
+	assert(to_json_error("9:1:i,2:--#}") == INVALID_TNETSTRING);
+	assert(to_json_error("8:1:f,1:e^}") == INVALID_TNETSTRING);
+	assert(to_json_error("9:1:i,2:01#}") == INVALID_TNETSTRING);
+	assert(to_json_error("9:1:f,2:1.^}") == INVALID_TNETSTRING);
+	return check_json("15:1:f,8:-1.5e+10^}", LTNS_JSON_ALL, NULL, 0, "{\"f\":-1.5e+10}");
+}
+
+int test_to_json_utf8()
+{
+	/* Two, three and four byte sequences, after an ASCII run */
+	assert(check_json("28:1:s,20:abcdefgh\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80xyz,}", LTNS_JSON_ALL, NULL, 0,
+		"{\"s\":\"abcdefgh\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80xyz\"}"));
+	/* Stray continuation, truncated, overlong and surrogate encodings */
+	assert(to_json_error("10:1:s,3:a\x80" "b,}") == INVALID_TNETSTRING);
+	assert(to_json_error("9:1:s,2:a\xc3,}") == INVALID_TNETSTRING);
+	assert(to_json_error("9:1:s,2:\xc0\xaf,}") == INVALID_TNETSTRING);
+	assert(to_json_error("10:1:s,3:\xed\xa0\x80,}") == INVALID_TNETSTRING);
+	assert(to_json_error("11:1:s,4:\xf4\x90\x80\x80,}") == INVALID_TNETSTRING);
+	return 1;
+}
+
+static int check_tnetstring(const char* json, const char* expected)
+{
+	LTNSError error;
+	LTNSBuffer buffer;
+
+	error = LTNSBufferInit(&buffer, 0);
+	assert(!error);
+	error = LTNSJsonToTNetstring(json, strlen(json), &buffer);
+	assert(!error);
+	int ok = buffer.length == strlen(expected) && !memcmp(buffer.data, expected, buffer.length);
+
+	error = LTNSBufferDestroy(&buffer);
+	assert(!error);
+	return ok;
+}
+
+int test_to_json_term()
+{
+	LTNSError error;
+	LTNSTerm* term = NULL;
+	LTNSBuffer buffer;
+	const char* keys[] = { "b" };
+
+	error = LTNSTermCreateFromTNestring(&term, "23:1:a,1:1#1:b,1:2#1:c,0:}}");
+	assert(!error);
+	error = LTNSBufferInit(&buffer, 0);
+	assert(!error);
+	error = LTNSTermToJSONFiltered(term, LTNS_JSON_ONLY, keys, 1, &buffer);
+	assert(!error);
+	int ok = buffer.length == strlen("{\"b\":2}") && !memcmp(buffer.data, "{\"b\":2}", buffer.length);
+	LTNSTermDestroy(term);
+
+	/* Only dictionaries have keys to filter */
+	error = LTNSTermCreateFromTNestring(&term, "1:1#");
+	assert(!error);
+	error = LTNSTermToJSONFiltered(term, LTNS_JSON_ALL, NULL, 0, &buffer);
+	assert(error == INVALID_ARGUMENT);
+	LTNSTermDestroy(term);
+
+	error = LTNSBufferDestroy(&buffer);
+	assert(!error);
+	return ok;
+}
+
+int test_from_json_object()
+{
+	return check_tnetstring(" {\"a\": {\"b\": [1, -2.5e3, true, null]}, \"e\" : {}} ",
+		"46:1:a,31:1:b,23:1:1#6:-2.5e3^4:true!0:~]}1:e,0:}}");
+}
+
+int test_from_json_escapes()
+{
+	return check_tnetstring("[\"a\\\"\\n\\u00e9\\ud83d\\ude00\"]",
+		"12:9:a\"\n\xc3\xa9\xf0\x9f\x98\x80,]");
+}
+
+int test_from_json_invalid()
+{
+	LTNSError error;
+	const char* invalid[] = { "{", "[1,]", "{\"a\"}", "01", "\"\001\"", "{} x", "\"\\ud83d\"" };
+	size_t i;
+	LTNSBuffer buffer;
+
+	error = LTNSBufferInit(&buffer, 0);
+	assert(!error);
+	for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+	{
+		error = LTNSJsonToTNetstring(invalid[i], strlen(invalid[i]), &buffer);
+		assert(error == INVALID_JSON);
+		assert(buffer.length == 0);
+	}
+
+	error = LTNSBufferDestroy(&buffer);
+	assert(!error);
+	return 1;
+}
+
+int test_from_json_create_from_buffer()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSTerm* term = NULL;
+	LTNSBuffer buffer;
+	const char* json = "{\"foo\": \"bar\"}";
+
+	error = LTNSBufferInit(&buffer, 0);
+	assert(!error);
+	error = LTNSJsonToTNetstring(json, strlen(json), &buffer);
+	assert(!error);
+	char* data = buffer.data;
+	error = LTNSDataAccessCreateFromBuffer(&data_access, &buffer);
+	assert(!error);
+	assert(buffer.data == NULL);
+
+	/* No copy was made */
+	error = LTNSDataAccessAsTerm(data_access, &term);
+	assert(!error);
+	char* tnetstring = NULL;
+	error = LTNSTermGetTNetstring(term, &tnetstring, NULL);
+	assert(!error);
+	assert(tnetstring == data);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+
+	error = LTNSDataAccessGet(data_access, "foo", &term);
+	assert(!error);
+	error = LTNSTermDestroy(term);
+	assert(!error);
+	error = LTNSDataAccessDestroy(data_access);
+	assert(!error);
+	return 1;
+}
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "LTNSLog.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_invalid_arguments();
+int test_append_and_get();
+int test_interleaved();
+int test_reopen();
+int test_checksums();
+int test_missing_index_entries();
+int test_incomplete_entry();
+int test_read_only();
+
+test_case tests[] =
+{
+	{test_invalid_arguments, "reject invalid arguments"},
+	{test_append_and_get, "get appended records by number"},
+	{test_interleaved, "get records while appending past the mapping"},
+	{test_reopen, "read records after reopening"},
+	{test_checksums, "detect changed records"},
+	{test_missing_index_entries, "index entries missing from the index file"},
+	{test_incomplete_entry, "cut off an incomplete last entry"},
+	{test_read_only, "read logs without an index file"}
+};
+
+static char path[] = "/tmp/ltns_log_test_XXXXXX";
+static char index_path[sizeof(path) + 4];
+
+void setup_test()
+{
+	strcpy(path, "/tmp/ltns_log_test_XXXXXX");
+	int fd = mkstemp(path);
+	assert(fd >= 0);
+	close(fd);
+	sprintf(index_path, "%s.idx", path);
+}
+
+void cleanup_test()
+{
+	unlink(path);
+	unlink(index_path);
+}
+
+static const char* RECORDS[] = { "12:1:a,5:value,}", "3:abc,", "0:}" };
+
+static int has_record(LTNSLog* log, size_t index, const char* expected)
+{
+	const char* record = NULL;
+	size_t length = 0;
+	if (LTNSLogGet(log, index, &record, &length))
+		return FALSE;
+	return length == strlen(expected) && !strncmp(record, expected, length);
+}
+
+static LTNSLog* log_with_records(int writable)
+{
+	LTNSError error;
+	LTNSLog* log = NULL;
+	error = LTNSLogOpen(&log, path, TRUE);
+	assert(!error);
+	for (size_t i = 0; i < 3; i++)
+	{
+		error = LTNSLogAppend(log, RECORDS[i], strlen(RECORDS[i]), NULL);
+		assert(!error);
+	}
+	error = LTNSLogClose(log);
+	assert(!error);
+
+	error = LTNSLogOpen(&log, path, writable);
+	assert(!error);
+	return log;
+}
+
+static size_t file_length(const char* file)
+{
+	FILE* f = fopen(file, "r");
+	assert(f);
+	fseek(f, 0, SEEK_END);
+	size_t length = ftell(f);
+	fclose(f);
+	return length;
+}
+
+int test_invalid_arguments()
+{
+	LTNSError error;
+	LTNSLog* log = NULL;
+	size_t count;
+	const char* record;
+	size_t length;
+	error = LTNSLogOpen(NULL, path, TRUE);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSLogOpen(&log, NULL, TRUE);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSLogOpen(&log, "/nonexisting/log", TRUE);
+	assert(error == IO_ERROR);
+	assert(!log);
+
+	error = LTNSLogOpen(&log, path, TRUE);
+	assert(!error);
+	error = LTNSLogAppend(log, "3:abc", 5, NULL);
+	assert(error == INVALID_TNETSTRING);
+	error = LTNSLogAppend(log, "3:abc,3:abc,", 12, NULL);
+	assert(error == INVALID_TNETSTRING);
+	error = LTNSLogGet(log, 0, &record, &length);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSLogCount(log, &count);
+	assert(!error);
+	assert(count == 0);
+	error = LTNSLogClose(log);
+	assert(!error);
+
+	error = LTNSLogOpen(&log, path, FALSE);
+	assert(!error);
+	error = LTNSLogAppend(log, "3:abc,", 6, NULL);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSLogClose(log);
+	assert(!error);
+	return 1;
+}
+
+int test_append_and_get()
+{
+	LTNSError error;
+	LTNSLog* log = NULL;
+	size_t index, count;
+	error = LTNSLogOpen(&log, path, TRUE);
+	assert(!error);
+	for (size_t i = 0; i < 3; i++)
+	{
+		error = LTNSLogAppend(log, RECORDS[i], strlen(RECORDS[i]), &index);
+		assert(!error);
+		assert(index == i);
+		/* Readable right away */
+		assert(has_record(log, i, RECORDS[i]));
+	}
+	error = LTNSLogCount(log, &count);
+	assert(!error);
+	assert(count == 3);
+	assert(has_record(log, 0, RECORDS[0]));
+	error = LTNSLogPrefetch(log, 0, 3);
+	assert(!error);
+	error = LTNSLogPrefetch(log, 2, 100);
+	assert(!error);
+	error = LTNSLogSync(log);
+	assert(!error);
+	error = LTNSLogClose(log);
+	assert(!error);
+
+	/* The log file is a stream of [checksum, record] lists */
+	assert(file_length(index_path) == 3 * 8);
+	return 1;
+}
+
+int test_interleaved()
+{
+	LTNSError error;
+	LTNSLog* log = NULL;
+	char record[64], earlier[64];
+	size_t i;
+	error = LTNSLogOpen(&log, path, TRUE);
+	assert(!error);
+	/* Well past a few pages, reading back old and new records in between */
+	for (i = 0; i < 5000; i++)
+	{
+		sprintf(record, "%zu:record %zu,", 7 + (size_t)snprintf(NULL, 0, "%zu", i), i);
+		error = LTNSLogAppend(log, record, strlen(record), NULL);
+		assert(!error);
+		assert(has_record(log, i, record));
+		sprintf(earlier, "%zu:record %zu,", 7 + (size_t)snprintf(NULL, 0, "%zu", i / 2), i / 2);
+		assert(has_record(log, i / 2, earlier));
+	}
+	assert(has_record(log, 4999, "11:record 4999,"));
+	error = LTNSLogClose(log);
+	assert(!error);
+	return 1;
+}
+
+int test_reopen()
+{
+	LTNSError error;
+	LTNSLog* log = log_with_records(TRUE);
+	size_t index, count;
+	for (size_t i = 0; i < 3; i++)
+		assert(has_record(log, i, RECORDS[i]));
+	error = LTNSLogAppend(log, "1:x,", 4, &index);
+	assert(!error);
+	assert(index == 3);
+	assert(has_record(log, 3, "1:x,"));
+	error = LTNSLogClose(log);
+	assert(!error);
+
+	error = LTNSLogOpen(&log, path, FALSE);
+	assert(!error);
+	error = LTNSLogCount(log, &count);
+	assert(!error);
+	assert(count == 4);
+	assert(has_record(log, 3, "1:x,"));
+	error = LTNSLogClose(log);
+	assert(!error);
+	return 1;
+}
+
+int test_checksums()
+{
+	LTNSError error;
+	LTNSLog* log = log_with_records(FALSE);
+	const char* record;
+	size_t length;
+	error = LTNSLogClose(log);
+	assert(!error);
+
+	/* Change "value" in the first record */
+	int fd = open(path, O_WRONLY);
+	ssize_t written = pwrite(fd, "V", 1, 33);
+	assert(written == 1);
+	close(fd);
+
+	error = LTNSLogOpen(&log, path, FALSE);
+	assert(!error);
+	error = LTNSLogGet(log, 0, &record, &length);
+	assert(error == CHECKSUM_MISMATCH);
+	assert(has_record(log, 1, RECORDS[1]));
+	error = LTNSLogClose(log);
+	assert(!error);
+	return 1;
+}
+
+int test_missing_index_entries()
+{
+	LTNSError error;
+	LTNSLog* log = log_with_records(FALSE);
+	size_t count;
+	error = LTNSLogClose(log);
+	assert(!error);
+
+	/* Lose the last entry and tear the one before */
+	int failed = truncate(index_path, 8 + 3);
+	assert(!failed);
+	error = LTNSLogOpen(&log, path, TRUE);
+	assert(!error);
+	error = LTNSLogCount(log, &count);
+	assert(!error);
+	assert(count == 3);
+	for (size_t i = 0; i < 3; i++)
+		assert(has_record(log, i, RECORDS[i]));
+	error = LTNSLogClose(log);
+	assert(!error);
+	assert(file_length(index_path) == 3 * 8);
+
+	/* No index file at all */
+	unlink(index_path);
+	error = LTNSLogOpen(&log, path, TRUE);
+	assert(!error);
+	error = LTNSLogCount(log, &count);
+	assert(!error);
+	assert(count == 3);
+	assert(has_record(log, 2, RECORDS[2]));
+	error = LTNSLogClose(log);
+	assert(!error);
+	assert(file_length(index_path) == 3 * 8);
+	return 1;
+}
+
+int test_incomplete_entry()
+{
+	LTNSError error;
+	LTNSLog* log = log_with_records(FALSE);
+	size_t count, index;
+	error = LTNSLogClose(log);
+	assert(!error);
+	size_t length = file_length(path);
+
+	/* A crash while appending the last record */
+	int failed = truncate(path, length - 2);
+	assert(!failed);
+	error = LTNSLogOpen(&log, path, FALSE);
+	assert(!error);
+	error = LTNSLogCount(log, &count);
+	assert(!error);
+	assert(count == 2);
+	error = LTNSLogClose(log);
+	assert(!error);
+
+	error = LTNSLogOpen(&log, path, TRUE);
+	assert(!error);
+	error = LTNSLogCount(log, &count);
+	assert(!error);
+	assert(count == 2);
+	error = LTNSLogAppend(log, RECORDS[2], strlen(RECORDS[2]), &index);
+	assert(!error);
+	assert(index == 2);
+	error = LTNSLogClose(log);
+	assert(!error);
+	assert(file_length(path) == length);
+	assert(file_length(index_path) == 3 * 8);
+
+	error = LTNSLogOpen(&log, path, FALSE);
+	assert(!error);
+	for (size_t i = 0; i < 3; i++)
+		assert(has_record(log, i, RECORDS[i]));
+	error = LTNSLogClose(log);
+	assert(!error);
+	return 1;
+}
+
+int test_read_only()
+{
+	LTNSError error;
+	LTNSLog* log = log_with_records(FALSE);
+	size_t count;
+	error = LTNSLogClose(log);
+	assert(!error);
+	unlink(index_path);
+
+	error = LTNSLogOpen(&log, path, FALSE);
+	assert(!error);
+	error = LTNSLogCount(log, &count);
+	assert(!error);
+	assert(count == 3);
+	assert(has_record(log, 1, RECORDS[1]));
+	error = LTNSLogClose(log);
+	assert(!error);
+	assert(access(index_path, F_OK));
+	return 1;
+}
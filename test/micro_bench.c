@@ -0,0 +1,502 @@
+/* Microbenchmarks for the core library.
+ *
+ * `make bench` builds this with malloc, calloc, realloc, memmove and memcpy
+ * renamed to the counting wrappers below, so every result reports the bytes
+ * moved and allocations per operation next to the time.
+ *
+ * Usage: micro_bench [--json FILE] [--min-time MS] FILE.tnet... */
+#define _POSIX_C_SOURCE 200809L
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef memmove
+#undef memcpy
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "LTNS.h"
+
+#define MAX_RESULTS 1024
+#define MAX_KEYS 4096
+#define MAX_COPY_BYTES (64 * 1024 * 1024)
+#define MISSING_KEY "\001missing"
+
+static struct
+{
+	unsigned long long allocations;
+	unsigned long long bytes_moved;
+} counters;
+
+void* bench_malloc(size_t size) { counters.allocations++; return malloc(size); }
+void* bench_calloc(size_t count, size_t size) { counters.allocations++; return calloc(count, size); }
+void* bench_realloc(void* ptr, size_t size) { counters.allocations++; return realloc(ptr, size); }
+void* bench_memmove(void* dest, const void* src, size_t n) { counters.bytes_moved += n; return memmove(dest, src, n); }
+void* bench_memcpy(void* dest, const void* src, size_t n) { counters.bytes_moved += n; return memcpy(dest, src, n); }
+
+typedef struct
+{
+	const char* file;
+	const char* benchmark;
+	size_t iterations;
+	double ns;
+	double bytes_moved;
+	double allocations;
+} Result;
+
+typedef struct
+{
+	struct timespec start;
+	unsigned long long allocations;
+	unsigned long long bytes_moved;
+} Measurement;
+
+/* Everything a benchmark needs to know about one document */
+typedef struct
+{
+	const char* file;
+	char* tnetstring;
+	size_t length;
+	LTNSDataAccess* root;
+	LTNSDataAccess* deep_root;
+	char* keys[MAX_KEYS];
+	size_t key_count;
+	char* string_key;         // top level key with a string value
+	size_t string_length;
+	char* dict_key;           // top level key with a dictionary value
+	LTNSDataAccess* deepest;  // innermost dictionary following dict_key
+	char* deep_keys[MAX_KEYS];
+	size_t deep_key_count;
+} Fixture;
+
+typedef void (*Benchmark)(Fixture* fixture, size_t iteration);
+
+static Result results[MAX_RESULTS];
+static size_t result_count = 0;
+static double min_time_ns = 20e6;
+
+static double elapsed_ns(struct timespec* start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec);
+}
+
+static void measure_begin(Measurement* measurement)
+{
+	measurement->allocations = counters.allocations;
+	measurement->bytes_moved = counters.bytes_moved;
+	clock_gettime(CLOCK_MONOTONIC, &measurement->start);
+}
+
+static double measure_end(Measurement* measurement, Fixture* fixture, const char* benchmark, size_t iterations)
+{
+	double ns = elapsed_ns(&measurement->start);
+	if (result_count == MAX_RESULTS)
+		return ns;
+
+	Result* result = &results[result_count++];
+	result->file = fixture->file;
+	result->benchmark = benchmark;
+	result->iterations = iterations;
+	result->ns = ns / iterations;
+	result->bytes_moved = (double)(counters.bytes_moved - measurement->bytes_moved) / iterations;
+	result->allocations = (double)(counters.allocations - measurement->allocations) / iterations;
+	return ns;
+}
+
+/* Doubles the iteration count until a batch runs for at least min_time_ns */
+static void run(Fixture* fixture, const char* benchmark, Benchmark function)
+{
+	Measurement measurement;
+	size_t iterations, i;
+
+	for (iterations = 1; ; iterations *= 2)
+	{
+		measure_begin(&measurement);
+		for (i = 0; i < iterations; i++)
+			function(fixture, i);
+		double ns = elapsed_ns(&measurement.start);
+		if (ns >= min_time_ns || iterations >= ((size_t)1 << 30))
+			break;
+	}
+
+	/* Record the final batch again now that we know its size */
+	measure_begin(&measurement);
+	for (i = 0; i < iterations; i++)
+		function(fixture, i);
+	measure_end(&measurement, fixture, benchmark, iterations);
+}
+
+static void check(LTNSError error, const char* what)
+{
+	if (error)
+	{
+		fprintf(stderr, "%s failed with error %d\n", what, error);
+		exit(1);
+	}
+}
+
+/* Benchmarks on a shared document */
+
+static void bench_parse(Fixture* fixture, size_t iteration)
+{
+	LTNSTerm* term = NULL;
+	check(LTNSTermCreateNested(&term, fixture->tnetstring, fixture->tnetstring + fixture->length), "parse");
+	LTNSTermDestroy(term);
+}
+
+static void get_and_destroy(LTNSDataAccess* data_access, const char* key, LTNSError expected)
+{
+	LTNSTerm* term = NULL;
+	if (LTNSDataAccessGet(data_access, key, &term) != expected)
+		check(INVALID_ARGUMENT, "get");
+	if (term)
+		LTNSTermDestroy(term);
+}
+
+static void bench_get_hit_shallow(Fixture* fixture, size_t iteration)
+{
+	get_and_destroy(fixture->root, fixture->keys[iteration % fixture->key_count], NO_ERROR);
+}
+
+static void bench_get_miss_shallow(Fixture* fixture, size_t iteration)
+{
+	get_and_destroy(fixture->root, MISSING_KEY, KEY_NOT_FOUND);
+}
+
+static void bench_get_hit_deep(Fixture* fixture, size_t iteration)
+{
+	get_and_destroy(fixture->deepest, fixture->deep_keys[iteration % fixture->deep_key_count], NO_ERROR);
+}
+
+static void bench_get_miss_deep(Fixture* fixture, size_t iteration)
+{
+	get_and_destroy(fixture->deepest, MISSING_KEY, KEY_NOT_FOUND);
+}
+
+static void bench_create_child(Fixture* fixture, size_t iteration)
+{
+	LTNSTerm* term = NULL;
+	LTNSDataAccess* child = NULL;
+	check(LTNSDataAccessGet(fixture->root, fixture->dict_key, &term), "get");
+	check(LTNSDataAccessCreateNested(&child, fixture->root, term), "create nested");
+	LTNSTermDestroy(term);
+	LTNSDataAccessDestroy(child);
+}
+
+static LTNSTerm* same_length_values[2];
+
+static void bench_set_same_length(Fixture* fixture, size_t iteration)
+{
+	check(LTNSDataAccessSet(fixture->root, fixture->string_key, same_length_values[iteration % 2]), "set");
+}
+
+/* Benchmarks that change the length run once on each of many copies */
+
+static LTNSTerm* new_string_term(size_t length, char fill)
+{
+	LTNSTerm* term = NULL;
+	char* payload = malloc(length + 1);
+	memset(payload, fill, length);
+	check(LTNSTermCreate(&term, payload, length, LTNS_STRING), "create term");
+	free(payload);
+	return term;
+}
+
+static void run_on_copies(Fixture* fixture, const char* benchmark, LTNSTerm* value)
+{
+	Measurement measurement;
+	size_t count = MAX_COPY_BYTES / fixture->length, i;
+	if (count > 10000)
+		count = 10000;
+	if (count < 16)
+		count = 16;
+
+	LTNSDataAccess** copies = malloc(count * sizeof(LTNSDataAccess*));
+	for (i = 0; i < count; i++)
+		check(LTNSDataAccessCreate(&copies[i], fixture->tnetstring, fixture->length), "create");
+
+	measure_begin(&measurement);
+	for (i = 0; i < count; i++)
+	{
+		if (value)
+			check(LTNSDataAccessSet(copies[i], fixture->string_key, value), "set");
+		else
+			check(LTNSDataAccessRemove(copies[i], fixture->string_key), "remove");
+	}
+	measure_end(&measurement, fixture, benchmark, count);
+
+	for (i = 0; i < count; i++)
+		LTNSDataAccessDestroy(copies[i]);
+	free(copies);
+}
+
+/* Fixture setup */
+
+static char* read_file(const char* file, size_t* length)
+{
+	FILE* fp = fopen(file, "rb");
+	if (!fp)
+		return NULL;
+	fseek(fp, 0, SEEK_END);
+	*length = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	char* data = malloc(*length + 1);
+	if (fread(data, 1, *length, fp) != *length)
+	{
+		free(data);
+		data = NULL;
+	}
+	fclose(fp);
+
+	/* Ignore trailing newlines */
+	while (data && *length > 0 && (data[*length - 1] == '\n' || data[*length - 1] == '\r'))
+		(*length)--;
+	return data;
+}
+
+static char* copy_key(const char* key, size_t length)
+{
+	char* copy = malloc(length + 1);
+	memcpy(copy, key, length);
+	copy[length] = '\0';
+	return copy;
+}
+
+/* Collects the keys of the dictionary term at tnetstring and remembers the
+ * first keys with a string and a dictionary value */
+static size_t collect_keys(const char* tnetstring, const char* end, char** keys,
+		char** string_key, size_t* string_length, char** dict_key)
+{
+	char *payload, *key, *value;
+	size_t payload_length, key_length, value_length, count = 0;
+	LTNSType type;
+
+	check(LTNSTermScan(tnetstring, end, &payload, &payload_length, NULL), "scan");
+	const char* position = payload;
+	const char* payload_end = payload + payload_length;
+	while (position < payload_end)
+	{
+		check(LTNSTermScan(position, payload_end, &key, &key_length, NULL), "scan");
+		check(LTNSTermScan(key + key_length + 1, payload_end, &value, &value_length, &type), "scan");
+		if (count < MAX_KEYS)
+			keys[count++] = copy_key(key, key_length);
+		if (string_key && !*string_key && type == LTNS_STRING)
+		{
+			*string_key = copy_key(key, key_length);
+			*string_length = value_length;
+		}
+		if (dict_key && !*dict_key && type == LTNS_DICTIONARY)
+			*dict_key = copy_key(key, key_length);
+		position = value + value_length + 1;
+	}
+
+	return count;
+}
+
+static int setup_fixture(Fixture* fixture, const char* file)
+{
+	char *tnetstring, *key;
+	size_t length, i;
+
+	memset(fixture, 0, sizeof(Fixture));
+	fixture->file = file;
+	fixture->tnetstring = read_file(file, &fixture->length);
+	if (!fixture->tnetstring)
+		return FALSE;
+	if (LTNSDataAccessCreate(&fixture->root, fixture->tnetstring, fixture->length))
+		return FALSE;
+
+	fixture->key_count = collect_keys(fixture->tnetstring, fixture->tnetstring + fixture->length, fixture->keys,
+			&fixture->string_key, &fixture->string_length, &fixture->dict_key);
+	if (!fixture->dict_key)
+		return TRUE;
+
+	/* Follow the first nested dictionary as deep as it goes. This uses its
+	 * own root so create_child doesn't just hit the child cache. */
+	check(LTNSDataAccessCreate(&fixture->deep_root, fixture->tnetstring, fixture->length), "create");
+	LTNSDataAccess* current = fixture->deep_root;
+	key = copy_key(fixture->dict_key, strlen(fixture->dict_key));
+	while (key)
+	{
+		LTNSTerm* term = NULL;
+		LTNSDataAccess* child = NULL;
+		check(LTNSDataAccessGet(current, key, &term), "get");
+		check(LTNSDataAccessCreateNested(&child, current, term), "create nested");
+		LTNSTermDestroy(term);
+		free(key);
+		current = child;
+
+		key = NULL;
+		check(LTNSDataAccessAsTerm(current, &term), "as term");
+		LTNSTermGetTNetstring(term, &tnetstring, &length);
+		for (i = 0; i < fixture->deep_key_count; i++)
+			free(fixture->deep_keys[i]);
+		fixture->deep_key_count = collect_keys(tnetstring, tnetstring + length, fixture->deep_keys, NULL, NULL, &key);
+		LTNSTermDestroy(term);
+	}
+	fixture->deepest = current;
+
+	return TRUE;
+}
+
+static void run_fixture(Fixture* fixture)
+{
+	char *payload;
+	size_t payload_length, i;
+
+	run(fixture, "parse", bench_parse);
+	if (fixture->key_count > 0)
+		run(fixture, "get_hit_shallow", bench_get_hit_shallow);
+	run(fixture, "get_miss_shallow", bench_get_miss_shallow);
+	if (fixture->deepest && fixture->deep_key_count > 0)
+	{
+		run(fixture, "get_hit_deep", bench_get_hit_deep);
+		run(fixture, "get_miss_deep", bench_get_miss_deep);
+	}
+	if (fixture->dict_key)
+		run(fixture, "create_child", bench_create_child);
+
+	if (!fixture->string_key)
+		return;
+
+	size_t old_length = fixture->string_length;
+	same_length_values[0] = new_string_term(old_length, 'a');
+	same_length_values[1] = new_string_term(old_length, 'b');
+	run(fixture, "set_same_length", bench_set_same_length);
+	for (i = 0; i < 2; i++)
+		LTNSTermDestroy(same_length_values[i]);
+
+	LTNSTerm* value = new_string_term(old_length + 8, 'x');
+	run_on_copies(fixture, "set_longer", value);
+	LTNSTermDestroy(value);
+
+	value = new_string_term(old_length / 2, 'x');
+	run_on_copies(fixture, "set_shorter", value);
+	LTNSTermDestroy(value);
+
+	/* Grow the root payload just enough to need another prefix digit */
+	check(LTNSTermScan(fixture->tnetstring, fixture->tnetstring + fixture->length, &payload, &payload_length, NULL), "scan");
+	size_t next_width = 1;
+	while (next_width <= payload_length)
+		next_width *= 10;
+	value = new_string_term(old_length + (next_width - payload_length), 'x');
+	run_on_copies(fixture, "set_prefix_width_change", value);
+	LTNSTermDestroy(value);
+
+	run_on_copies(fixture, "remove", NULL);
+}
+
+static void destroy_fixture(Fixture* fixture)
+{
+	size_t i;
+	for (i = 0; i < fixture->key_count; i++)
+		free(fixture->keys[i]);
+	for (i = 0; i < fixture->deep_key_count; i++)
+		free(fixture->deep_keys[i]);
+	free(fixture->string_key);
+	free(fixture->dict_key);
+
+	/* Children are destroyed from the innermost one outwards */
+	LTNSDataAccess* current = fixture->deepest;
+	while (current && current != fixture->deep_root)
+	{
+		LTNSDataAccess* parent = NULL;
+		LTNSDataAccessParent(current, &parent);
+		LTNSDataAccessDestroy(current);
+		current = parent;
+	}
+	if (fixture->deep_root)
+		LTNSDataAccessDestroy(fixture->deep_root);
+	if (fixture->root)
+		LTNSDataAccessDestroy(fixture->root);
+	free(fixture->tnetstring);
+}
+
+static void write_json_string(FILE* fp, const char* string)
+{
+	fputc('"', fp);
+	for (; *string; string++)
+	{
+		if (*string == '"' || *string == '\\')
+			fputc('\\', fp);
+		fputc(*string, fp);
+	}
+	fputc('"', fp);
+}
+
+static int write_json(const char* file)
+{
+	size_t i;
+	FILE* fp = fopen(file, "w");
+	if (!fp)
+		return FALSE;
+
+	fprintf(fp, "{\"results\":[\n");
+	for (i = 0; i < result_count; i++)
+	{
+		fprintf(fp, "  {\"file\":");
+		write_json_string(fp, results[i].file);
+		fprintf(fp, ",\"benchmark\":");
+		write_json_string(fp, results[i].benchmark);
+		fprintf(fp, ",\"iterations\":%zu,\"ns_per_op\":%.1f,\"bytes_moved_per_op\":%.1f,\"allocations_per_op\":%.2f}%s\n",
+			results[i].iterations, results[i].ns, results[i].bytes_moved, results[i].allocations,
+			i + 1 < result_count ? "," : "");
+	}
+	fprintf(fp, "]}\n");
+
+	return fclose(fp) == 0;
+}
+
+int main(int argc, char** argv)
+{
+	const char* json_file = NULL;
+	Fixture fixture;
+	int i;
+	size_t j;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--json") && i + 1 < argc)
+			json_file = argv[++i];
+		else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+			min_time_ns = atof(argv[++i]) * 1e6;
+		else
+			break;
+	}
+	if (i == argc)
+	{
+		fprintf(stderr, "usage: %s [--json FILE] [--min-time MS] FILE.tnet...\n", argv[0]);
+		return 1;
+	}
+
+	printf("%-28s %-24s %12s %12s %10s\n", "file", "benchmark", "ns/op", "bytes/op", "allocs/op");
+	for (; i < argc; i++)
+	{
+		size_t first = result_count;
+		if (!setup_fixture(&fixture, argv[i]))
+		{
+			fprintf(stderr, "%s: not a tnetstring dictionary, skipped\n", argv[i]);
+			destroy_fixture(&fixture);
+			continue;
+		}
+		run_fixture(&fixture);
+		destroy_fixture(&fixture);
+
+		for (j = first; j < result_count; j++)
+			printf("%-28s %-24s %12.1f %12.1f %10.2f\n", results[j].file, results[j].benchmark,
+				results[j].ns, results[j].bytes_moved, results[j].allocations);
+	}
+
+	if (json_file && !write_json(json_file))
+	{
+		fprintf(stderr, "could not write %s\n", json_file);
+		return 1;
+	}
+
+	return 0;
+}
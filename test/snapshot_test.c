@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "LTNSDataAccess.h"
+#include "LTNSSnapshot.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_snapshot();
+int test_publish();
+int test_held_versions();
+int test_reader_reuse();
+int test_concurrent_readers();
+
+test_case tests[] =
+{
+	{test_snapshot, "snapshots are frozen copies"},
+	{test_publish, "readers get the last published version"},
+	{test_held_versions, "held versions are freed after release"},
+	{test_reader_reuse, "left readers are reused"},
+	{test_concurrent_readers, "readers see consistent versions while publishing"}
+};
+
+void setup_test()
+{
+}
+
+void cleanup_test()
+{
+}
+
+/* {"a": "0", "b": "0", "inner": {"c": "0"}} */
+static const char* DOCUMENT = "35:1:a,1:0,1:b,1:0,5:inner,8:1:c,1:0,}}";
+
+static void set_value(LTNSDataAccess* data_access, const char* key, const char* value)
+{
+	LTNSError error;
+	LTNSTerm* term = NULL;
+	error = LTNSTermCreate(&term, value, strlen(value), LTNS_STRING);
+	assert(!error);
+	error = LTNSDataAccessSet(data_access, key, term);
+	assert(!error);
+	LTNSTermDestroy(term);
+}
+
+static int has_value(LTNSDataAccess* data_access, const char* key, const char* value)
+{
+	LTNSError error;
+	LTNSTerm* term = NULL;
+	char* payload = NULL;
+	size_t length = 0;
+	LTNSType type;
+	error = LTNSDataAccessGet(data_access, key, &term);
+	assert(!error);
+	error = LTNSTermGetPayload(term, &payload, &length, &type);
+	assert(!error);
+	int equal = length == strlen(value) && !strncmp(payload, value, length);
+	LTNSTermDestroy(term);
+	return equal;
+}
+
+int test_snapshot()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSDataAccess* child = NULL;
+	LTNSDataAccess* snapshot = NULL;
+	LTNSTerm* term = NULL;
+	int frozen = FALSE;
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	error = LTNSDataAccessSnapshot(NULL, &snapshot);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSDataAccessSnapshot(data_access, NULL);
+	assert(error == INVALID_ARGUMENT);
+
+	error = LTNSDataAccessSnapshot(data_access, &snapshot);
+	assert(!error);
+	error = LTNSDataAccessIsFrozen(snapshot, &frozen);
+	assert(!error);
+	assert(frozen);
+	error = LTNSDataAccessIsFrozen(data_access, &frozen);
+	assert(!error);
+	assert(!frozen);
+
+	set_value(data_access, "a", "1");
+	assert(has_value(snapshot, "a", "0"));
+	error = LTNSTermCreate(&term, "1", 1, LTNS_STRING);
+	assert(error == 0);
+	error = LTNSDataAccessSet(snapshot, "a", term);
+	assert(error == FROZEN_DATA_ACCESS);
+	LTNSTermDestroy(term);
+	LTNSDataAccessDestroy(snapshot);
+
+	/* Snapshots of children are roots of their own */
+	error = LTNSDataAccessGet(data_access, "inner", &term);
+	assert(!error);
+	error = LTNSDataAccessCreateNested(&child, data_access, term);
+	assert(!error);
+	LTNSTermDestroy(term);
+	error = LTNSDataAccessSnapshot(child, &snapshot);
+	assert(!error);
+	assert(LTNSDataAccessGetRoot(snapshot) == snapshot);
+	assert(has_value(snapshot, "c", "0"));
+	LTNSDataAccessDestroy(snapshot);
+
+	LTNSDataAccessDestroy(child);
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
+
+int test_publish()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSDataAccess* snapshot = NULL;
+	LTNSSnapshots* snapshots = NULL;
+	LTNSSnapshotReader* reader = NULL;
+	size_t pending = 0;
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	error = LTNSSnapshotsCreate(&snapshots, NULL);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSSnapshotsCreate(&snapshots, data_access);
+	assert(!error);
+	error = LTNSSnapshotsJoin(snapshots, &reader);
+	assert(!error);
+
+	error = LTNSSnapshotAcquire(reader, &snapshot);
+	assert(!error);
+	assert(has_value(snapshot, "a", "0"));
+	error = LTNSSnapshotAcquire(reader, &snapshot);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSSnapshotRelease(reader);
+	assert(!error);
+	error = LTNSSnapshotRelease(reader);
+	assert(error == INVALID_ARGUMENT);
+
+	set_value(data_access, "a", "1");
+	error = LTNSSnapshotsPublish(snapshots, data_access);
+	assert(!error);
+	error = LTNSSnapshotAcquire(reader, &snapshot);
+	assert(!error);
+	assert(has_value(snapshot, "a", "1"));
+	error = LTNSSnapshotRelease(reader);
+	assert(!error);
+
+	/* Nobody held the old version */
+	error = LTNSSnapshotsReclaim(snapshots, &pending);
+	assert(!error);
+	assert(pending == 0);
+
+	error = LTNSSnapshotsLeave(reader);
+	assert(!error);
+	error = LTNSSnapshotsDestroy(snapshots);
+	assert(!error);
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
+
+int test_held_versions()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSDataAccess* held = NULL;
+	LTNSDataAccess* snapshot = NULL;
+	LTNSDataAccess* child = NULL;
+	LTNSTerm* term = NULL;
+	LTNSSnapshots* snapshots = NULL;
+	LTNSSnapshotReader* slow = NULL;
+	LTNSSnapshotReader* fast = NULL;
+	size_t pending = 0;
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	error = LTNSSnapshotsCreate(&snapshots, data_access);
+	assert(!error);
+	error = LTNSSnapshotsJoin(snapshots, &slow);
+	assert(!error);
+	error = LTNSSnapshotsJoin(snapshots, &fast);
+	assert(!error);
+	assert(slow != fast);
+
+	error = LTNSSnapshotAcquire(slow, &held);
+	assert(!error);
+	error = LTNSDataAccessGet(held, "inner", &term);
+	assert(!error);
+	error = LTNSDataAccessCreateNested(&child, held, term);
+	assert(!error);
+	LTNSTermDestroy(term);
+
+	set_value(data_access, "a", "1");
+	error = LTNSSnapshotsPublish(snapshots, data_access);
+	assert(!error);
+	set_value(data_access, "a", "2");
+	error = LTNSSnapshotsPublish(snapshots, data_access);
+	assert(!error);
+
+	/* Readers keep working while others hold old versions */
+	error = LTNSSnapshotAcquire(fast, &snapshot);
+	assert(!error);
+	assert(has_value(snapshot, "a", "2"));
+	error = LTNSSnapshotRelease(fast);
+	assert(!error);
+
+	error = LTNSSnapshotsReclaim(snapshots, &pending);
+	assert(!error);
+	assert(pending == 2);
+	assert(has_value(held, "a", "0"));
+	assert(has_value(child, "c", "0"));
+	error = LTNSSnapshotsLeave(slow);
+	assert(error == INVALID_ARGUMENT);
+
+	LTNSDataAccessDestroy(child);
+	error = LTNSSnapshotRelease(slow);
+	assert(!error);
+	error = LTNSSnapshotsReclaim(snapshots, &pending);
+	assert(!error);
+	assert(pending == 0);
+
+	error = LTNSSnapshotsDestroy(snapshots);
+	assert(!error);
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
+
+int test_reader_reuse()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSSnapshots* snapshots = NULL;
+	LTNSSnapshotReader* first = NULL;
+	LTNSSnapshotReader* second = NULL;
+	LTNSSnapshotReader* reader = NULL;
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	error = LTNSSnapshotsCreate(&snapshots, data_access);
+	assert(!error);
+	error = LTNSSnapshotsJoin(snapshots, NULL);
+	assert(error == INVALID_ARGUMENT);
+
+	error = LTNSSnapshotsJoin(snapshots, &first);
+	assert(!error);
+	error = LTNSSnapshotsJoin(snapshots, &second);
+	assert(!error);
+	error = LTNSSnapshotsLeave(first);
+	assert(!error);
+	error = LTNSSnapshotsJoin(snapshots, &reader);
+	assert(!error);
+	assert(reader == first);
+	error = LTNSSnapshotsLeave(second);
+	assert(!error);
+	error = LTNSSnapshotsJoin(snapshots, &reader);
+	assert(!error);
+	assert(reader == second);
+
+	error = LTNSSnapshotsDestroy(snapshots);
+	assert(!error);
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
+
+#define READERS 4
+#define VERSIONS 1000
+
+static int publishing;
+
+static void* read_versions(void* argument)
+{
+	LTNSSnapshots* snapshots = (LTNSSnapshots*)argument;
+	LTNSSnapshotReader* reader = NULL;
+	LTNSDataAccess* snapshot = NULL;
+	LTNSTerm* a = NULL;
+	LTNSTerm* b = NULL;
+	char *a_payload, *b_payload;
+	size_t a_length, b_length;
+	LTNSType type;
+	long consistent = 1;
+
+	if (LTNSSnapshotsJoin(snapshots, &reader))
+		return NULL;
+	while (__atomic_load_n(&publishing, __ATOMIC_ACQUIRE) && consistent)
+	{
+		/* The writer always changes a and b together */
+		LTNSSnapshotAcquire(reader, &snapshot);
+		LTNSDataAccessGet(snapshot, "a", &a);
+		LTNSDataAccessGet(snapshot, "b", &b);
+		LTNSTermGetPayload(a, &a_payload, &a_length, &type);
+		LTNSTermGetPayload(b, &b_payload, &b_length, &type);
+		consistent = a_length == b_length && !memcmp(a_payload, b_payload, a_length);
+		LTNSTermDestroy(a);
+		LTNSTermDestroy(b);
+		LTNSSnapshotRelease(reader);
+	}
+	LTNSSnapshotsLeave(reader);
+
+	return (void*)consistent;
+}
+
+int test_concurrent_readers()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSSnapshots* snapshots = NULL;
+	pthread_t readers[READERS];
+	char value[16];
+	size_t pending = 0;
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	error = LTNSSnapshotsCreate(&snapshots, data_access);
+	assert(!error);
+
+	publishing = TRUE;
+	for (int i = 0; i < READERS; ++i)
+	{
+		int failed = pthread_create(&readers[i], NULL, read_versions, snapshots);
+		assert(!failed);
+	}
+	for (int version = 1; version <= VERSIONS; ++version)
+	{
+		snprintf(value, sizeof(value), "%d", version);
+		set_value(data_access, "a", value);
+		set_value(data_access, "b", value);
+		error = LTNSSnapshotsPublish(snapshots, data_access);
+		assert(!error);
+	}
+	__atomic_store_n(&publishing, FALSE, __ATOMIC_RELEASE);
+
+	for (int i = 0; i < READERS; ++i)
+	{
+		void* consistent = NULL;
+		int failed = pthread_join(readers[i], &consistent);
+		assert(!failed);
+		assert(consistent);
+	}
+	error = LTNSSnapshotsReclaim(snapshots, &pending);
+	assert(!error);
+	assert(pending == 0);
+
+	error = LTNSSnapshotsDestroy(snapshots);
+	assert(!error);
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "LTNSDataAccess.h"
+#include "LTNSStats.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_reset();
+int test_lookup_counters();
+int test_resize_counters();
+int test_prefix_width_changes();
+int test_live_children();
+
+test_case tests[] =
+{
+	{test_reset, "reset zeroes the counters"},
+	{test_lookup_counters, "count parsed terms and scanned bytes"},
+	{test_resize_counters, "count moved bytes, reallocs and visited nodes"},
+	{test_prefix_width_changes, "count prefix width changes"},
+	{test_live_children, "count live children"}
+};
+
+void setup_test()
+{
+	LTNSStatsReset();
+}
+
+void cleanup_test()
+{
+}
+
+/* {"a": 1, "b": 2, "c": 3} */
+static const char* DOCUMENT = "24:1:a,1:1#1:b,1:2#1:c,1:3#}";
+
+static LTNSStats stats()
+{
+	LTNSError error;
+	LTNSStats stats;
+	error = LTNSStatsGet(&stats);
+	assert(!error);
+	return stats;
+}
+
+int test_reset()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	error = LTNSStatsGet(NULL);
+	assert(error == INVALID_ARGUMENT);
+
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	assert(stats().terms_parsed > 0);
+
+	LTNSStatsReset();
+	LTNSStats current = stats();
+	assert(current.terms_parsed == 0);
+	assert(current.bytes_scanned == 0);
+	assert(current.bytes_moved == 0);
+	assert(current.reallocs == 0);
+	assert(current.prefix_width_changes == 0);
+	assert(current.nodes_visited == 0);
+
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
+
+int test_lookup_counters()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSTerm* term = NULL;
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+	LTNSStatsReset();
+
+	/* Scans up to the value of "c" */
+	error = LTNSDataAccessGet(data_access, "c", &term);
+	assert(!error);
+	assert(stats().bytes_scanned == 20);
+	/* Root, three keys, two skipped values and the value term */
+	assert(stats().terms_parsed == 7);
+	LTNSTermDestroy(term);
+
+	/* Misses scan the whole payload */
+	LTNSStatsReset();
+	error = LTNSDataAccessGet(data_access, "d", &term);
+	assert(error == KEY_NOT_FOUND);
+	assert(stats().bytes_scanned == 24);
+
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
+
+int test_resize_counters()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSTerm* term = NULL;
+	error = LTNSDataAccessCreate(&data_access, DOCUMENT, strlen(DOCUMENT));
+	assert(!error);
+
+	/* Growing "a" by one byte moves the rest of the payload, the closing
+	 * brace and the NUL byte */
+	error = LTNSTermCreate(&term, "11", 2, LTNS_INTEGER);
+	assert(!error);
+	LTNSStatsReset();
+	error = LTNSDataAccessSet(data_access, "a", term);
+	assert(!error);
+	LTNSTermDestroy(term);
+	assert(stats().bytes_moved == 18);
+	assert(stats().reallocs == 1);
+	assert(stats().nodes_visited == 1);
+	assert(stats().prefix_width_changes == 0);
+
+	/* Same length sets don't move anything */
+	error = LTNSTermCreate(&term, "22", 2, LTNS_INTEGER);
+	assert(!error);
+	LTNSStatsReset();
+	error = LTNSDataAccessSet(data_access, "a", term);
+	assert(!error);
+	LTNSTermDestroy(term);
+	assert(stats().bytes_moved == 0);
+	assert(stats().reallocs == 0);
+
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
+
+int test_prefix_width_changes()
+{
+	LTNSError error;
+	LTNSDataAccess* data_access = NULL;
+	LTNSTerm* term = NULL;
+	error = LTNSDataAccessCreate(&data_access, "8:1:a,1:1#}", 11);
+	assert(!error);
+
+	/* The payload grows from 8 to 10 bytes */
+	error = LTNSTermCreate(&term, "123", 3, LTNS_INTEGER);
+	assert(!error);
+	LTNSStatsReset();
+	error = LTNSDataAccessSet(data_access, "a", term);
+	assert(!error);
+	LTNSTermDestroy(term);
+	assert(stats().prefix_width_changes == 1);
+
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
+
+int test_live_children()
+{
+	LTNSError error;
+	LTNSDataAccess *data_access = NULL, *child = NULL, *cached = NULL;
+	LTNSTerm* term = NULL;
+	size_t count = 0;
+	const char* nested = "29:1:a,14:1:b,7:1:c,0:~}}1:d,0:~}";
+	int64_t live_children = stats().live_children;
+
+	error = LTNSDataAccessCreate(&data_access, nested, strlen(nested));
+	assert(!error);
+	error = LTNSDataAccessGet(data_access, "a", &term);
+	assert(!error);
+	error = LTNSDataAccessCreateNested(&child, data_access, term);
+	assert(!error);
+	assert(stats().live_children == live_children + 1);
+
+	/* Cached children aren't counted twice */
+	error = LTNSDataAccessCreateNested(&cached, data_access, term);
+	assert(!error);
+	assert(cached == child);
+	assert(stats().live_children == live_children + 1);
+	LTNSTermDestroy(term);
+
+	error = LTNSDataAccessGet(child, "b", &term);
+	assert(!error);
+	error = LTNSDataAccessCreateNested(&cached, child, term);
+	assert(!error);
+	LTNSTermDestroy(term);
+	assert(stats().live_children == live_children + 2);
+	error = LTNSDataAccessCountChildren(data_access, &count);
+	assert(!error);
+	assert(count == 2);
+	error = LTNSDataAccessCountChildren(data_access, NULL);
+	assert(error == INVALID_ARGUMENT);
+
+	/* Orphaned children are live until destroyed */
+	LTNSDataAccessDestroy(child);
+	LTNSDataAccessDestroy(child);
+	assert(stats().live_children == live_children + 1);
+	LTNSDataAccessDestroy(cached);
+	assert(stats().live_children == live_children);
+
+	LTNSDataAccessDestroy(data_access);
+	return 1;
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "LTNSStream.h"
+
+#include "test_suite.h"
+
+// define tests
+int test_invalid_arguments();
+int test_split();
+int test_incomplete_records();
+int test_threads();
+int test_broken_stream_threads();
+
+test_case tests[] =
+{
+	{test_invalid_arguments, "reject invalid arguments"},
+	{test_split, "split concatenated tnetstrings"},
+	{test_incomplete_records, "stop before incomplete records"},
+	{test_threads, "threads resynchronize on the same records"},
+	{test_broken_stream_threads, "threads stop where the stream breaks"}
+};
+
+void setup_test()
+{
+}
+
+void cleanup_test()
+{
+}
+
+/* A dictionary, a list, a string and an integer */
+static const char* STREAM = "12:1:a,5:value,}4:1:1#]3:abc,2:42#";
+
+int test_invalid_arguments()
+{
+	LTNSError error;
+	size_t* offsets = NULL;
+	size_t count = 0;
+	error = LTNSStreamSplit(NULL, 1, 1, &offsets, &count);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSStreamSplit(STREAM, strlen(STREAM), 0, &offsets, &count);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSStreamSplit(STREAM, strlen(STREAM), 1, NULL, &count);
+	assert(error == INVALID_ARGUMENT);
+	error = LTNSStreamSplit(STREAM, strlen(STREAM), 1, &offsets, NULL);
+	assert(error == INVALID_ARGUMENT);
+
+	error = LTNSStreamSplit(NULL, 0, 1, &offsets, &count);
+	assert(!error);
+	assert(count == 0);
+	assert(offsets[0] == 0);
+	free(offsets);
+	return 1;
+}
+
+int test_split()
+{
+	LTNSError error;
+	size_t* offsets = NULL;
+	size_t count = 0;
+	error = LTNSStreamSplit(STREAM, strlen(STREAM), 4, &offsets, &count);
+	assert(!error);
+	assert(count == 4);
+	assert(offsets[0] == 0);
+	assert(offsets[1] == 16);
+	assert(offsets[2] == 23);
+	assert(offsets[3] == 29);
+	assert(offsets[4] == strlen(STREAM));
+	free(offsets);
+	return 1;
+}
+
+int test_incomplete_records()
+{
+	LTNSError error;
+	size_t* offsets = NULL;
+	size_t count = 0;
+	/* Cut off in the last record */
+	error = LTNSStreamSplit(STREAM, strlen(STREAM) - 1, 1, &offsets, &count);
+	assert(!error);
+	assert(count == 3);
+	assert(offsets[3] == 29);
+	free(offsets);
+
+	/* Garbage in front of the stream */
+	error = LTNSStreamSplit("x3:abc,", 7, 1, &offsets, &count);
+	assert(!error);
+	assert(count == 0);
+	assert(offsets[0] == 0);
+	free(offsets);
+	return 1;
+}
+
+#define RECORDS 20000
+
+static size_t write_record(char* out, const char* payload, char type)
+{
+	return sprintf(out, "%zu:%s%c", strlen(payload), payload, type);
+}
+
+/* Records of different sizes and kinds, some of them a payload of
+ * concatenated tnetstrings to mislead guessing, and one spanning several
+ * of the parts the threads split the stream into */
+static char* build_stream(size_t* length)
+{
+	size_t capacity = RECORDS * 64 + 512 * 1024;
+	char* stream = (char*)malloc(capacity);
+	char payload[64], value[32];
+	size_t i, offset = 0;
+	for (i = 0; i < RECORDS; i++)
+	{
+		sprintf(value, "%zu:%zu#", count_digits(i), i);
+		if (i % 3 == 0)
+		{
+			sprintf(payload, "1:a,%s", value);
+			offset += write_record(stream + offset, payload, '}');
+		}
+		else if (i % 3 == 1)
+			offset += write_record(stream + offset, "3:abc,3:abc,3:abc,", ',');
+		else
+			offset += write_record(stream + offset, value, ']');
+
+		if (i == RECORDS / 2)
+		{
+			size_t inner = 400 * 1024 / 7;
+			offset += sprintf(stream + offset, "%zu:", inner * 7);
+			for (size_t j = 0; j < inner; j++)
+				offset += sprintf(stream + offset, "4:1:1#]");
+			offset += sprintf(stream + offset, ",");
+		}
+	}
+	*length = offset;
+	return stream;
+}
+
+int test_threads()
+{
+	LTNSError error;
+	size_t length;
+	char* stream = build_stream(&length);
+	size_t *single = NULL, *parallel = NULL;
+	size_t single_count = 0, parallel_count = 0;
+
+	error = LTNSStreamSplit(stream, length, 1, &single, &single_count);
+	assert(!error);
+	/* The large record comes on top */
+	assert(single_count == RECORDS + 1);
+	assert(single[single_count] == length);
+	for (int threads = 2; threads <= 8; threads++)
+	{
+		error = LTNSStreamSplit(stream, length, threads, &parallel, &parallel_count);
+		assert(!error);
+		assert(parallel_count == single_count);
+		assert(!memcmp(single, parallel, sizeof(size_t) * (single_count + 1)));
+		free(parallel);
+	}
+
+	free(single);
+	free(stream);
+	return 1;
+}
+
+int test_broken_stream_threads()
+{
+	LTNSError error;
+	size_t length;
+	char* stream = build_stream(&length);
+	size_t *single = NULL, *parallel = NULL;
+	size_t single_count = 0, parallel_count = 0;
+
+	/* Break the type of a record three quarters in */
+	error = LTNSStreamSplit(stream, length, 1, &single, &single_count);
+	assert(!error);
+	size_t record = single_count * 3 / 4;
+	stream[single[record + 1] - 1] = 'x';
+	free(single);
+
+	error = LTNSStreamSplit(stream, length, 1, &single, &single_count);
+	assert(!error);
+	assert(single_count == record);
+	error = LTNSStreamSplit(stream, length, 4, &parallel, &parallel_count);
+	assert(!error);
+	assert(parallel_count == single_count);
+	assert(!memcmp(single, parallel, sizeof(size_t) * (single_count + 1)));
+
+	free(single);
+	free(parallel);
+	free(stream);
+	return 1;
+}
@@ -1,3 +1,10 @@
+// The Makefile renames malloc, calloc, realloc and free to the counting
+// functions at the end of this file, the C library keeps its own names
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,6 +12,16 @@
 
 #include "test_suite.h"
 
+void* test_malloc(size_t size);
+void* test_calloc(size_t count, size_t size);
+void* test_realloc(void* ptr, size_t size);
+void test_free(void* ptr);
+
+#define malloc test_malloc
+#define calloc test_calloc
+#define realloc test_realloc
+#define free test_free
+
 #ifndef TEST_SUITE
 #error "Please use -DTEST_SUITE='"sth"' to define a test suite ..."
 #endif
@@ -52,6 +69,7 @@ int main( int argc, char **argv)
         // loop through all tests
         for(int test_id = starting_test; test_id < test_count; ++test_id)
         {
+                reset_allocations();
                 setup_test();
                 test_case test = tests[test_id];
                 
@@ -87,4 +105,76 @@ int main( int argc, char **argv)
         free(failed_tests);
         return last_failed_test;
 }
-	
+
+// Each block carries its size in front of it
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
+#define ALLOCATION_HEADER 16
+
+allocation_counters allocations;
+static long long live_bytes = 0;
+static long long base_bytes = 0;
+
+void reset_allocations()
+{
+        memset(&allocations, 0, sizeof(allocations));
+        base_bytes = live_bytes;
+}
+
+static void count_bytes(long long delta)
+{
+        live_bytes += delta;
+        allocations.bytes = live_bytes - base_bytes;
+        if( allocations.bytes > allocations.peak_bytes )
+                allocations.peak_bytes = allocations.bytes;
+}
+
+static void* track(char* block, size_t size)
+{
+        if( !block )
+                return NULL;
+        *(size_t*)block = size;
+        count_bytes(size);
+        return block + ALLOCATION_HEADER;
+}
+
+void* test_malloc(size_t size)
+{
+        allocations.allocations++;
+        return track((char*)malloc(size + ALLOCATION_HEADER), size);
+}
+
+void* test_calloc(size_t count, size_t size)
+{
+        allocations.allocations++;
+        return track((char*)calloc(1, count * size + ALLOCATION_HEADER), count * size);
+}
+
+void* test_realloc(void* ptr, size_t size)
+{
+        if( !ptr )
+                return test_malloc(size);
+
+        char* block = (char*)ptr - ALLOCATION_HEADER;
+        size_t old_size = *(size_t*)block;
+        allocations.reallocs++;
+        block = (char*)realloc(block, size + ALLOCATION_HEADER);
+        if( !block )
+                return NULL;
+        count_bytes(-(long long)old_size);
+        return track(block, size);
+}
+
+void test_free(void* ptr)
+{
+        if( !ptr )
+                return;
+
+        char* block = (char*)ptr - ALLOCATION_HEADER;
+        allocations.frees++;
+        count_bytes(-(long long)*(size_t*)block);
+        free(block);
+}
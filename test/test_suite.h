@@ -29,4 +29,19 @@ typedef struct {
 // define this global and add your tests
 extern test_case tests[];
 
+// allocations made through malloc, calloc, realloc and free since the last
+// reset_allocations(), test.c counts them for every test
+typedef struct {
+	size_t allocations;
+	size_t reallocs;
+	size_t frees;
+	long long bytes;
+	long long peak_bytes;
+} allocation_counters;
+
+extern allocation_counters allocations;
+
+// zero the counters, bytes and peak_bytes count from here on
+void reset_allocations();
+
 #endif //  _TEST_SUITE_H__